@@ -0,0 +1,212 @@
+#include "imed_gui_app.hpp"
+#include "imed_gui_notifications.hpp"
+#include "imed_gui_atlas.hpp"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "imgui/imgui.h"
+#include "imgui/backends/imgui_impl_glfw.h"
+#include "imgui/backends/imgui_impl_opengl3.h"
+
+#include <algorithm>
+#include <limits>
+
+static constexpr double NoDeadline = std::numeric_limits<double>::infinity();
+
+std::atomic<bool> Application::s_woken = false;
+std::atomic<double> Application::s_deadline = NoDeadline;
+std::atomic<bool> Application::s_running = false;
+std::thread::id Application::s_mainThread;
+std::mutex Application::s_tasksMutex;
+std::vector<std::future<void>> Application::s_tasks;
+
+Application::Application(const char* title, int width, int height) {
+	if (glfwInit() == GLFW_FALSE) {
+		ImEdLog("Failed to initialize GLFW", DebugMessageType::Error);
+		return;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	m_window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+	if (m_window == nullptr) {
+		ImEdLog("Failed to create the main window", DebugMessageType::Error);
+		glfwTerminate();
+		return;
+	}
+	glfwMakeContextCurrent(m_window);
+	glfwSwapInterval(1);
+	glewInit();
+
+	s_mainThread = std::this_thread::get_id();
+	s_running = true;
+	glfwSetWindowUserPointer(m_window, this);
+	// Installed first, the ImGui backend chains to them from its own callbacks.
+	installCallbacks();
+
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+	ImGui_ImplGlfw_InitForOpenGL(m_window, true);
+	ImGui_ImplOpenGL3_Init("#version 330");
+	ImEdGui_Init();
+}
+
+Application::~Application() {
+	if (m_window == nullptr) {
+		return;
+	}
+	// Tasks still running may wake the loop until they are done, the window has to outlive them.
+	JoinTasks();
+	s_running = false;
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+	glfwDestroyWindow(m_window);
+	glfwTerminate();
+}
+
+void Application::OnInput(GLFWwindow* window) {
+	auto* application = static_cast<Application*>(glfwGetWindowUserPointer(window));
+	application->m_activeUntil = glfwGetTime() + ActiveSeconds;
+}
+
+void Application::installCallbacks() {
+	glfwSetKeyCallback(m_window, [](GLFWwindow* window, int, int, int, int) { OnInput(window); });
+	glfwSetCharCallback(m_window, [](GLFWwindow* window, unsigned int) { OnInput(window); });
+	glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int, int, int) { OnInput(window); });
+	glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double, double) { OnInput(window); });
+	glfwSetCursorEnterCallback(m_window, [](GLFWwindow* window, int) { OnInput(window); });
+	glfwSetScrollCallback(m_window, [](GLFWwindow* window, double, double) { OnInput(window); });
+	glfwSetWindowFocusCallback(m_window, [](GLFWwindow* window, int) { OnInput(window); });
+	glfwSetWindowSizeCallback(m_window, [](GLFWwindow* window, int, int) { OnInput(window); });
+	glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window) { OnInput(window); });
+	glfwSetDropCallback(m_window, [](GLFWwindow* window, int, const char**) { OnInput(window); });
+}
+
+void Application::Wake() {
+	s_woken.store(true, std::memory_order_release);
+	if (s_running.load(std::memory_order_acquire)) {
+		glfwPostEmptyEvent();
+	}
+}
+
+void Application::KeepTask(std::future<void>&& task) {
+	std::lock_guard lock(s_tasksMutex);
+	std::erase_if(s_tasks, [](const std::future<void>& kept) { return kept.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+	s_tasks.push_back(std::move(task));
+}
+
+void Application::JoinTasks() {
+	std::vector<std::future<void>> tasks;
+	{
+		std::lock_guard lock(s_tasksMutex);
+		tasks.swap(s_tasks);
+	}
+	// Destroying an std::async future waits for its thread.
+	tasks.clear();
+}
+
+void Application::RequestFrameIn(double seconds) {
+	const double deadline = glfwGetTime() + std::max(0.0, seconds);
+	double current = s_deadline.load(std::memory_order_relaxed);
+	while (deadline < current && !s_deadline.compare_exchange_weak(current, deadline)) { }
+	// The main thread picks up its own requests when it computes the next timeout, others have to interrupt the wait.
+	if (deadline < current && std::this_thread::get_id() != s_mainThread && s_running.load(std::memory_order_acquire)) {
+		glfwPostEmptyEvent();
+	}
+}
+
+void Application::wait() {
+	const double now = glfwGetTime();
+	if (m_wakeFrames > 0 || now < m_activeUntil) {
+		glfwPollEvents();
+	} else if (const double deadline = s_deadline.load(); deadline == NoDeadline) {
+		glfwWaitEvents();
+	} else if (deadline > now) {
+		glfwWaitEventsTimeout(deadline - now);
+	} else {
+		glfwPollEvents();
+	}
+
+	if (s_woken.exchange(false, std::memory_order_acq_rel)) {
+		m_wakeFrames = WakeFrames;
+	}
+}
+
+bool Application::frameDue(const IWidget& root) {
+	// Minimized windows draw nothing, restoring them is an event.
+	if (glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) != 0) {
+		return false;
+	}
+	const double now = glfwGetTime();
+	if (double deadline = s_deadline.load(); now >= deadline) {
+		// Cleared before drawing, whatever still animates asks again during the frame.
+		s_deadline.compare_exchange_strong(deadline, NoDeadline);
+		return true;
+	}
+	if (now < m_activeUntil) {
+		return true;
+	}
+	// The first frame after a Wake() is always drawn, a task may have changed a field without marking anything dirty.
+	// The rest only while something is, woken for a snapshot that finished saving draws just the one.
+	if (m_wakeFrames > 0 && m_wakeFrames < WakeFrames && !root.isDirty() && !Notifications.isDirty()) {
+		m_wakeFrames = 0;
+	}
+	return m_wakeFrames > 0;
+}
+
+void Application::drawFrame(IWidget& root) {
+	if (m_wakeFrames > 0) {
+		m_wakeFrames--;
+	}
+	ImEdGui_NewFrame();
+	ImGui_ImplOpenGL3_NewFrame();
+	ImGui_ImplGlfw_NewFrame();
+	ImGui::NewFrame();
+
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImGui::SetNextWindowPos(viewport->WorkPos);
+	ImGui::SetNextWindowSize(viewport->WorkSize);
+	constexpr ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings |
+		ImGuiWindowFlags_NoBringToFrontOnFocus;
+	if (ImGui::Begin("##ImEd", nullptr, flags)) {
+		root.draw();
+	}
+	ImGui::End();
+	Notifications.draw();
+	// Icons added during the frame are packed at the start of the next one.
+	if (UiIcons.needsRebuild()) {
+		RequestFrameIn(0.0);
+	}
+	if (ImGui::GetIO().WantTextInput) {
+		RequestFrameIn(CaretBlinkSeconds);
+	}
+
+	ImGui::Render();
+	int width, height;
+	glfwGetFramebufferSize(m_window, &width, &height);
+	glViewport(0, 0, width, height);
+	const ImVec4 background = ImGui::GetStyle().Colors[ImGuiCol_WindowBg];
+	glClearColor(background.x, background.y, background.z, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	glfwSwapBuffers(m_window);
+	m_framesDrawn++;
+}
+
+int Application::run(IWidget& root) {
+	if (m_window == nullptr) {
+		return 1;
+	}
+	// Drawn like after input at first, windows and fonts take a few frames to settle.
+	m_activeUntil = glfwGetTime() + ActiveSeconds;
+	while (glfwWindowShouldClose(m_window) == 0) {
+		if (frameDue(root)) {
+			drawFrame(root);
+		}
+		wait();
+	}
+	return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "imed_gui_layout.hpp"
+
+#include <atomic>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <cstdint>
+
+struct GLFWwindow;
+
+// Owns the window and runs the frame loop. Frames are only drawn when something can have changed: input, a Wake()
+// from another thread (file watcher batches, finished background tasks, new log lines) that left a widget dirty, or
+// a deadline asked for with RequestFrameIn() by whatever animates. In between the main thread sleeps in
+// glfwWaitEventsTimeout.
+class Application {
+public:
+	// After input frames keep coming for a moment, hover delays and tooltips appear without further events.
+	static constexpr double ActiveSeconds = 0.5;
+	// Frames drawn at most after a Wake(), the first unconditionally and the others for as long as the widget tree
+	// stays dirty. Widgets that cannot tell whether they changed stay dirty and get all of them.
+	static constexpr int WakeFrames = 3;
+	// Half of ImGui's text cursor blink period.
+	static constexpr double CaretBlinkSeconds = 0.4;
+private:
+	GLFWwindow* m_window = nullptr;
+	double m_activeUntil = 0.0;
+	int m_wakeFrames = 0;
+	uint64_t m_framesDrawn = 0;
+
+	static std::atomic<bool> s_woken;
+	static std::atomic<double> s_deadline;
+	static std::atomic<bool> s_running;
+	static std::thread::id s_mainThread;
+	static std::mutex s_tasksMutex;
+	static std::vector<std::future<void>> s_tasks;
+
+	void installCallbacks();
+	void wait();
+	[[nodiscard]] bool frameDue(const IWidget& root);
+	void drawFrame(IWidget& root);
+
+	static void OnInput(GLFWwindow* window);
+	static void KeepTask(std::future<void>&& task);
+	static void JoinTasks();
+public:
+	Application(const char* title, int width, int height);
+	Application(const Application&) = delete;
+	Application& operator= (const Application&) = delete;
+	~Application();
+
+	[[nodiscard]] inline bool isOpen() const { return m_window != nullptr; }
+	[[nodiscard]] inline uint64_t framesDrawn() const { return m_framesDrawn; }
+
+	// Draws root filling the main viewport, with the notifications above it, until the window is closed.
+	int run(IWidget& root);
+
+	// Both can be called from any thread.
+	static void Wake();
+	static void RequestFrameIn(double seconds);
+
+	// Runs task on a thread of its own like std::async, but wakes the loop only once the returned future is ready, so
+	// the frame that follows sees the result. Finished threads are joined by later calls, the rest when the
+	// application closes.
+	template<typename F>
+	static std::future<std::invoke_result_t<F>> Async(F&& task) {
+		using Result = std::invoke_result_t<F>;
+		auto promise = std::make_shared<std::promise<Result>>();
+		auto result = promise->get_future();
+		KeepTask(std::async(std::launch::async, [promise, task = std::forward<F>(task)]() mutable {
+			try {
+				if constexpr (std::is_void_v<Result>) {
+					task();
+					promise->set_value();
+				} else {
+					promise->set_value(task());
+				}
+			} catch (...) {
+				promise->set_exception(std::current_exception());
+			}
+			Wake();
+		}));
+		return result;
+	}
+};
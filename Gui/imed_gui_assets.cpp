@@ -0,0 +1,14 @@
+#include "imed_gui_assets.hpp"
+
+#include <algorithm>
+
+const EmbeddedAsset* ImEdGui_FindAsset(std::string_view name) {
+	const auto assets = ImEdGui_EmbeddedAssets();
+	auto it = std::lower_bound(assets.begin(), assets.end(), name, [](const EmbeddedAsset& asset, std::string_view name) {
+		return asset.name < name;
+	});
+	if (it == assets.end() || it->name != name) {
+		return nullptr;
+	}
+	return &*it;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+#include <cstdint>
+
+// Images from assets/, decoded to RGBA8 at build time by imed-assetpack and linked into the executable.
+struct EmbeddedAsset {
+	std::string_view name;  // File name inside assets/, e.g. "folder.png"
+	int width, height;
+	const uint8_t* pixels;
+};
+
+// Sorted by name, defined in the generated imed_gui_assets_data.cpp.
+std::span<const EmbeddedAsset> ImEdGui_EmbeddedAssets();
+const EmbeddedAsset* ImEdGui_FindAsset(std::string_view name);
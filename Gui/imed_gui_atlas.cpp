@@ -0,0 +1,126 @@
+#include "imed_gui_atlas.hpp"
+
+#include "imgui/backends/imgui_impl_opengl3.h"
+
+#include <cstring>
+
+IconAtlas UiIcons;
+
+IconAtlas::RegionId IconAtlas::add(const uint8_t* pixels, int width, int height, int channels) {
+	if (pixels == nullptr || width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+		return InvalidRegion;
+	}
+
+	Region region { width, height, -1, false, { }, { }, { } };
+	region.pixels.resize(size_t(width) * size_t(height) * 4);
+	for (size_t i = 0, count = size_t(width) * size_t(height); i < count; i++) {
+		const uint8_t* src = pixels + i * size_t(channels);
+		uint8_t* dst = region.pixels.data() + i * 4;
+		switch (channels) {
+			case 1: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 0xFF; break;
+			case 2: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1]; break;
+			case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 0xFF; break;
+			default: std::memcpy(dst, src, 4); break;
+		}
+	}
+
+	m_regions.push_back(std::move(region));
+	m_dirty = true;
+	return RegionId(m_regions.size() - 1);
+}
+
+IconAtlas::RegionId IconAtlas::add(const std::filesystem::path& imagePath) {
+	int w, h, c;
+	auto pixels = stbi_load(imagePath.string().c_str(), &w, &h, &c, STBI_rgb_alpha);
+	if (pixels == nullptr) {
+		ImEdLog(fmt::format("Failed to load icon \"{}\": {}", imagePath.string(), stbi_failure_reason()), DebugMessageType::Error);
+		return InvalidRegion;
+	}
+	auto region = add(pixels, w, h, 4);
+	stbi_image_free(pixels);
+	return region;
+}
+
+IconAtlas::RegionId IconAtlas::add(const Image& image) {
+	if (image.id() == 0) {
+		return InvalidRegion;
+	}
+
+	GLint w = 0, h = 0;
+	glBindTexture(GL_TEXTURE_2D, image.id());
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+	std::vector<uint8_t> pixels(size_t(w) * size_t(h) * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Only the visible part of the source texture is copied.
+	const int x0 = int(image.uv0.x * float(w)), y0 = int(image.uv0.y * float(h));
+	const int x1 = int(image.uv1.x * float(w)), y1 = int(image.uv1.y * float(h));
+	if (x1 <= x0 || y1 <= y0) {
+		return InvalidRegion;
+	}
+	std::vector<uint8_t> cropped(size_t(x1 - x0) * size_t(y1 - y0) * 4);
+	for (int y = y0; y < y1; y++) {
+		std::memcpy(cropped.data() + size_t(y - y0) * size_t(x1 - x0) * 4,
+					pixels.data() + (size_t(y) * size_t(w) + size_t(x0)) * 4, size_t(x1 - x0) * 4);
+	}
+	return add(cropped.data(), x1 - x0, y1 - y0, 4);
+}
+
+bool IconAtlas::build() {
+	if (!m_dirty) {
+		return true;
+	}
+
+	auto& io = ImGui::GetIO();
+	auto* fonts = io.Fonts;
+	for (auto& region : m_regions) {
+		if (region.rect < 0) {
+			region.rect = fonts->AddCustomRectRegular(region.width, region.height);
+		}
+	}
+
+	// The backend only uploads once, so an existing texture has to be recreated with the new layout.
+	const bool uploaded = fonts->TexID != ImTextureID(0);
+	if (uploaded) {
+		ImGui_ImplOpenGL3_DestroyFontsTexture();
+	}
+	fonts->ClearTexData();
+	if (!fonts->Build()) {
+		ImEdLog("Failed to build the icon atlas", DebugMessageType::Error);
+		return false;
+	}
+
+	unsigned char* texPixels;
+	int texWidth, texHeight;
+	fonts->GetTexDataAsRGBA32(&texPixels, &texWidth, &texHeight);
+	for (auto& region : m_regions) {
+		const auto* rect = fonts->GetCustomRectByIndex(region.rect);
+		for (int y = 0; y < region.height; y++) {
+			std::memcpy(texPixels + (size_t(rect->Y + y) * size_t(texWidth) + rect->X) * 4,
+						region.pixels.data() + size_t(y) * size_t(region.width) * 4, size_t(region.width) * 4);
+		}
+		ImVec2 uv0, uv1;
+		fonts->CalcCustomRectUV(rect, &uv0, &uv1);
+		region.uv0 = uv0;
+		region.uv1 = uv1;
+		region.packed = true;
+	}
+
+	if (uploaded) {
+		ImGui_ImplOpenGL3_CreateFontsTexture();
+	}
+	m_dirty = false;
+	m_generation++;
+	return true;
+}
+
+Image IconAtlas::image(RegionId region) const {
+	if (!isPacked(region)) {
+		return { };
+	}
+	const auto& r = m_regions[region];
+	return Image::FromTexture(GLuint(intptr_t(ImGui::GetIO().Fonts->TexID)), r.uv0, r.uv1);
+}
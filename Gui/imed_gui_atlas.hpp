@@ -0,0 +1,52 @@
+#pragma once
+
+#include "imed_gui_types.hpp"
+
+#include <filesystem>
+#include <vector>
+#include <cstdint>
+
+// Packs small UI images into the ImGui font atlas, so icons and text are drawn from one texture
+// and consecutive rows of the same window batch into a single draw call.
+class IconAtlas {
+public:
+	using RegionId = uint32_t;
+	static constexpr RegionId InvalidRegion = UINT32_MAX;
+private:
+	struct Region {
+		int width, height;
+		int rect = -1;
+		bool packed = false;
+		std::vector<uint8_t> pixels;    // RGBA, kept so the atlas can be rebuilt when regions are added
+		Vec2 uv0, uv1;
+	};
+
+	std::vector<Region> m_regions;
+	bool m_dirty = false;
+	uint64_t m_generation = 0;
+public:
+	IconAtlas() = default;
+	IconAtlas(const IconAtlas&) = delete;
+
+	RegionId add(const uint8_t* pixels, int width, int height, int channels);
+	RegionId add(const std::filesystem::path& imagePath);
+	// Reads the texture back from the GPU, for images that were uploaded on their own.
+	RegionId add(const Image& image);
+
+	[[nodiscard]] inline bool needsRebuild() const { return m_dirty; }
+	// Regions added since the last build are not, the others stay valid until it.
+	[[nodiscard]] inline bool isPacked(RegionId region) const {
+		return region < m_regions.size() && m_regions[region].packed;
+	}
+	[[nodiscard]] inline size_t size() const { return m_regions.size(); }
+	// Bumped by every build, glyph and icon UVs from before are stale.
+	[[nodiscard]] inline uint64_t generation() const { return m_generation; }
+
+	// Repacks the font atlas with every region, must be called outside of a frame (before the backend's NewFrame).
+	bool build();
+
+	// Non-owning handle into the atlas texture, only valid until the next build.
+	[[nodiscard]] Image image(RegionId region) const;
+};
+
+extern IconAtlas UiIcons;
@@ -1,12 +1,12 @@
-#include "imed_common.hpp"
+#include "imed_gui_common.hpp"
+#include "imed_gui_logger.hpp"
+#include "imed_gui_notifications.hpp"
 
 #include "ImEdNativeDiag.hpp"
 
 #include <chrono>
 #include <fmt/format.h>
 
-#if !defined(IMED_CORE)
-
 template<>
 struct fmt::formatter<DebugMessageType> : public fmt::formatter<std::string_view> {
 	auto format(DebugMessageType value, fmt::format_context& ctx) {
@@ -21,32 +21,28 @@ struct fmt::formatter<DebugMessageType> : public fmt::formatter<std::string_view
 	}
 };
 
+// The only definition, Core declares the same function and links against this one.
 void ImEdLogImpl(const std::string& message, DebugMessageType messageType, DebugInfo debugInfo) {
 #ifdef NDEBUG
-	if (messageType == DebugMessageType::Error || messageType == DebugMessageType::FatalError) {
-#endif
-	auto date = std::chrono::system_clock::now();
-	auto fmsg = fmt::format("{} [{}] {}:{} {} - {}",
-							date,
-							messageType,
-							debugInfo.callerFile, debugInfo.callerLine, debugInfo.callerFunction,
-							message);
-	printf("%s\n", fmsg.c_str());
-
-#ifndef NDEBUG
-	if (messageType == DebugMessageType::Error || messageType == DebugMessageType::FatalError) {
-#endif
-		MessageBox::Error("Error!", fmsg);
-#ifndef NDEBUG
+	if (messageType != DebugMessageType::Error && messageType != DebugMessageType::FatalError) {
+		return;
 	}
 #endif
-
-	if (messageType == DebugMessageType::FatalError) {
+	Logger.log(messageType, debugInfo, message);
+
+	// Errors become toasts drawn by the render loop, the logging thread never waits on a dialog.
+	if (messageType == DebugMessageType::Error) {
+		Notifications.post(messageType, debugInfo, message);
+	} else if (messageType == DebugMessageType::FatalError) {
+		// The process exits right away, there will be no frame to show a toast in.
+		auto date = std::chrono::system_clock::now();
+		auto fmsg = fmt::format("{} [{}] {}:{} {} - {}",
+								date,
+								messageType,
+								debugInfo.callerFile, debugInfo.callerLine, debugInfo.callerFunction,
+								message);
+		MessageBox::Error("Error!", fmsg);
+		Logger.flush();
 		exit(1);
 	}
-
-#ifdef NDEBUG
-	}
-#endif
 }
-#endif
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "imed_gui_console.hpp"
+#include "imed_gui_search.hpp"
+#include "imed_gui_app.hpp"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+
+// Lines checked per lock of the history, the drain thread waits at most this long to append.
+static constexpr uint64_t FilterChunkLines = 4096;
+static constexpr const char* LevelNames[] = { "All", "Warning", "Error" };
+static constexpr DebugMessageType LevelTypes[] = { DebugMessageType::Info, DebugMessageType::Warning, DebugMessageType::Error };
+
+static char ToLowerAscii(char c) {
+	return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static bool LevelColor(DebugMessageType type, ImVec4& color) {
+	switch (type) {
+		case DebugMessageType::FatalError:
+		case DebugMessageType::Error: color = Color(0xF0605AFF); return true;
+		case DebugMessageType::Warning: color = Color(0xE8B040FF); return true;
+		default: return false;
+	}
+}
+
+LogConsole::LogConsole(AsyncLogger& logger): m_history(logger.enableHistory()) {
+	auto lock = m_history->lock();
+	m_history->OnAppend = Application::Wake;
+}
+
+LogConsole::~LogConsole() {
+	if (m_cancel != nullptr) {
+		m_cancel->store(true);
+	}
+}
+
+void LogConsole::setFilter(DebugMessageType minLevel, std::string_view query) {
+	if (minLevel == m_minLevel && query.size() == m_query.size() &&
+		std::equal(query.begin(), query.end(), m_query.begin(), [](char a, char b) { return ToLowerAscii(a) == b; })) {
+		return;
+	}
+	m_minLevel = minLevel;
+	// Kept lowercase, the search ignores case.
+	m_query.resize(query.size());
+	std::transform(query.begin(), query.end(), m_query.begin(), ToLowerAscii);
+	m_generation++;
+	markDirty();
+	m_matches.clear();
+	m_matchBegin = 0;
+	m_filteredEnd = 0;
+	// A running pass is not waited for, its result is dropped by generation once it notices.
+	if (m_cancel != nullptr) {
+		m_cancel->store(true);
+	}
+}
+
+LogConsole::FilterResult LogConsole::Filter(std::shared_ptr<LogHistory> history, uint64_t from, DebugMessageType minLevel, std::string query,
+	uint64_t generation, std::shared_ptr<std::atomic<bool>> cancel) {
+	FilterResult result { generation, from, { } };
+	uint64_t end;
+	{
+		auto lock = history->lock();
+		end = history->endLine();
+	}
+	while (result.end < end && !cancel->load(std::memory_order_relaxed)) {
+		auto lock = history->lock();
+		// Lines dropped while the lock was released are skipped.
+		uint64_t line = std::max(result.end, history->firstLine());
+		const uint64_t chunkEnd = std::min(end, line + FilterChunkLines);
+		for (; line < chunkEnd; line++) {
+			if (history->type(line) < minLevel) {
+				continue;
+			}
+			if (query.empty() || WorkspaceSearch::FindLiteral(history->text(line), 0, query, true) != std::string_view::npos) {
+				result.matches.push_back(line);
+			}
+		}
+		result.end = chunkEnd;
+	}
+	return result;
+}
+
+void LogConsole::pollFilter() {
+	if (m_filter.valid() && m_filter.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		auto result = m_filter.get();
+		if (result.generation == m_generation) {
+			m_matches.insert(m_matches.end(), result.matches.begin(), result.matches.end());
+			m_filteredEnd = result.end;
+		}
+	}
+	if (!isFiltered() || m_filter.valid()) {
+		return;
+	}
+
+	uint64_t end;
+	{
+		auto lock = m_history->lock();
+		end = m_history->endLine();
+	}
+	if (m_filteredEnd < end) {
+		m_cancel = std::make_shared<std::atomic<bool>>(false);
+		m_filter = Application::Async([history = m_history, from = m_filteredEnd, minLevel = m_minLevel, query = m_query, generation = m_generation,
+			cancel = m_cancel]() {
+			return Filter(history, from, minLevel, query, generation, cancel);
+		});
+	}
+}
+
+bool LogConsole::isDirty() const {
+	if (IWidget::isDirty() || (m_filter.valid() && m_filter.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+		return true;
+	}
+	auto lock = m_history->lock();
+	return m_history->endLine() != m_shownEnd;
+}
+
+void LogConsole::show() {
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 7.0f);
+	bool changed = ImGui::Combo("##Level", &m_levelInput, LevelNames, int(std::size(LevelNames)));
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 16.0f);
+	changed |= ImGui::InputTextWithHint("##Filter", "Filter", m_queryInput, sizeof(m_queryInput));
+	if (changed) {
+		setFilter(LevelTypes[m_levelInput], m_queryInput);
+	}
+	ImGui::SameLine();
+	ImGui::Checkbox("Follow", &follow);
+	pollFilter();
+
+	auto lock = m_history->lock();
+	const uint64_t first = m_history->firstLine();
+	const uint64_t end = m_history->endLine();
+	ImGui::SameLine();
+	if (!isFiltered()) {
+		ImGui::TextDisabled("%llu lines", static_cast<unsigned long long>(end - first));
+	} else {
+		ImGui::TextDisabled(isFiltering() ? "%llu matches, filtering" : "%llu matches", static_cast<unsigned long long>(m_matches.size() - m_matchBegin));
+	}
+
+	// Rows dropped from the front this frame, so a view scrolled up stays on the same lines.
+	uint64_t dropped = 0;
+	if (isFiltered()) {
+		const auto kept = std::lower_bound(m_matches.begin() + ptrdiff_t(m_matchBegin), m_matches.end(), first);
+		dropped = uint64_t(kept - m_matches.begin()) - m_matchBegin;
+		m_matchBegin = size_t(kept - m_matches.begin());
+		if (m_matchBegin > m_matches.size() / 2) {
+			m_matches.erase(m_matches.begin(), kept);
+			m_matchBegin = 0;
+		}
+	} else {
+		dropped = first > m_shownFirst ? first - m_shownFirst : 0;
+	}
+	m_shownFirst = first;
+	// New lines scroll into view on the next frame.
+	if (end != m_shownEnd) {
+		markDirty();
+	}
+	m_shownEnd = end;
+	const uint64_t rows = isFiltered() ? m_matches.size() - m_matchBegin : end - first;
+
+	ImGui::BeginChild("##ConsoleLines", { 0.0f, 0.0f }, ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar);
+	const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+	const bool pinned = ImGui::GetScrollY() >= ImGui::GetScrollMaxY() - lineHeight * 0.5f;
+	if (!pinned && dropped != 0) {
+		ImGui::SetScrollY(std::max(0.0f, ImGui::GetScrollY() - float(dropped) * lineHeight));
+	}
+
+	ImGuiListClipper clipper;
+	clipper.Begin(int(rows), lineHeight);
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const uint64_t line = isFiltered() ? m_matches[m_matchBegin + size_t(row)] : first + uint64_t(row);
+			const std::string_view text = m_history->text(line);
+			ImVec4 color;
+			const bool colored = LevelColor(m_history->type(line), color);
+			if (colored) {
+				ImGui::PushStyleColor(ImGuiCol_Text, color);
+			}
+			ImGui::TextUnformatted(text.data(), text.data() + text.size());
+			if (colored) {
+				ImGui::PopStyleColor();
+			}
+		}
+	}
+	clipper.End();
+	lock.unlock();
+
+	if (follow && pinned) {
+		ImGui::SetScrollHereY(1.0f);
+	}
+	ImGui::EndChild();
+}
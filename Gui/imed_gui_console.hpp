@@ -0,0 +1,57 @@
+#pragma once
+
+#include "imed_gui_layout.hpp"
+#include "imed_gui_logger.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Shows the logger's history while it is being written. Rows are read straight out of the history ring, only the
+// visible ones, under its lock. A level or text filter collects the matching line numbers on a background thread,
+// over the whole history first and then over each batch of new lines. Memory stays within the history capacity
+// plus one line number per line it holds.
+class LogConsole : public IWidget {
+	struct FilterResult {
+		uint64_t generation;
+		uint64_t end;               // Lines before it were filtered
+		std::vector<uint64_t> matches;
+	};
+
+	std::shared_ptr<LogHistory> m_history;
+	DebugMessageType m_minLevel = DebugMessageType::Info;
+	std::string m_query;
+	char m_queryInput[256] = { };
+	int m_levelInput = 0;
+
+	std::vector<uint64_t> m_matches;
+	size_t m_matchBegin = 0;        // Matches before it were dropped from the history
+	uint64_t m_filteredEnd = 0;
+	uint64_t m_generation = 0;      // Bumped when the filter changes, older results are thrown away
+	std::future<FilterResult> m_filter;
+	std::shared_ptr<std::atomic<bool>> m_cancel;
+	uint64_t m_shownFirst = 0;
+	uint64_t m_shownEnd = 0;
+
+	void pollFilter();
+	static FilterResult Filter(std::shared_ptr<LogHistory> history, uint64_t from, DebugMessageType minLevel, std::string query,
+		uint64_t generation, std::shared_ptr<std::atomic<bool>> cancel);
+public:
+	bool follow = true;
+
+	explicit LogConsole(AsyncLogger& logger = Logger);
+	~LogConsole();
+
+	void setFilter(DebugMessageType minLevel, std::string_view query);
+	[[nodiscard]] inline bool isFiltered() const { return m_minLevel != DebugMessageType::Info || !m_query.empty(); }
+	// The filter has not caught up with the history yet.
+	[[nodiscard]] inline bool isFiltering() const { return m_filter.valid(); }
+
+	// Also dirty when lines were appended or a filter pass finished since the last show().
+	[[nodiscard]] bool isDirty() const override;
+	void show() override;
+};
@@ -0,0 +1,135 @@
+#include "imed_gui_drawcache.hpp"
+#include "imed_gui_atlas.hpp"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cstring>
+#include <climits>
+
+static bool SameVec(const ImVec2& a, const ImVec2& b) {
+	return a.x == b.x && a.y == b.y;
+}
+
+static bool SameRect(const ImVec4& a, const ImVec4& b) {
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+bool CachedWidget::Key::operator== (const Key& other) const {
+	return content == other.content && SameVec(origin, other.origin) && SameRect(clipRect, other.clipRect) &&
+		availableWidth == other.availableWidth && font == other.font && fontSize == other.fontSize &&
+		fontTexture == other.fontTexture && atlasGeneration == other.atlasGeneration;
+}
+
+CachedWidget::Key CachedWidget::currentKey() const {
+	const ImDrawList* drawList = ImGui::GetWindowDrawList();
+	const ImVec2 clipMin = drawList->GetClipRectMin();
+	const ImVec2 clipMax = drawList->GetClipRectMax();
+	return {
+		content.get(), ImGui::GetCursorScreenPos(), ImVec4(clipMin.x, clipMin.y, clipMax.x, clipMax.y),
+		ImGui::GetContentRegionAvail().x, ImGui::GetFont(), ImGui::GetFontSize(), ImGui::GetIO().Fonts->TexID,
+		UiIcons.generation()
+	};
+}
+
+void CachedWidget::invalidate() {
+	m_recorded = false;
+	m_vertices.clear();
+	m_indices.clear();
+	m_segments.clear();
+	markDirty();
+}
+
+bool CachedWidget::record(const ImDrawList* drawList, int firstCommand, unsigned int firstIndex, const ImVec2& origin) {
+	m_vertices.clear();
+	m_indices.clear();
+	m_segments.clear();
+	// Channels are merged out of order later, their commands can not be told apart from the window's own.
+	if (drawList->_Splitter._Count > 1) {
+		return false;
+	}
+
+	const auto indexEnd = unsigned(drawList->IdxBuffer.Size);
+	float right = origin.x;
+	// Starting one early, an empty command can be merged back into the one before it when the content changes state.
+	for (int i = std::max(firstCommand - 1, 0); i < drawList->CmdBuffer.Size; i++) {
+		const ImDrawCmd& command = drawList->CmdBuffer[i];
+		// The first commands may hold elements from before the content.
+		const unsigned begin = std::max(command.IdxOffset, firstIndex);
+		const unsigned end = std::min(command.IdxOffset + command.ElemCount, indexEnd);
+		if (begin >= end) {
+			continue;
+		}
+		if (command.UserCallback != nullptr) {
+			return false;
+		}
+
+		unsigned lowest = UINT_MAX, highest = 0;
+		for (unsigned k = begin; k < end; k++) {
+			lowest = std::min<unsigned>(lowest, drawList->IdxBuffer[int(k)]);
+			highest = std::max<unsigned>(highest, drawList->IdxBuffer[int(k)]);
+		}
+		const Segment segment { command.ClipRect, command.TextureId, uint32_t(m_vertices.size()), highest - lowest + 1,
+			uint32_t(m_indices.size()), end - begin };
+		const ImDrawVert* vertices = drawList->VtxBuffer.Data + command.VtxOffset + lowest;
+		m_vertices.insert(m_vertices.end(), vertices, vertices + segment.vertexCount);
+		for (unsigned k = begin; k < end; k++) {
+			m_indices.push_back(ImDrawIdx(drawList->IdxBuffer[int(k)] - lowest));
+		}
+		for (uint32_t v = 0; v < segment.vertexCount; v++) {
+			right = std::max(right, vertices[v].pos.x);
+		}
+		m_segments.push_back(segment);
+	}
+
+	// The cursor ends on the line after the content, the item spacing below it is added back by Dummy().
+	const float bottom = ImGui::GetCursorScreenPos().y - ImGui::GetStyle().ItemSpacing.y;
+	m_size = ImVec2(right - origin.x, std::max(0.0f, bottom - origin.y));
+	return true;
+}
+
+void CachedWidget::replay(ImDrawList* drawList) const {
+	for (const auto& segment : m_segments) {
+		// Merged into the current command when clip rect and texture are the same, which is the usual case.
+		drawList->PushClipRect(ImVec2(segment.clipRect.x, segment.clipRect.y), ImVec2(segment.clipRect.z, segment.clipRect.w));
+		drawList->PushTextureID(segment.texture);
+		drawList->PrimReserve(int(segment.indexCount), int(segment.vertexCount));
+		std::memcpy(drawList->_VtxWritePtr, m_vertices.data() + segment.vertexBegin, segment.vertexCount * sizeof(ImDrawVert));
+		// Read after PrimReserve, which starts a new vertex offset once 16-bit indices run out.
+		const unsigned base = drawList->_VtxCurrentIdx;
+		const ImDrawIdx* indices = m_indices.data() + segment.indexBegin;
+		for (uint32_t i = 0; i < segment.indexCount; i++) {
+			drawList->_IdxWritePtr[i] = ImDrawIdx(base + indices[i]);
+		}
+		drawList->_VtxWritePtr += segment.vertexCount;
+		drawList->_IdxWritePtr += segment.indexCount;
+		drawList->_VtxCurrentIdx += segment.vertexCount;
+		drawList->PopTextureID();
+		drawList->PopClipRect();
+	}
+	if (m_size.x > 0.0f || m_size.y > 0.0f) {
+		ImGui::Dummy(m_size);
+	}
+}
+
+void CachedWidget::show() {
+	if (content == nullptr) {
+		return;
+	}
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	const Key key = currentKey();
+	const ImGuiStyle& style = ImGui::GetStyle();
+	// Compared as bytes, a spurious difference in padding only costs a recording.
+	const bool sameStyle = std::memcmp(&style, m_style.data(), sizeof(ImGuiStyle)) == 0;
+	if (m_recorded && sameStyle && key == m_key && !content->isDirty() && drawList->_Splitter._Count <= 1) {
+		replay(drawList);
+		return;
+	}
+
+	const int firstCommand = drawList->CmdBuffer.Size - 1;
+	const auto firstIndex = unsigned(drawList->IdxBuffer.Size);
+	content->draw();
+	m_recorded = record(drawList, firstCommand, firstIndex, key.origin);
+	m_key = key;
+	std::memcpy(m_style.data(), &style, sizeof(ImGuiStyle));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "imed_gui_layout.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Keeps the draw output of a subtree that rarely changes, like headers, static labels or long BulletPoints. While the
+// content is clean and nothing it was drawn with changed (position, clip rect, available width, style, font, atlas),
+// its recorded vertices and indices are copied into the window's draw list instead of running show() again.
+// Replayed frames submit no items, so the content must not be interactive, and it has to draw into the current
+// window only, child windows and popups are not recorded. Content using tables or columns is drawn every frame.
+class CachedWidget : public IWidget {
+	struct Key {
+		const IWidget* content;
+		ImVec2 origin;
+		ImVec4 clipRect;
+		float availableWidth;
+		const ImFont* font;
+		float fontSize;
+		ImTextureID fontTexture;
+		uint64_t atlasGeneration;
+
+		[[nodiscard]] bool operator== (const Key& other) const;
+	};
+	struct Segment {
+		ImVec4 clipRect;
+		ImTextureID texture;
+		uint32_t vertexBegin, vertexCount;
+		uint32_t indexBegin, indexCount;
+	};
+
+	std::vector<ImDrawVert> m_vertices;
+	std::vector<ImDrawIdx> m_indices;       // Relative to the first vertex of their segment
+	std::vector<Segment> m_segments;
+	ImVec2 m_size = { 0.0f, 0.0f };         // Layout space the content took, taken by a dummy item on replay
+	Key m_key = { };
+	std::array<std::byte, sizeof(ImGuiStyle)> m_style = { };
+	bool m_recorded = false;
+
+	bool record(const ImDrawList* drawList, int firstCommand, unsigned int firstIndex, const ImVec2& origin);
+	void replay(ImDrawList* drawList) const;
+	[[nodiscard]] Key currentKey() const;
+public:
+	std::shared_ptr<IWidget> content;
+
+	explicit CachedWidget(std::shared_ptr<IWidget> content): content(std::move(content)) { }
+
+	// Drops the recording, the next show() draws the content again. Only needed for changes nothing is keyed on.
+	void invalidate();
+	[[nodiscard]] inline bool isRecorded() const { return m_recorded; }
+	[[nodiscard]] inline size_t recordedBytes() const {
+		return m_vertices.size() * sizeof(ImDrawVert) + m_indices.size() * sizeof(ImDrawIdx) + m_segments.size() * sizeof(Segment);
+	}
+
+	[[nodiscard]] inline bool isDirty() const override { return IWidget::isDirty() || (content != nullptr && content->isDirty()); }
+	void show() override;
+};
@@ -0,0 +1,579 @@
+#include "imed_gui_filetree.hpp"
+#include "imed_gui_common.hpp"
+#include "imed_gui_logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+static constexpr char SnapshotMagic[8] = { 'I', 'M', 'E', 'D', 'T', 'R', 'E', 'E' };
+
+std::string_view StringArena::intern(std::string_view str) {
+	if (auto it = m_strings.find(str); it != m_strings.end()) {
+		return *it;
+	}
+
+	const size_t required = str.size() + 1;
+	char* storage;
+	if (required > BlockSize) {
+		// Oversized strings get their own block, kept behind the block that is still being filled.
+		auto block = std::make_unique<char[]>(required);
+		storage = block.get();
+		m_blocks.insert(m_blocks.empty() ? m_blocks.end() : m_blocks.end() - 1, std::move(block));
+		m_allocated += required;
+	} else {
+		if (m_used + required > BlockSize) {
+			m_blocks.push_back(std::make_unique<char[]>(BlockSize));
+			m_used = 0;
+			m_allocated += BlockSize;
+		}
+		storage = m_blocks.back().get() + m_used;
+		m_used += required;
+	}
+
+	std::memcpy(storage, str.data(), str.size());
+	storage[str.size()] = '\0';
+
+	std::string_view interned { storage, str.size() };
+	m_strings.insert(interned);
+	return interned;
+}
+
+FileTree::FileTree(const std::filesystem::path& rootPath): m_rootPath(rootPath) {
+	auto rootName = rootPath.filename().string();
+	if (rootName.empty()) {
+		rootName = rootPath.string();
+	}
+	allocate(InvalidNode, rootName, NodeFlags_Directory);
+}
+
+FileTree::NodeId FileTree::allocate(NodeId parent, std::string_view name, uint8_t flags) {
+	auto interned = InternedPaths.component(name);
+	auto node = NodeId(m_parent.size());
+
+	m_parent.push_back(parent);
+	m_firstChild.push_back(InvalidNode);
+	m_nextSibling.push_back(InvalidNode);
+	m_name.push_back(interned.data());
+	m_nameLength.push_back(uint16_t(std::min<size_t>(interned.size(), UINT16_MAX)));
+	m_flags.push_back(flags);
+	m_stat.emplace_back();
+	return node;
+}
+
+FileTree::NodeId FileTree::prependChild(NodeId parent, std::string_view name, bool isDirectory) {
+	auto node = allocate(parent, name, isDirectory ? NodeFlags_Directory : NodeFlags_None);
+	m_nextSibling[node] = m_firstChild[parent];
+	m_firstChild[parent] = node;
+	return node;
+}
+
+bool FileTree::sortsBefore(NodeId lhs, NodeId rhs) const {
+	if (isDirectory(lhs) != isDirectory(rhs)) {
+		return isDirectory(lhs);
+	}
+	return nameView(lhs) < nameView(rhs);
+}
+
+void FileTree::link(NodeId parent, NodeId node) {
+	m_parent[node] = parent;
+
+	NodeId previous = InvalidNode;
+	NodeId current = m_firstChild[parent];
+	while (current != InvalidNode && sortsBefore(current, node)) {
+		previous = current;
+		current = m_nextSibling[current];
+	}
+	m_nextSibling[node] = current;
+	if (previous == InvalidNode) {
+		m_firstChild[parent] = node;
+	} else {
+		m_nextSibling[previous] = node;
+	}
+}
+
+void FileTree::unlink(NodeId node) {
+	const auto parent = m_parent[node];
+	if (parent == InvalidNode) {
+		return;
+	}
+	if (m_firstChild[parent] == node) {
+		m_firstChild[parent] = m_nextSibling[node];
+	} else {
+		for (auto current = m_firstChild[parent]; current != InvalidNode; current = m_nextSibling[current]) {
+			if (m_nextSibling[current] == node) {
+				m_nextSibling[current] = m_nextSibling[node];
+				break;
+			}
+		}
+	}
+	m_nextSibling[node] = InvalidNode;
+	m_parent[node] = InvalidNode;
+}
+
+FileTree::NodeId FileTree::insertChild(NodeId parent, std::string_view name, bool isDirectory) {
+	if (auto existing = findChild(parent, name); existing != InvalidNode) {
+		return existing;
+	}
+	auto node = allocate(parent, name, isDirectory ? NodeFlags_Directory : NodeFlags_None);
+	link(parent, node);
+	return node;
+}
+
+void FileTree::remove(NodeId node) {
+	if (node == Root || isRemoved(node)) {
+		return;
+	}
+	unlink(node);
+
+	// Removed nodes keep their slot so ids held elsewhere never point at a different file.
+	std::vector<NodeId> stack { node };
+	while (!stack.empty()) {
+		auto current = stack.back();
+		stack.pop_back();
+		m_flags[current] |= NodeFlags_Removed;
+		for (auto child = m_firstChild[current]; child != InvalidNode; child = m_nextSibling[child]) {
+			stack.push_back(child);
+		}
+	}
+}
+
+void FileTree::move(NodeId node, NodeId newParent, std::string_view newName) {
+	if (node == Root || isRemoved(node)) {
+		return;
+	}
+	if (auto existing = findChild(newParent, newName); existing != InvalidNode && existing != node) {
+		remove(existing);
+	}
+	unlink(node);
+
+	auto interned = InternedPaths.component(newName);
+	m_name[node] = interned.data();
+	m_nameLength[node] = uint16_t(std::min<size_t>(interned.size(), UINT16_MAX));
+	link(newParent, node);
+}
+
+FileTree::NodeId FileTree::findChild(NodeId parent, std::string_view name) const {
+	for (auto child = m_firstChild[parent]; child != InvalidNode; child = m_nextSibling[child]) {
+		if (nameView(child) == name) {
+			return child;
+		}
+	}
+	return InvalidNode;
+}
+
+FileTree::NodeId FileTree::find(std::string_view relativePath) const {
+	NodeId node = Root;
+	while (!relativePath.empty() && node != InvalidNode) {
+		auto separator = relativePath.find('/');
+		node = findChild(node, relativePath.substr(0, separator));
+		relativePath = separator == std::string_view::npos ? std::string_view { } : relativePath.substr(separator + 1);
+	}
+	return node;
+}
+
+std::string FileTree::relativePathOf(NodeId node) const {
+	std::vector<NodeId> chain;
+	for (auto current = node; current != Root && current != InvalidNode; current = m_parent[current]) {
+		chain.push_back(current);
+	}
+
+	std::string path;
+	for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+		if (!path.empty()) {
+			path.push_back('/');
+		}
+		path.append(nameView(*it));
+	}
+	return path;
+}
+
+PathInterner::PathId FileTree::pathIdOf(NodeId node) const {
+	std::vector<NodeId> chain;
+	for (auto current = node; current != Root && current != InvalidNode; current = m_parent[current]) {
+		chain.push_back(current);
+	}
+
+	auto path = PathInterner::EmptyPath;
+	for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+		path = InternedPaths.child(path, nameView(*it));
+	}
+	return path;
+}
+
+static std::pair<std::string_view, std::string_view> SplitParent(std::string_view relativePath) {
+	auto separator = relativePath.rfind('/');
+	if (separator == std::string_view::npos) {
+		return { { }, relativePath };
+	}
+	return { relativePath.substr(0, separator), relativePath.substr(separator + 1) };
+}
+
+std::vector<FileEvent> FileTree::applyEvents(const std::vector<FileEvent>& events, std::vector<NodeId>& touched) {
+	std::vector<FileEvent> applied;
+	auto create = [&](NodeId parent, std::string_view name, const FileEvent& event) {
+		if (parent == InvalidNode || !isDirectory(parent)) {
+			return;
+		}
+		if (findChild(parent, name) == InvalidNode) {
+			insertChild(parent, name, event.isDirectory);
+			touched.push_back(parent);
+			applied.push_back({ FileEventType::Created, event.isDirectory, event.path, { } });
+		} else if (!event.isDirectory) {
+			applied.push_back({ FileEventType::Modified, false, event.path, { } });
+		}
+	};
+
+	for (const auto& event : events) {
+		switch (event.type) {
+			case FileEventType::Created: {
+				auto [parentPath, name] = SplitParent(event.path);
+				create(find(parentPath), name, event);
+			} break;
+			case FileEventType::Deleted: {
+				auto node = find(event.path);
+				if (node != InvalidNode && node != Root) {
+					touched.push_back(m_parent[node]);
+					remove(node);
+					applied.push_back(event);
+				}
+			} break;
+			case FileEventType::Renamed: {
+				auto node = find(event.oldPath);
+				auto [parentPath, name] = SplitParent(event.path);
+				auto parent = find(parentPath);
+				if (node == InvalidNode || node == Root) {
+					create(parent, name, event);
+				} else if (parent == InvalidNode) {
+					touched.push_back(m_parent[node]);
+					remove(node);
+					applied.push_back({ FileEventType::Deleted, event.isDirectory, event.oldPath, { } });
+				} else {
+					// Replacing a file drops it, listeners have to forget it before the moved one takes its path.
+					if (auto existing = findChild(parent, name); existing != InvalidNode && existing != node) {
+						applied.push_back({ FileEventType::Deleted, isDirectory(existing), event.path, { } });
+					}
+					touched.push_back(m_parent[node]);
+					move(node, parent, name);
+					touched.push_back(parent);
+					applied.push_back(event);
+				}
+			} break;
+			case FileEventType::Modified:
+				if (find(event.path) != InvalidNode) {
+					applied.push_back(event);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	return applied;
+}
+
+std::vector<FileEvent> FileTree::diff(const std::vector<ScanEntry>& entries, std::vector<FileStat>* stats) const {
+	std::vector<FileEvent> events;
+	auto paths = WorkspaceScanner::ResolvePaths(entries);
+
+	// Sorted order puts every directory in front of its contents, so creates apply top-down.
+	std::vector<size_t> order(entries.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order.at(i) = i;
+	}
+	std::sort(order.begin(), order.end(), [&paths](size_t a, size_t b) { return paths.at(a) < paths.at(b); });
+
+	// One walk resolves every live node's path, each scanned entry is then a single lookup instead of a find().
+	std::vector<std::string> treePaths(size());
+	std::unordered_map<std::string_view, NodeId> nodes;
+	nodes.reserve(size());
+	std::vector<NodeId> stack = { Root };
+	while (!stack.empty()) {
+		const auto node = stack.back();
+		stack.pop_back();
+		for (auto child = m_firstChild[node]; child != InvalidNode; child = m_nextSibling[child]) {
+			treePaths[child] = node == Root ? std::string(nameView(child)) : treePaths[node] + '/' + std::string(nameView(child));
+			nodes.emplace(treePaths[child], child);
+			if (isDirectory(child)) {
+				stack.push_back(child);
+			}
+		}
+	}
+
+	enum : uint8_t { Missing, Kept, Replaced };
+	std::vector<uint8_t> state(size(), Missing);
+	for (auto index : order) {
+		const auto& path = paths.at(index);
+		const auto& entry = entries.at(index);
+		const FileStat scanned { entry.size, entry.mtime };
+		auto it = nodes.find(path);
+		if (it == nodes.end()) {
+			events.push_back(FileEvent { FileEventType::Created, entry.isDirectory(), path, { } });
+			if (stats != nullptr) stats->push_back(scanned);
+			continue;
+		}
+		const auto node = it->second;
+		if (isDirectory(node) != entry.isDirectory()) {
+			state[node] = Replaced;
+			events.push_back(FileEvent { FileEventType::Deleted, isDirectory(node), path, { } });
+			events.push_back(FileEvent { FileEventType::Created, entry.isDirectory(), path, { } });
+			if (stats != nullptr) stats->insert(stats->end(), { FileStat { }, scanned });
+			continue;
+		}
+		state[node] = Kept;
+		if (stats != nullptr && !entry.isDirectory() && m_stat[node] != scanned) {
+			events.push_back(FileEvent { FileEventType::Modified, false, path, { } });
+			stats->push_back(scanned);
+		}
+	}
+
+	// Only the topmost missing node is reported, deleting it takes its contents along.
+	stack = { Root };
+	while (!stack.empty()) {
+		const auto node = stack.back();
+		stack.pop_back();
+		for (auto child = m_firstChild[node]; child != InvalidNode; child = m_nextSibling[child]) {
+			if (state[child] == Missing) {
+				events.push_back(FileEvent { FileEventType::Deleted, isDirectory(child), std::move(treePaths[child]), { } });
+				if (stats != nullptr) stats->emplace_back();
+			} else if (state[child] == Kept && isDirectory(child)) {
+				stack.push_back(child);
+			}
+		}
+	}
+	return events;
+}
+
+std::filesystem::path FileTree::pathOf(NodeId node) const {
+	std::vector<NodeId> chain;
+	for (auto current = node; current != Root && current != InvalidNode; current = m_parent[current]) {
+		chain.push_back(current);
+	}
+
+	auto path = m_rootPath;
+	for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+		path /= std::filesystem::u8path(nameView(*it));
+	}
+	return path;
+}
+
+size_t FileTree::memoryUsage() const {
+	return m_parent.capacity() * sizeof(NodeId) +
+		   m_firstChild.capacity() * sizeof(NodeId) +
+		   m_nextSibling.capacity() * sizeof(NodeId) +
+		   m_name.capacity() * sizeof(const char*) +
+		   m_nameLength.capacity() * sizeof(uint16_t) +
+		   m_flags.capacity() * sizeof(uint8_t) +
+		   m_stat.capacity() * sizeof(FileStat);
+}
+
+FileTree FileTree::FromScan(const std::filesystem::path& rootPath, const std::vector<ScanEntry>& entries) {
+	FileTree tree { rootPath };
+
+	// Workers finish directories in no particular order, group the entries by parent before linking.
+	std::vector<std::vector<size_t>> children;
+	for (size_t i = 0; i < entries.size(); i++) {
+		const auto& entry = entries.at(i);
+		if (entry.parent >= children.size()) {
+			children.resize(entry.parent + 1);
+		}
+		children.at(entry.parent).push_back(i);
+	}
+
+	tree.m_parent.reserve(entries.size() + 1);
+	tree.m_firstChild.reserve(entries.size() + 1);
+	tree.m_nextSibling.reserve(entries.size() + 1);
+	tree.m_name.reserve(entries.size() + 1);
+	tree.m_nameLength.reserve(entries.size() + 1);
+	tree.m_flags.reserve(entries.size() + 1);
+	tree.m_stat.reserve(entries.size() + 1);
+
+	std::vector<std::pair<uint32_t, NodeId>> stack = { { WorkspaceScanner::RootDirectory, Root } };
+	while (!stack.empty()) {
+		auto [directory, node] = stack.back();
+		stack.pop_back();
+		if (directory >= children.size()) {
+			continue;
+		}
+
+		auto& siblings = children.at(directory);
+		std::sort(siblings.begin(), siblings.end(), [&entries](size_t a, size_t b) {
+			const auto& lhs = entries.at(a);
+			const auto& rhs = entries.at(b);
+			if (lhs.isDirectory() != rhs.isDirectory()) {
+				return lhs.isDirectory();
+			}
+			return lhs.name < rhs.name;
+		});
+
+		for (auto it = siblings.rbegin(); it != siblings.rend(); ++it) {
+			const auto& entry = entries.at(*it);
+			auto child = tree.prependChild(node, entry.name, entry.isDirectory());
+			tree.m_stat[child] = { entry.size, entry.mtime };
+			if (entry.isDirectory()) {
+				stack.emplace_back(entry.directory, child);
+			}
+		}
+	}
+	return tree;
+}
+
+static size_t AlignSnapshot(size_t offset) {
+	return (offset + 7) & ~size_t(7);
+}
+
+// Written without adding to the offset, which a corrupt header could wrap around.
+static bool FitsIn(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size) {
+	return offset <= size && count <= (size - offset) / elementSize;
+}
+
+std::vector<uint8_t> FileTree::snapshot() const {
+	// Breadth-first renumbering, which also leaves every removed node out.
+	std::vector<NodeId> order = { Root };
+	std::vector<NodeId> renumbered(size(), InvalidNode);
+	renumbered[Root] = 0;
+	for (size_t i = 0; i < order.size(); i++) {
+		for (auto child = m_firstChild[order[i]]; child != InvalidNode; child = m_nextSibling[child]) {
+			renumbered[child] = NodeId(order.size());
+			order.push_back(child);
+		}
+	}
+	const auto remap = [&renumbered](NodeId node) { return node == InvalidNode ? InvalidNode : renumbered[node]; };
+
+	const auto root = m_rootPath.string();
+	size_t namesSize = 0;
+	for (auto node : order) {
+		namesSize += m_nameLength[node] + 1;
+	}
+
+	const size_t count = order.size();
+	SnapshotHeader header { };
+	std::memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+	header.version = SnapshotVersion;
+	header.nodeCount = uint32_t(count);
+	header.rootLength = uint32_t(root.size());
+	header.namesSize = uint32_t(namesSize);
+	header.parentOffset = AlignSnapshot(sizeof(SnapshotHeader) + root.size());
+	header.firstChildOffset = AlignSnapshot(header.parentOffset + count * sizeof(NodeId));
+	header.nextSiblingOffset = AlignSnapshot(header.firstChildOffset + count * sizeof(NodeId));
+	header.nameOffsetOffset = AlignSnapshot(header.nextSiblingOffset + count * sizeof(NodeId));
+	header.nameLengthOffset = AlignSnapshot(header.nameOffsetOffset + count * sizeof(uint32_t));
+	header.flagsOffset = AlignSnapshot(header.nameLengthOffset + count * sizeof(uint16_t));
+	header.statsOffset = AlignSnapshot(header.flagsOffset + count * sizeof(uint8_t));
+	header.namesOffset = AlignSnapshot(header.statsOffset + count * sizeof(FileStat));
+	header.size = header.namesOffset + namesSize;
+
+	std::vector<uint8_t> data(header.size, 0);
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + sizeof(header), root.data(), root.size());
+
+	auto* parents = reinterpret_cast<NodeId*>(data.data() + header.parentOffset);
+	auto* firstChildren = reinterpret_cast<NodeId*>(data.data() + header.firstChildOffset);
+	auto* nextSiblings = reinterpret_cast<NodeId*>(data.data() + header.nextSiblingOffset);
+	auto* nameOffsets = reinterpret_cast<uint32_t*>(data.data() + header.nameOffsetOffset);
+	auto* nameLengths = reinterpret_cast<uint16_t*>(data.data() + header.nameLengthOffset);
+	auto* flags = data.data() + header.flagsOffset;
+	auto* stats = reinterpret_cast<FileStat*>(data.data() + header.statsOffset);
+	auto* names = reinterpret_cast<char*>(data.data() + header.namesOffset);
+
+	uint32_t nameOffset = 0;
+	for (size_t i = 0; i < count; i++) {
+		const auto node = order[i];
+		parents[i] = remap(m_parent[node]);
+		firstChildren[i] = remap(m_firstChild[node]);
+		nextSiblings[i] = remap(m_nextSibling[node]);
+		nameOffsets[i] = nameOffset;
+		nameLengths[i] = m_nameLength[node];
+		flags[i] = m_flags[node];
+		stats[i] = m_stat[node];
+		std::memcpy(names + nameOffset, m_name[node], m_nameLength[node]);
+		nameOffset += m_nameLength[node] + 1;
+	}
+	return data;
+}
+
+bool FileTree::WriteSnapshot(const std::filesystem::path& snapshotPath, const std::vector<uint8_t>& snapshot) {
+	// Written next to the target and renamed over it, a reader never maps a half written snapshot.
+	auto temporary = snapshotPath;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		if (!out.write(reinterpret_cast<const char*>(snapshot.data()), std::streamsize(snapshot.size()))) {
+			ImEdLogFormat(DebugMessageType::Warning, "Failed to write workspace snapshot \"{}\"", temporary.string());
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(temporary, snapshotPath, ec);
+	return !ec;
+}
+
+bool FileTree::saveSnapshot(const std::filesystem::path& snapshotPath) const {
+	return WriteSnapshot(snapshotPath, snapshot());
+}
+
+std::optional<FileTree> FileTree::FromSnapshot(const std::filesystem::path& rootPath, const std::filesystem::path& snapshotPath) {
+	MappedFile mapped;
+	if (!mapped.open(snapshotPath) || mapped.size() < sizeof(SnapshotHeader)) {
+		return std::nullopt;
+	}
+	const auto* data = mapped.data();
+	const auto& h = *reinterpret_cast<const SnapshotHeader*>(data);
+	const uint64_t count = h.nodeCount;
+	if (std::memcmp(h.magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 || h.version != SnapshotVersion || h.size != mapped.size() ||
+		count == 0 || !FitsIn(sizeof(SnapshotHeader), h.rootLength, 1, h.size) ||
+		!FitsIn(h.parentOffset, count, sizeof(NodeId), h.size) || !FitsIn(h.firstChildOffset, count, sizeof(NodeId), h.size) ||
+		!FitsIn(h.nextSiblingOffset, count, sizeof(NodeId), h.size) || !FitsIn(h.nameOffsetOffset, count, sizeof(uint32_t), h.size) ||
+		!FitsIn(h.nameLengthOffset, count, sizeof(uint16_t), h.size) || !FitsIn(h.flagsOffset, count, 1, h.size) ||
+		!FitsIn(h.statsOffset, count, sizeof(FileStat), h.size) || h.namesOffset > h.size || h.size - h.namesOffset != h.namesSize ||
+		h.nameOffsetOffset % alignof(uint32_t) != 0) {
+		return std::nullopt;
+	}
+	if (std::string_view(reinterpret_cast<const char*>(data + sizeof(SnapshotHeader)), h.rootLength) != rootPath.string()) {
+		return std::nullopt;
+	}
+
+	FileTree tree { rootPath };
+	const auto copy = [data, count]<typename T>(std::vector<T>& array, uint64_t offset) {
+		array.resize(count);
+		std::memcpy(array.data(), data + offset, count * sizeof(T));
+	};
+	copy(tree.m_parent, h.parentOffset);
+	copy(tree.m_firstChild, h.firstChildOffset);
+	copy(tree.m_nextSibling, h.nextSiblingOffset);
+	copy(tree.m_nameLength, h.nameLengthOffset);
+	copy(tree.m_flags, h.flagsOffset);
+	copy(tree.m_stat, h.statsOffset);
+
+	// Names stay in the mapping, only their pointers are resolved. A corrupt link or name rejects the whole file.
+	// Nodes are numbered breadth-first, so parents come before and children and siblings after a node, which
+	// also rules out cycles.
+	const auto* nameOffsets = reinterpret_cast<const uint32_t*>(data + h.nameOffsetOffset);
+	const auto* names = reinterpret_cast<const char*>(data + h.namesOffset);
+	const auto after = [count](NodeId link, size_t node) { return link == InvalidNode || (link > node && link < count); };
+	tree.m_name.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		const uint64_t end = uint64_t(nameOffsets[i]) + tree.m_nameLength[i];
+		if (end >= h.namesSize || names[end] != '\0' ||
+			(i == Root ? tree.m_parent[i] != InvalidNode : tree.m_parent[i] >= i) ||
+			!after(tree.m_firstChild[i], i) || !after(tree.m_nextSibling[i], i)) {
+			return std::nullopt;
+		}
+		tree.m_name[i] = names + nameOffsets[i];
+	}
+	// Every node but the root has to sit in exactly one child list, the one of its parent.
+	size_t linked = 0;
+	for (NodeId node = 0; node < count; node++) {
+		for (auto child = tree.m_firstChild[node]; child != InvalidNode; child = tree.m_nextSibling[child]) {
+			if (tree.m_parent[child] != node) {
+				return std::nullopt;
+			}
+			linked++;
+		}
+	}
+	if (linked != count - 1) {
+		return std::nullopt;
+	}
+	tree.m_snapshot = std::move(mapped);
+	return tree;
+}
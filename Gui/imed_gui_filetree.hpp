@@ -0,0 +1,138 @@
+#pragma once
+
+#include "imed_gui_scanner.hpp"
+#include "imed_gui_filewatcher.hpp"
+#include "imed_gui_mappedfile.hpp"
+#include "imed_gui_paths.hpp"
+
+#include <filesystem>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+
+class StringArena {
+	static constexpr size_t BlockSize = 64 * 1024;
+
+	std::vector<std::unique_ptr<char[]>> m_blocks;
+	size_t m_used = BlockSize;
+	size_t m_allocated = 0;
+	std::unordered_set<std::string_view> m_strings;
+public:
+	StringArena() = default;
+	StringArena(StringArena&&) noexcept = default;
+	StringArena& operator= (StringArena&&) noexcept = default;
+
+	// Returns a stable, null-terminated copy of str, identical strings share the same storage.
+	std::string_view intern(std::string_view str);
+
+	[[nodiscard]] inline size_t memoryUsage() const { return m_allocated; }
+};
+
+struct FileStat {
+	uint64_t size = 0;
+	int64_t mtime = 0;
+
+	[[nodiscard]] inline constexpr bool operator== (const FileStat&) const = default;
+};
+
+// Flat struct-of-arrays file tree, nodes are linked through parent/first-child/next-sibling indices.
+// The tree can be written to a snapshot file whose arrays are copied back as is on the next start.
+class FileTree {
+public:
+	using NodeId = uint32_t;
+	static constexpr NodeId InvalidNode = UINT32_MAX;
+	static constexpr NodeId Root = 0;
+	static constexpr uint32_t SnapshotVersion = 1;
+
+	enum NodeFlags : uint8_t {
+		NodeFlags_None      = 0,
+		NodeFlags_Directory = 1 << 0,
+		NodeFlags_Removed   = 1 << 1,
+	};
+
+	// Every array starts at an 8 byte aligned offset, names are null-terminated so they are used in place.
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t nodeCount;
+		uint32_t rootLength;
+		uint32_t namesSize;
+		uint64_t parentOffset;
+		uint64_t firstChildOffset;
+		uint64_t nextSiblingOffset;
+		uint64_t nameOffsetOffset;
+		uint64_t nameLengthOffset;
+		uint64_t flagsOffset;
+		uint64_t statsOffset;
+		uint64_t namesOffset;
+		uint64_t size;
+	};
+private:
+	std::filesystem::path m_rootPath;
+	std::vector<NodeId> m_parent;
+	std::vector<NodeId> m_firstChild;
+	std::vector<NodeId> m_nextSibling;
+	std::vector<const char*> m_name;
+	std::vector<uint16_t> m_nameLength;
+	std::vector<uint8_t> m_flags;
+	std::vector<FileStat> m_stat;
+	MappedFile m_snapshot;  // Backs the names of nodes loaded from a snapshot, the rest live in InternedPaths
+
+	NodeId allocate(NodeId parent, std::string_view name, uint8_t flags);
+	void link(NodeId parent, NodeId node);
+	void unlink(NodeId node);
+	[[nodiscard]] bool sortsBefore(NodeId lhs, NodeId rhs) const;
+public:
+	FileTree(): FileTree(std::filesystem::path { }) { }
+	explicit FileTree(const std::filesystem::path& rootPath);
+
+	[[nodiscard]] inline size_t size() const { return m_parent.size(); }
+	[[nodiscard]] inline const std::filesystem::path& rootPath() const { return m_rootPath; }
+
+	[[nodiscard]] inline NodeId parent(NodeId node) const { return m_parent[node]; }
+	[[nodiscard]] inline NodeId firstChild(NodeId node) const { return m_firstChild[node]; }
+	[[nodiscard]] inline NodeId nextSibling(NodeId node) const { return m_nextSibling[node]; }
+	[[nodiscard]] inline const char* name(NodeId node) const { return m_name[node]; }
+	[[nodiscard]] inline std::string_view nameView(NodeId node) const { return { m_name[node], m_nameLength[node] }; }
+	[[nodiscard]] inline bool isDirectory(NodeId node) const { return (m_flags[node] & NodeFlags_Directory) != 0; }
+	[[nodiscard]] inline bool isRemoved(NodeId node) const { return (m_flags[node] & NodeFlags_Removed) != 0; }
+	[[nodiscard]] inline bool hasChildren(NodeId node) const { return m_firstChild[node] != InvalidNode; }
+	// Size and mtime the file had when it was scanned, zero if unknown.
+	[[nodiscard]] inline const FileStat& stat(NodeId node) const { return m_stat[node]; }
+	inline void setStat(NodeId node, const FileStat& stat) { m_stat[node] = stat; }
+
+	// Links the new node in front of the parent's existing children, use for building in reverse sorted order.
+	NodeId prependChild(NodeId parent, std::string_view name, bool isDirectory);
+	// Links the new node at its sorted position (directories first, then by name), returns the existing node on a name clash.
+	NodeId insertChild(NodeId parent, std::string_view name, bool isDirectory);
+	void remove(NodeId node);
+	void move(NodeId node, NodeId newParent, std::string_view newName);
+
+	[[nodiscard]] NodeId find(std::string_view relativePath) const;
+	[[nodiscard]] NodeId findChild(NodeId parent, std::string_view name) const;
+	[[nodiscard]] std::filesystem::path pathOf(NodeId node) const;
+	[[nodiscard]] std::string relativePathOf(NodeId node) const;
+	[[nodiscard]] PathInterner::PathId pathIdOf(NodeId node) const;
+	[[nodiscard]] size_t memoryUsage() const;
+
+	// Applies watcher events in place, every directory whose child list changed is appended to touched. Returns the
+	// events as they affected the tree: ones that changed nothing are dropped, a create of an existing file becomes a
+	// modification, so listeners never see a path twice.
+	std::vector<FileEvent> applyEvents(const std::vector<FileEvent>& events, std::vector<NodeId>& touched);
+	// Events that would bring the tree in line with a fresh scan of the same root. With stats set, files whose size or
+	// mtime differ from a scan with ScanOptions::statFiles are reported as modified, and stats receives the scanned
+	// stat of every event.
+	[[nodiscard]] std::vector<FileEvent> diff(const std::vector<ScanEntry>& entries, std::vector<FileStat>* stats = nullptr) const;
+
+	// Serializes the live nodes in breadth-first order, removed nodes are dropped and ids are renumbered.
+	[[nodiscard]] std::vector<uint8_t> snapshot() const;
+	bool saveSnapshot(const std::filesystem::path& snapshotPath) const;
+	static bool WriteSnapshot(const std::filesystem::path& snapshotPath, const std::vector<uint8_t>& snapshot);
+
+	static FileTree FromScan(const std::filesystem::path& rootPath, const std::vector<ScanEntry>& entries);
+	// Maps a snapshot written for the same root, fails on a missing, corrupt or outdated file.
+	static std::optional<FileTree> FromSnapshot(const std::filesystem::path& rootPath, const std::filesystem::path& snapshotPath);
+};
@@ -0,0 +1,559 @@
+#include "imed_gui_filewatcher.hpp"
+#include "imed_gui_common.hpp"
+#include "imed_gui_logger.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <poll.h>
+	#include <sys/eventfd.h>
+	#include <sys/inotify.h>
+	#include <sys/fanotify.h>
+#endif
+
+static constexpr size_t EventBufferSize = 64 * 1024;
+
+FileWatcher::FileWatcher(FileWatcherBackend backend, std::chrono::milliseconds debounce):
+	m_backend(backend), m_debounce(debounce), m_running(false) { }
+
+FileWatcher::~FileWatcher() {
+	stop();
+}
+
+void FileWatcher::CoalesceEvents(std::vector<FileEvent>& events) {
+	std::vector<FileEvent> result;
+	std::vector<bool> dropped;
+	std::unordered_map<std::string, size_t> latest;
+	result.reserve(events.size());
+
+	for (auto& event : events) {
+		if (event.type == FileEventType::Overflow) {
+			// Everything before the overflow is superseded by the revalidation it forces.
+			result.clear();
+			dropped.clear();
+			latest.clear();
+			result.push_back(std::move(event));
+			dropped.push_back(false);
+			continue;
+		}
+		if (event.type == FileEventType::Renamed) {
+			latest.erase(event.oldPath);
+			latest.erase(event.path);
+			result.push_back(std::move(event));
+			dropped.push_back(false);
+			continue;
+		}
+
+		auto it = latest.find(event.path);
+		if (it == latest.end()) {
+			latest.emplace(event.path, result.size());
+			result.push_back(std::move(event));
+			dropped.push_back(false);
+			continue;
+		}
+
+		auto& previous = result.at(it->second);
+		switch (event.type) {
+			case FileEventType::Created:
+				if (previous.type == FileEventType::Deleted) {
+					if (previous.isDirectory || event.isDirectory) {
+						// A replaced directory has new contents, keep the delete and the create.
+						it->second = result.size();
+						result.push_back(std::move(event));
+						dropped.push_back(false);
+					} else {
+						previous.type = FileEventType::Modified;
+					}
+				}
+				break;
+			case FileEventType::Deleted:
+				if (previous.type == FileEventType::Created) {
+					dropped.at(it->second) = true;
+					latest.erase(it);
+				} else {
+					previous.type = FileEventType::Deleted;
+				}
+				break;
+			case FileEventType::Modified:
+			default:
+				break;
+		}
+	}
+
+	events.clear();
+	for (size_t i = 0; i < result.size(); i++) {
+		if (!dropped.at(i)) {
+			events.push_back(std::move(result.at(i)));
+		}
+	}
+}
+
+std::vector<FileEvent> FileWatcher::poll() {
+	std::vector<FileEvent> events;
+	std::lock_guard lock(m_readyMutex);
+	events.swap(m_ready);
+	return events;
+}
+
+bool FileWatcher::hasEvents() const {
+	std::lock_guard lock(m_readyMutex);
+	return !m_ready.empty();
+}
+
+bool FileWatcher::isIgnored(std::string_view relativePath, bool isDirectory) const {
+	size_t start = 0;
+	while (start <= relativePath.size()) {
+		auto end = relativePath.find('/', start);
+		auto component = relativePath.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+		for (const auto& ignored : m_options.ignoredNames) {
+			if (component == ignored) {
+				return true;
+			}
+		}
+		if (end == std::string_view::npos) {
+			break;
+		}
+		start = end + 1;
+	}
+	if (m_ignoreRules.isIgnored(relativePath, isDirectory)) {
+		return true;
+	}
+	return m_options.ignore != nullptr && m_options.ignore(relativePath, isDirectory);
+}
+
+void FileWatcher::addEvent(FileEventType type, std::string&& path, bool isDirectory, std::string&& oldPath) {
+	// Already listed entries are not re-filtered, a changed rule only affects what is reported from now on.
+	if (!isDirectory && (m_ignoreRules.isIgnoreFile(path) || m_ignoreRules.isIgnoreFile(oldPath))) {
+		m_ignoreRules.invalidate();
+	}
+	if (type != FileEventType::Overflow && isIgnored(path, isDirectory)) {
+		return;
+	}
+	m_pending.push_back(FileEvent { type, isDirectory, std::move(path), std::move(oldPath) });
+}
+
+void FileWatcher::flush() {
+	// Moves whose destination never showed up left the workspace.
+	for (auto& [cookie, move] : m_moves) {
+#if defined(__linux__)
+		if (move.isDirectory) {
+			removeWatches(move.path);
+		}
+#endif
+		addEvent(FileEventType::Deleted, std::move(move.path), move.isDirectory);
+	}
+	m_moves.clear();
+
+	if (m_pending.empty()) {
+		return;
+	}
+	CoalesceEvents(m_pending);
+	{
+		std::lock_guard lock(m_readyMutex);
+		if (m_ready.empty()) {
+			m_ready.swap(m_pending);
+		} else {
+			std::move(m_pending.begin(), m_pending.end(), std::back_inserter(m_ready));
+			CoalesceEvents(m_ready);
+		}
+	}
+	m_pending.clear();
+
+	if (OnEventsReady != nullptr) {
+		OnEventsReady();
+	}
+}
+
+#if defined(__linux__)
+
+static std::string JoinRelative(std::string_view directory, std::string_view name) {
+	std::string path;
+	path.reserve(directory.size() + name.size() + 1);
+	if (!directory.empty()) {
+		path.append(directory).push_back('/');
+	}
+	path.append(name);
+	return path;
+}
+
+bool FileWatcher::watch(const std::filesystem::path& root, const ScanOptions& options) {
+	stop();
+
+	m_root = root;
+	m_rootString = root.string();
+	while (m_rootString.size() > 1 && m_rootString.back() == '/') {
+		m_rootString.pop_back();
+	}
+	m_options = options;
+	m_ignoreRules.reset(root, options.ignoreFiles);
+
+	bool opened = false;
+	if (m_backend == FileWatcherBackend::Fanotify) {
+		opened = openFanotify();
+		if (!opened) {
+			ImEdLogFormat(DebugMessageType::Warning, "fanotify unavailable for \"{}\" ({}), falling back to inotify", m_rootString, std::strerror(errno));
+			m_backend = FileWatcherBackend::Inotify;
+		}
+	}
+	if (!opened) {
+		opened = openInotify();
+	}
+	if (!opened) {
+		ImEdLogFormat(DebugMessageType::Warning, "Failed to watch \"{}\": {}", m_rootString, std::strerror(errno));
+		return false;
+	}
+
+	if (m_backend == FileWatcherBackend::Inotify) {
+		m_listing = { };
+		m_listingResult = m_listing.get_future();
+	}
+	m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	m_running = true;
+	m_thread = std::thread([this]() { run(); });
+	return true;
+}
+
+void FileWatcher::stop() {
+	if (m_thread.joinable()) {
+		m_running = false;
+		uint64_t one = 1;
+		(void)write(m_wakeFd, &one, sizeof(one));
+		m_thread.join();
+	}
+	m_running = false;
+
+	for (int* fd : { &m_fd, &m_wakeFd, &m_mountFd }) {
+		if (*fd >= 0) {
+			close(*fd);
+			*fd = -1;
+		}
+	}
+	m_watches.clear();
+	m_moves.clear();
+	m_pending.clear();
+}
+
+bool FileWatcher::openInotify() {
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_fd < 0) {
+		return false;
+	}
+	// Only the root here, the subdirectories are watched and listed by the watcher thread so watch() returns right away.
+	return addWatch("");
+}
+
+bool FileWatcher::openFanotify() {
+#if defined(FAN_REPORT_DFID_NAME)
+	m_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME, O_RDONLY | O_CLOEXEC);
+	if (m_fd < 0) {
+		return false;
+	}
+
+	constexpr uint64_t mask = FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_CLOSE_WRITE | FAN_MODIFY | FAN_ONDIR;
+	if (fanotify_mark(m_fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, mask, AT_FDCWD, m_rootString.c_str()) != 0) {
+		close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+	m_mountFd = open(m_rootString.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	return m_mountFd >= 0;
+#else
+	errno = ENOSYS;
+	return false;
+#endif
+}
+
+bool FileWatcher::addWatch(const std::string& relativePath) {
+	constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_MODIFY |
+							  IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+	auto fullPath = relativePath.empty() ? m_rootString : m_rootString + '/' + relativePath;
+	int wd = inotify_add_watch(m_fd, fullPath.c_str(), mask);
+	if (wd < 0) {
+		if (errno == ENOSPC) {
+			ImEdLog("inotify watch limit reached, raise fs.inotify.max_user_watches to watch the whole workspace",
+					DebugMessageType::Warning);
+		}
+		return false;
+	}
+	m_watches[wd] = relativePath;
+	return true;
+}
+
+void FileWatcher::addWatchRecursive(const std::string& relativePath) {
+	if (!addWatch(relativePath)) {
+		return;
+	}
+	// A directory that appeared at runtime is watched before it is listed, anything created in
+	// between is then reported twice and merged by coalescing instead of being lost.
+	auto fullPath = relativePath.empty() ? m_rootString : m_rootString + '/' + relativePath;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(fullPath, ec)) {
+		const bool isDirectory = entry.is_directory(ec) && !entry.is_symlink(ec);
+		auto path = JoinRelative(relativePath, entry.path().filename().string());
+		if (isIgnored(path, isDirectory)) {
+			continue;
+		}
+		addEvent(FileEventType::Created, std::string(path), isDirectory);
+		if (isDirectory) {
+			addWatchRecursive(path);
+		}
+	}
+}
+
+void FileWatcher::watchTree(const std::string& relativePath, uint32_t directory, uint32_t& nextDirectory, std::vector<ScanEntry>& listing) {
+	// Watched before it is listed like in addWatchRecursive, the root already is. Changes in directories already
+	// watched queue up in the inotify buffer meanwhile.
+	if (!relativePath.empty() && !addWatch(relativePath)) {
+		return;
+	}
+	auto fullPath = relativePath.empty() ? m_rootString : m_rootString + '/' + relativePath;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(fullPath, ec)) {
+		if (!m_running.load(std::memory_order_relaxed)) {
+			return;
+		}
+		const bool isDirectory = entry.is_directory(ec) && !entry.is_symlink(ec);
+		auto name = entry.path().filename().string();
+		auto path = JoinRelative(relativePath, name);
+		if (isIgnored(path, isDirectory)) {
+			continue;
+		}
+		const uint32_t id = isDirectory ? nextDirectory++ : ScanEntry::NoDirectory;
+		listing.push_back(ScanEntry { directory, id, std::move(name), 0, 0 });
+		if (isDirectory) {
+			watchTree(path, listing.back().directory, nextDirectory, listing);
+		}
+	}
+}
+
+void FileWatcher::removeWatches(const std::string& relativePath) {
+	for (auto it = m_watches.begin(); it != m_watches.end();) {
+		const auto& path = it->second;
+		if (path == relativePath || (path.size() > relativePath.size() && path.starts_with(relativePath) &&
+									 path[relativePath.size()] == '/')) {
+			inotify_rm_watch(m_fd, it->first);
+			it = m_watches.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void FileWatcher::renameWatches(const std::string& from, const std::string& to) {
+	for (auto& [wd, path] : m_watches) {
+		if (path == from) {
+			path = to;
+		} else if (path.size() > from.size() && path.starts_with(from) && path[from.size()] == '/') {
+			path = to + path.substr(from.size());
+		}
+	}
+}
+
+void FileWatcher::readInotify(std::vector<char>& buffer) {
+	for (;;) {
+		auto length = read(m_fd, buffer.data(), buffer.size());
+		if (length <= 0) {
+			return;
+		}
+
+		for (ssize_t offset = 0; offset < length;) {
+			auto event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+			offset += ssize_t(sizeof(inotify_event) + event->len);
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				addEvent(FileEventType::Overflow, { }, false);
+				continue;
+			}
+			if (event->mask & IN_IGNORED) {
+				m_watches.erase(event->wd);
+				continue;
+			}
+
+			auto watch = m_watches.find(event->wd);
+			if (watch == m_watches.end() || event->len == 0) {
+				continue;
+			}
+			const bool isDirectory = (event->mask & IN_ISDIR) != 0;
+			auto path = JoinRelative(watch->second, event->name);
+
+			if (event->mask & IN_CREATE) {
+				addEvent(FileEventType::Created, std::string(path), isDirectory);
+				if (isDirectory && !isIgnored(path, true)) {
+					addWatchRecursive(path);
+				}
+			} else if (event->mask & IN_DELETE) {
+				addEvent(FileEventType::Deleted, std::move(path), isDirectory);
+			} else if (event->mask & IN_MOVED_FROM) {
+				m_moves[event->cookie] = PendingMove { std::move(path), isDirectory };
+			} else if (event->mask & IN_MOVED_TO) {
+				auto move = m_moves.find(event->cookie);
+				if (move != m_moves.end()) {
+					if (isDirectory) {
+						renameWatches(move->second.path, path);
+					}
+					if (isIgnored(move->second.path, isDirectory)) {
+						// Ignored directories are not watched, its contents are new to the workspace as well.
+						addEvent(FileEventType::Created, std::string(path), isDirectory);
+						if (isDirectory && !isIgnored(path, true)) {
+							addWatchRecursive(path);
+						}
+					} else if (isIgnored(path, isDirectory)) {
+						if (isDirectory) {
+							removeWatches(path);
+						}
+						addEvent(FileEventType::Deleted, std::move(move->second.path), isDirectory);
+					} else {
+						addEvent(FileEventType::Renamed, std::move(path), isDirectory, std::move(move->second.path));
+					}
+					m_moves.erase(move);
+				} else {
+					addEvent(FileEventType::Created, std::string(path), isDirectory);
+					if (isDirectory && !isIgnored(path, true)) {
+						addWatchRecursive(path);
+					}
+				}
+			} else if (event->mask & (IN_CLOSE_WRITE | IN_MODIFY)) {
+				addEvent(FileEventType::Modified, std::move(path), isDirectory);
+			}
+		}
+	}
+}
+
+void FileWatcher::readFanotify(std::vector<char>& buffer) {
+#if defined(FAN_REPORT_DFID_NAME)
+	for (;;) {
+		auto length = read(m_fd, buffer.data(), buffer.size());
+		if (length <= 0) {
+			return;
+		}
+
+		auto metadata = reinterpret_cast<const fanotify_event_metadata*>(buffer.data());
+		for (; FAN_EVENT_OK(metadata, length); metadata = FAN_EVENT_NEXT(metadata, length)) {
+			if (metadata->mask & FAN_Q_OVERFLOW) {
+				addEvent(FileEventType::Overflow, { }, false);
+				continue;
+			}
+
+			auto info = reinterpret_cast<const fanotify_event_info_fid*>(metadata + 1);
+			if (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME) {
+				continue;
+			}
+			auto handle = reinterpret_cast<file_handle*>(const_cast<unsigned char*>(info->handle));
+			std::string_view name = reinterpret_cast<const char*>(handle->f_handle + handle->handle_bytes);
+
+			int dirFd = open_by_handle_at(m_mountFd, handle, O_RDONLY | O_PATH | O_CLOEXEC);
+			if (dirFd < 0) {
+				continue;
+			}
+			char directory[4096];
+			auto directoryLength = readlink(fmt::format("/proc/self/fd/{}", dirFd).c_str(), directory, sizeof(directory));
+			close(dirFd);
+			if (directoryLength <= 0) {
+				continue;
+			}
+
+			// Filesystem marks see the whole mount, keep only what lies under the workspace root.
+			std::string_view directoryView { directory, size_t(directoryLength) };
+			if (!directoryView.starts_with(m_rootString) ||
+				(directoryView.size() > m_rootString.size() && directoryView[m_rootString.size()] != '/')) {
+				continue;
+			}
+			directoryView.remove_prefix(std::min(directoryView.size(), m_rootString.size() + 1));
+
+			const bool isDirectory = (metadata->mask & FAN_ONDIR) != 0;
+			auto path = name == "." ? std::string(directoryView) : JoinRelative(directoryView, name);
+			if (metadata->mask & (FAN_CREATE | FAN_MOVED_TO)) {
+				addEvent(FileEventType::Created, std::move(path), isDirectory);
+			} else if (metadata->mask & (FAN_DELETE | FAN_MOVED_FROM)) {
+				addEvent(FileEventType::Deleted, std::move(path), isDirectory);
+			} else if (metadata->mask & (FAN_CLOSE_WRITE | FAN_MODIFY)) {
+				addEvent(FileEventType::Modified, std::move(path), isDirectory);
+			}
+		}
+	}
+#endif
+}
+
+void FileWatcher::run() {
+	using Clock = std::chrono::steady_clock;
+
+	if (m_backend == FileWatcherBackend::Inotify) {
+		std::vector<ScanEntry> listing;
+		uint32_t nextDirectory = WorkspaceScanner::RootDirectory + 1;
+		watchTree("", WorkspaceScanner::RootDirectory, nextDirectory, listing);
+		// A listing cut short by stop() is left unset, diffing against it would delete the rest of the tree.
+		if (m_running.load()) {
+			m_listing.set_value(std::move(listing));
+			if (OnEventsReady != nullptr) {
+				OnEventsReady();
+			}
+		}
+	}
+
+	std::vector<char> buffer(EventBufferSize);
+	pollfd fds[2] = {
+		{ m_fd, POLLIN, 0 },
+		{ m_wakeFd, POLLIN, 0 }
+	};
+
+	// A batch is released once the workspace has been quiet for the debounce interval, or after
+	// ten intervals at the latest so a continuous stream of writes still shows up.
+	Clock::time_point firstEvent { }, lastEvent { };
+	while (m_running.load()) {
+		int timeout = -1;
+		if (!m_pending.empty() || !m_moves.empty()) {
+			auto now = Clock::now();
+			auto quiet = std::min(lastEvent + m_debounce, firstEvent + m_debounce * 10);
+			timeout = int(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(quiet - now).count()));
+		}
+
+		if (::poll(fds, 2, timeout) < 0 && errno != EINTR) {
+			break;
+		}
+		if (fds[1].revents & POLLIN) {
+			break;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			const bool wasIdle = m_pending.empty() && m_moves.empty();
+			if (m_backend == FileWatcherBackend::Fanotify) {
+				readFanotify(buffer);
+			} else {
+				readInotify(buffer);
+			}
+			lastEvent = Clock::now();
+			if (wasIdle) {
+				firstEvent = lastEvent;
+			}
+		}
+
+		if (!m_pending.empty() || !m_moves.empty()) {
+			auto now = Clock::now();
+			if (now >= lastEvent + m_debounce || now >= firstEvent + m_debounce * 10) {
+				flush();
+			}
+		}
+	}
+}
+
+#else
+
+bool FileWatcher::watch(const std::filesystem::path& root, const ScanOptions& options) {
+	m_root = root;
+	m_options = options;
+	m_ignoreRules.reset(root, options.ignoreFiles);
+	ImEdLog("File watching is only implemented for Linux", DebugMessageType::Warning);
+	return false;
+}
+
+void FileWatcher::stop() {
+	m_running = false;
+}
+
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "imed_gui_scanner.hpp"
+#include "imed_gui_ignore.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class FileEventType : uint8_t {
+	Created,
+	Deleted,
+	Modified,
+	Renamed,
+	Overflow    // The kernel dropped events, consumers have to revalidate against the disk
+};
+
+struct FileEvent {
+	FileEventType type;
+	bool isDirectory;
+	std::string path;       // Relative to the watched root, '/' separated
+	std::string oldPath;    // Source path of Renamed events
+};
+
+enum class FileWatcherBackend {
+	Inotify,
+	Fanotify    // Filesystem-wide marks, needs CAP_SYS_ADMIN, falls back to inotify when unavailable
+};
+
+class FileWatcher {
+	struct PendingMove {
+		std::string path;
+		bool isDirectory;
+	};
+
+	FileWatcherBackend m_backend;
+	std::chrono::milliseconds m_debounce;
+	std::filesystem::path m_root;
+	std::string m_rootString;
+	ScanOptions m_options;
+	IgnoreMatcher m_ignoreRules;
+
+	int m_fd = -1;
+	int m_wakeFd = -1;
+	int m_mountFd = -1;
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+
+	std::unordered_map<int, std::string> m_watches;
+	std::unordered_map<uint32_t, PendingMove> m_moves;
+	std::vector<FileEvent> m_pending;
+
+	mutable std::mutex m_readyMutex;
+	std::vector<FileEvent> m_ready;
+	std::promise<std::vector<ScanEntry>> m_listing;
+	std::future<std::vector<ScanEntry>> m_listingResult;
+
+	bool openInotify();
+	bool openFanotify();
+	bool addWatch(const std::string& relativePath);
+	void addWatchRecursive(const std::string& relativePath);
+	void watchTree(const std::string& relativePath, uint32_t directory, uint32_t& nextDirectory, std::vector<ScanEntry>& listing);
+	void removeWatches(const std::string& relativePath);
+	void renameWatches(const std::string& from, const std::string& to);
+	void readInotify(std::vector<char>& buffer);
+	void readFanotify(std::vector<char>& buffer);
+	void addEvent(FileEventType type, std::string&& path, bool isDirectory, std::string&& oldPath = { });
+	void flush();
+	void run();
+	[[nodiscard]] bool isIgnored(std::string_view relativePath, bool isDirectory) const;
+public:
+	explicit FileWatcher(FileWatcherBackend backend = FileWatcherBackend::Inotify,
+						 std::chrono::milliseconds debounce = std::chrono::milliseconds(150));
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator= (const FileWatcher&) = delete;
+	~FileWatcher();
+
+	bool watch(const std::filesystem::path& root, const ScanOptions& options = { });
+	void stop();
+
+	[[nodiscard]] inline bool isWatching() const { return m_running.load(); }
+	[[nodiscard]] inline FileWatcherBackend backend() const { return m_backend; }
+
+	// Returns the batches that settled for at least the debounce interval, coalesced per path.
+	std::vector<FileEvent> poll();
+	// A batch is waiting for poll().
+	[[nodiscard]] bool hasEvents() const;
+	// The workspace as listed while the watches were registered, each directory right after its watch. Diffing
+	// against it catches what changed between the caller's own scan and the watches. Ready after OnEventsReady,
+	// invalid when the backend needs no listing, broken when the watcher stopped before it finished.
+	[[nodiscard]] inline std::future<std::vector<ScanEntry>> takeListing() { return std::move(m_listingResult); }
+
+	// Invoked on the watcher thread whenever a new batch becomes available.
+	std::function<void()> OnEventsReady;
+
+	static void CoalesceEvents(std::vector<FileEvent>& events);
+};
@@ -0,0 +1,332 @@
+#include "imed_gui_fuzzy.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
+
+static constexpr int MatchScore       = 16;
+static constexpr int ConsecutiveBonus = 24;
+static constexpr int BoundaryBonus    = 32;
+static constexpr int NameBonus        = 64;
+static constexpr int MaxGapPenalty    = 12;
+
+// Below this many candidates spawning threads costs more than it saves.
+static constexpr size_t ParallelThreshold = 32 * 1024;
+
+static inline char ToLowerAscii(char c) {
+	return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static inline bool IsSeparator(char c) {
+	return c == '/' || c == '_' || c == '-' || c == '.' || c == ' ';
+}
+
+uint64_t PathIndex::CharMask(std::string_view lowered) {
+	uint64_t mask = 0;
+	for (char c : lowered) {
+		if (c >= 'a' && c <= 'z') {
+			mask |= 1ull << (c - 'a');
+		} else if (c >= '0' && c <= '9') {
+			mask |= 1ull << (26 + c - '0');
+		} else {
+			mask |= 1ull << (36 + uint8_t(c) % 28);
+		}
+	}
+	return mask;
+}
+
+PathIndex::PathId PathIndex::add(std::string_view relativePath) {
+	const auto id = PathId(m_entries.size());
+	const auto offset = uint32_t(m_bytes.size());
+	m_bytes.resize(m_bytes.size() + relativePath.size());
+	std::transform(relativePath.begin(), relativePath.end(), m_bytes.begin() + offset, ToLowerAscii);
+	m_bytes.insert(m_bytes.end(), relativePath.begin(), relativePath.end());
+
+	const auto slash = relativePath.rfind('/');
+	const auto nameOffset = slash == std::string_view::npos ? 0 : uint32_t(slash + 1);
+	const std::string_view lowered { m_bytes.data() + offset, relativePath.size() };
+	m_entries.push_back(Entry {
+		CharMask(lowered),
+		CharMask(lowered.substr(nameOffset)),
+		offset,
+		uint32_t(relativePath.size()),
+		nameOffset,
+		0
+	});
+	m_generation++;
+	return id;
+}
+
+void PathIndex::remove(PathId path) {
+	if (m_entries.at(path).removed == 0) {
+		m_entries[path].removed = 1;
+		m_removedCount++;
+		m_generation++;
+	}
+}
+
+void PathIndex::clear() {
+	m_bytes.clear();
+	m_entries.clear();
+	m_removedCount = 0;
+	m_generation++;
+}
+
+size_t PathIndex::memoryUsage() const {
+	return m_bytes.capacity() + m_entries.capacity() * sizeof(Entry);
+}
+
+void PathIndex::prefetch(PathId path, bool bytes) const {
+#if defined(__GNUC__) || defined(__clang__)
+	if (bytes) {
+		__builtin_prefetch(m_bytes.data() + m_entries[path].offset);
+	} else {
+		__builtin_prefetch(&m_entries[path]);
+	}
+#endif
+}
+
+void PathIndex::applyEvents(const std::vector<FileEvent>& events) {
+	// Removals are collected first so the whole batch costs a single pass over the index.
+	std::unordered_set<std::string_view> removedFiles;
+	std::vector<std::pair<std::string_view, std::string_view>> movedDirs;   // old prefix, new prefix
+	std::vector<std::string> added;
+
+	for (const auto& event : events) {
+		switch (event.type) {
+			case FileEventType::Created:
+				if (!event.isDirectory) added.push_back(event.path);
+				break;
+			case FileEventType::Deleted:
+				if (event.isDirectory) movedDirs.emplace_back(event.path, std::string_view { });
+				else removedFiles.insert(event.path);
+				break;
+			case FileEventType::Renamed:
+				if (event.isDirectory) {
+					movedDirs.emplace_back(event.oldPath, event.path);
+				} else {
+					removedFiles.insert(event.oldPath);
+					added.push_back(event.path);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	if (removedFiles.empty() && movedDirs.empty() && added.empty()) {
+		return;
+	}
+
+	const auto count = PathId(size());
+	for (PathId id = 0; id < count && (!removedFiles.empty() || !movedDirs.empty()); id++) {
+		if (isRemoved(id)) {
+			continue;
+		}
+		const auto current = path(id);
+		if (removedFiles.contains(current)) {
+			remove(id);
+			continue;
+		}
+		for (const auto& [from, to] : movedDirs) {
+			if (current.size() > from.size() && current[from.size()] == '/' && current.starts_with(from)) {
+				if (!to.empty()) {
+					added.push_back(std::string(to).append(current.substr(from.size())));
+				}
+				remove(id);
+				break;
+			}
+		}
+	}
+	for (const auto& path : added) {
+		add(path);
+	}
+}
+
+PathIndex PathIndex::FromScan(const std::vector<ScanEntry>& entries) {
+	auto paths = WorkspaceScanner::ResolvePaths(entries);
+
+	size_t bytes = 0, files = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (!entries[i].isDirectory()) {
+			bytes += paths[i].size();
+			files++;
+		}
+	}
+
+	PathIndex index;
+	index.m_bytes.reserve(bytes * 2);
+	index.m_entries.reserve(files);
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (!entries[i].isDirectory()) {
+			index.add(paths[i]);
+		}
+	}
+	return index;
+}
+
+static int ScoreFrom(std::string_view query, std::string_view lowered, std::string_view path, size_t start) {
+	int score = 0;
+	size_t i = start;
+	size_t last = SIZE_MAX;
+	for (char q : query) {
+		// Paths are short, a plain loop beats a memchr call here.
+		while (i < lowered.size() && lowered[i] != q) {
+			i++;
+		}
+		if (i == lowered.size()) {
+			return FuzzyMatcher::NoMatch;
+		}
+
+		score += MatchScore;
+		if (last != SIZE_MAX) {
+			score += i == last + 1 ? ConsecutiveBonus : -int(std::min<size_t>(i - last - 1, MaxGapPenalty));
+		}
+		if (i == 0 || IsSeparator(path[i - 1]) || (path[i] >= 'A' && path[i] <= 'Z' && path[i - 1] >= 'a' && path[i - 1] <= 'z')) {
+			score += BoundaryBonus;
+		}
+		last = i++;
+	}
+	return score;
+}
+
+int FuzzyMatcher::Score(std::string_view loweredQuery, std::string_view loweredPath, std::string_view path, size_t nameOffset, bool tryName) {
+	// Greedy left-to-right matching, tried inside the file name first since that is what people type. Files at the
+	// root are all name, so they get the bonus as well.
+	int score = NoMatch;
+	if (tryName) {
+		score = ScoreFrom(loweredQuery, loweredPath, path, nameOffset);
+		if (score != NoMatch) {
+			score += NameBonus;
+		}
+	}
+	if (score == NoMatch) {
+		score = ScoreFrom(loweredQuery, loweredPath, path, 0);
+		if (score == NoMatch) {
+			return NoMatch;
+		}
+	}
+	// Shorter paths win ties.
+	return score - int(std::min<size_t>(loweredPath.size() / 4, 64));
+}
+
+static bool BetterMatch(const FuzzyMatch& lhs, const FuzzyMatch& rhs) {
+	return lhs.score != rhs.score ? lhs.score > rhs.score : lhs.path < rhs.path;
+}
+
+static void KeepBest(std::vector<FuzzyMatch>& matches, size_t limit) {
+	if (matches.size() > limit) {
+		std::nth_element(matches.begin(), matches.begin() + ptrdiff_t(limit), matches.end(), BetterMatch);
+		matches.resize(limit);
+	}
+}
+
+void FuzzyMatcher::score(const std::vector<FuzzyMatch>* candidates, std::vector<FuzzyMatch>& survivors, std::vector<FuzzyMatch>& top) const {
+	const auto queryMask = PathIndex::CharMask(m_query);
+	const size_t count = candidates != nullptr ? candidates->size() : m_index.size();
+
+	struct Chunk {
+		std::vector<FuzzyMatch> survivors;
+		std::vector<FuzzyMatch> top;
+	};
+	auto scoreRange = [&](size_t begin, size_t end, Chunk& chunk) {
+		// The best resultLimit matches are kept in a min-heap, so the full survivor list is never sorted.
+		auto worse = [](const FuzzyMatch& lhs, const FuzzyMatch& rhs) { return BetterMatch(lhs, rhs); };
+		for (size_t i = begin; i < end; i++) {
+			// Survivors are scattered over the whole index, so the misses of the next candidates are overlapped.
+			if (candidates != nullptr) {
+				if (i + 16 < end) m_index.prefetch((*candidates)[i + 16].path, false);
+				if (i + 8 < end) m_index.prefetch((*candidates)[i + 8].path, true);
+			}
+			const auto path = candidates != nullptr ? (*candidates)[i].path : PathIndex::PathId(i);
+			if ((m_index.charMask(path) & queryMask) != queryMask || m_index.isRemoved(path)) {
+				continue;
+			}
+			const bool tryName = (m_index.nameMask(path) & queryMask) == queryMask;
+			const int score = Score(m_query, m_index.lowered(path), m_index.path(path), m_index.nameOffset(path), tryName);
+			if (score == NoMatch) {
+				continue;
+			}
+			const FuzzyMatch match { path, score };
+			chunk.survivors.push_back(match);
+			if (chunk.top.size() < resultLimit) {
+				chunk.top.push_back(match);
+				std::push_heap(chunk.top.begin(), chunk.top.end(), worse);
+			} else if (resultLimit != 0 && BetterMatch(match, chunk.top.front())) {
+				std::pop_heap(chunk.top.begin(), chunk.top.end(), worse);
+				chunk.top.back() = match;
+				std::push_heap(chunk.top.begin(), chunk.top.end(), worse);
+			}
+		}
+	};
+
+	size_t threads = threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, count / ParallelThreshold + 1);
+
+	std::vector<Chunk> chunks(threads);
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	const size_t perThread = (count + threads - 1) / threads;
+	for (size_t t = 1; t < threads; t++) {
+		workers.emplace_back(scoreRange, std::min(count, t * perThread), std::min(count, (t + 1) * perThread), std::ref(chunks[t]));
+	}
+	scoreRange(0, std::min(count, perThread), chunks[0]);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	size_t total = 0;
+	for (const auto& chunk : chunks) {
+		total += chunk.survivors.size();
+	}
+	survivors.reserve(total);
+	for (auto& chunk : chunks) {
+		survivors.insert(survivors.end(), chunk.survivors.begin(), chunk.survivors.end());
+		top.insert(top.end(), chunk.top.begin(), chunk.top.end());
+	}
+	KeepBest(top, resultLimit);
+	std::sort(top.begin(), top.end(), BetterMatch);
+}
+
+void FuzzyMatcher::reset() {
+	m_survivors.clear();
+	m_results.clear();
+	m_query.clear();
+}
+
+void FuzzyMatcher::update(std::string_view query) {
+	std::string lowered(query.size(), '\0');
+	std::transform(query.begin(), query.end(), lowered.begin(), ToLowerAscii);
+	if (m_generation != m_index.generation()) {
+		reset();
+		m_generation = m_index.generation();
+	} else if (lowered == m_query) {
+		return;
+	}
+
+	// Survivors of a prefix of the new query are a superset of its own matches.
+	size_t common = 0;
+	while (common < lowered.size() && common < m_query.size() && lowered[common] == m_query[common]) {
+		common++;
+	}
+	while (!m_survivors.empty() && m_survivors.back().queryLength > common) {
+		m_survivors.pop_back();
+	}
+
+	m_query = std::move(lowered);
+	m_results.clear();
+	if (m_query.empty()) {
+		m_survivors.clear();
+		return;
+	}
+	if (!m_survivors.empty() && m_survivors.back().queryLength == m_query.size()) {
+		// Shrunk back to a query that is still cached.
+		m_results = m_survivors.back().matches;
+		KeepBest(m_results, resultLimit);
+		std::sort(m_results.begin(), m_results.end(), BetterMatch);
+		return;
+	}
+
+	Survivors next { m_query.size(), { } };
+	score(m_survivors.empty() ? nullptr : &m_survivors.back().matches, next.matches, m_results);
+	m_survivors.push_back(std::move(next));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "imed_gui_scanner.hpp"
+#include "imed_gui_filewatcher.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Every file of a workspace in one contiguous block of path bytes. Each path is stored ASCII-lowered
+// followed by its original spelling, so matching never case-folds and both copies share cache lines.
+class PathIndex {
+public:
+	using PathId = uint32_t;
+private:
+	// Everything the matcher touches per candidate sits in one record, survivors are scattered across the index.
+	struct Entry {
+		uint64_t charMask;
+		uint64_t nameMask;
+		uint32_t offset;
+		uint32_t length;
+		uint32_t nameOffset;
+		uint32_t removed;
+	};
+
+	std::vector<char> m_bytes;
+	std::vector<Entry> m_entries;
+	size_t m_removedCount = 0;
+	uint32_t m_generation = 0;
+
+	void removePrefix(std::string_view relativePath);
+public:
+	PathId add(std::string_view relativePath);
+	void remove(PathId path);
+	void clear();
+
+	[[nodiscard]] inline size_t size() const { return m_entries.size(); }
+	[[nodiscard]] inline size_t fileCount() const { return m_entries.size() - m_removedCount; }
+	[[nodiscard]] inline std::string_view path(PathId path) const { return { m_bytes.data() + m_entries[path].offset + m_entries[path].length, m_entries[path].length }; }
+	[[nodiscard]] inline std::string_view lowered(PathId path) const { return { m_bytes.data() + m_entries[path].offset, m_entries[path].length }; }
+	[[nodiscard]] inline uint32_t nameOffset(PathId path) const { return m_entries[path].nameOffset; }
+	[[nodiscard]] inline uint64_t charMask(PathId path) const { return m_entries[path].charMask; }
+	[[nodiscard]] inline uint64_t nameMask(PathId path) const { return m_entries[path].nameMask; }
+	[[nodiscard]] inline bool isRemoved(PathId path) const { return m_entries[path].removed != 0; }
+	// Bumped whenever paths are added or removed, matchers drop their cached survivors when it changes.
+	[[nodiscard]] inline uint32_t generation() const { return m_generation; }
+	[[nodiscard]] size_t memoryUsage() const;
+	// Pulls the record and the bytes of a path towards the cache ahead of scoring it.
+	void prefetch(PathId path, bool bytes) const;
+
+	// Keeps the index in sync with a watched workspace, removed paths are tombstoned until the next rebuild.
+	void applyEvents(const std::vector<FileEvent>& events);
+
+	static PathIndex FromScan(const std::vector<ScanEntry>& entries);
+	// One bit per character class present in the lowered text, a query can only match paths whose mask covers its own.
+	static uint64_t CharMask(std::string_view lowered);
+};
+
+struct FuzzyMatch {
+	PathIndex::PathId path;
+	int score;
+};
+
+// Scores an index against a query on all cores. Queries that extend the previous one only re-score
+// the previous survivors, so typing narrows the work with every key.
+class FuzzyMatcher {
+	const PathIndex& m_index;
+	std::string m_query;
+	struct Survivors {
+		size_t queryLength;
+		std::vector<FuzzyMatch> matches;
+	};
+
+	// One entry per refinement step, popped again when the query shrinks back to a prefix.
+	std::vector<Survivors> m_survivors;
+	std::vector<FuzzyMatch> m_results;
+	uint32_t m_generation = 0;
+
+	void score(const std::vector<FuzzyMatch>* candidates, std::vector<FuzzyMatch>& survivors, std::vector<FuzzyMatch>& top) const;
+public:
+	static constexpr int NoMatch = INT32_MIN;
+
+	explicit FuzzyMatcher(const PathIndex& index): m_index(index) { }
+
+	size_t resultLimit = 256;
+	size_t threadCount = 0;     // 0 = std::thread::hardware_concurrency()
+
+	void update(std::string_view query);
+	// Forgets every cached survivor list, needed after the index was modified.
+	void reset();
+
+	[[nodiscard]] inline const std::string& query() const { return m_query; }
+	// Best results first, at most resultLimit entries.
+	[[nodiscard]] inline const std::vector<FuzzyMatch>& results() const { return m_results; }
+	[[nodiscard]] inline size_t matchCount() const { return m_survivors.empty() ? 0 : m_survivors.back().matches.size(); }
+
+	static int Score(std::string_view loweredQuery, std::string_view loweredPath, std::string_view path, size_t nameOffset, bool tryName = true);
+};
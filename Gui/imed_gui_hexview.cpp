@@ -0,0 +1,469 @@
+#include "imed_gui_hexview.hpp"
+#include "imed_gui_search.hpp"
+#include "imed_gui_logger.hpp"
+#include "imed_gui_app.hpp"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cinttypes>
+#include <fstream>
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// Searched in chunks so patched pages can be spliced in and a cancel is noticed quickly.
+static constexpr uint64_t SearchChunk = 1024 * 1024;
+static constexpr char HexDigits[] = "0123456789ABCDEF";
+
+static int HexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+HexViewer::~HexViewer() {
+	cancelSearch();
+}
+
+bool HexViewer::open(const std::filesystem::path& path) {
+	close();
+	markDirty();
+	if (!m_file.open(path)) {
+		ImEdLogFormat(DebugMessageType::Warning, "Failed to open \"{}\"", path.string());
+		return false;
+	}
+	m_path = path;
+	return true;
+}
+
+void HexViewer::close() {
+	markDirty();
+	cancelSearch();
+	m_file.close();
+	m_patches.clear();
+	m_path.clear();
+	m_windowStart = 0;
+	m_cursor = 0;
+	m_lowNibble = false;
+	m_matchOffset = NotFound;
+	m_matchLength = 0;
+}
+
+bool HexViewer::save() {
+	if (!isOpen() || m_patches.empty()) {
+		return isOpen();
+	}
+	cancelSearch();
+	markDirty();
+
+	bool written = true;
+#if defined(__linux__)
+	int fd = ::open(m_path.c_str(), O_WRONLY | O_CLOEXEC);
+	written = fd >= 0;
+	for (const auto& [page, bytes] : m_patches) {
+		const uint64_t start = page * PageSize;
+		const auto length = size_t(std::min<uint64_t>(PageSize, size() - start));
+		if (!written || pwrite(fd, bytes->data(), length, off_t(start)) != ssize_t(length)) {
+			written = false;
+			break;
+		}
+	}
+	if (fd >= 0) {
+		::close(fd);
+	}
+#else
+	std::fstream stream(m_path, std::ios::in | std::ios::out | std::ios::binary);
+	for (const auto& [page, bytes] : m_patches) {
+		const uint64_t start = page * PageSize;
+		const auto length = std::min<uint64_t>(PageSize, size() - start);
+		stream.seekp(std::streamoff(start));
+		if (!stream.write(reinterpret_cast<const char*>(bytes->data()), std::streamsize(length))) {
+			written = false;
+			break;
+		}
+	}
+#endif
+	if (!written) {
+		ImEdLogFormat(DebugMessageType::Warning, "Failed to write \"{}\"", m_path.string());
+		return false;
+	}
+
+	// Remapped so the view shows what is on disk rather than relying on the old private mapping.
+	const auto cursor = m_cursor;
+	const auto windowStart = m_windowStart;
+	m_patches.clear();
+	m_file.open(m_path);
+	m_cursor = std::min<uint64_t>(cursor, size());
+	m_windowStart = windowStart;
+	return true;
+}
+
+void HexViewer::revert() {
+	markDirty();
+	cancelSearch();
+	m_patches.clear();
+}
+
+uint8_t HexViewer::byteAt(uint64_t offset) const {
+	if (!m_patches.empty()) {
+		if (auto it = m_patches.find(offset / PageSize); it != m_patches.end()) {
+			return (*it->second)[offset % PageSize];
+		}
+	}
+	return m_file.data()[offset];
+}
+
+void HexViewer::read(uint64_t offset, uint8_t* out, size_t count) const {
+	std::memcpy(out, m_file.data() + offset, count);
+	if (m_patches.empty()) {
+		return;
+	}
+	for (uint64_t page = offset / PageSize; page * PageSize < offset + count; page++) {
+		auto it = m_patches.find(page);
+		if (it == m_patches.end()) {
+			continue;
+		}
+		const uint64_t begin = std::max(offset, page * PageSize);
+		const uint64_t end = std::min(offset + count, (page + 1) * PageSize);
+		std::memcpy(out + (begin - offset), it->second->data() + (begin - page * PageSize), size_t(end - begin));
+	}
+}
+
+void HexViewer::write(uint64_t offset, uint8_t value) {
+	if (offset >= size()) {
+		return;
+	}
+	markDirty();
+	const uint64_t page = offset / PageSize;
+	auto& bytes = m_patches[page];
+	if (bytes == nullptr) {
+		// Copy on first write, the tail page of the file is zero padded.
+		bytes = std::make_unique<std::array<uint8_t, PageSize>>();
+		bytes->fill(0);
+		const uint64_t start = page * PageSize;
+		std::memcpy(bytes->data(), m_file.data() + start, size_t(std::min<uint64_t>(PageSize, size() - start)));
+	}
+	(*bytes)[offset % PageSize] = value;
+}
+
+bool HexViewer::hasPatches(uint64_t begin, uint64_t end) const {
+	if (m_patches.empty()) {
+		return false;
+	}
+	for (uint64_t page = begin / PageSize; page * PageSize < end; page++) {
+		if (m_patches.contains(page)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t HexViewer::find(std::string_view pattern, uint64_t from, const std::atomic<bool>* cancel) const {
+	if (pattern.empty() || pattern.size() > size()) {
+		return NotFound;
+	}
+
+	std::vector<uint8_t> buffer;
+	// Matches starting in [begin, end), each chunk is extended so matches crossing into the next one are found.
+	auto scan = [&](uint64_t begin, uint64_t end) -> uint64_t {
+		for (uint64_t chunk = begin; chunk < end; chunk += SearchChunk) {
+			if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) {
+				return NotFound;
+			}
+			const uint64_t bytesEnd = std::min<uint64_t>(size(), std::min(end, chunk + SearchChunk) + pattern.size() - 1);
+			std::string_view text;
+			if (hasPatches(chunk, bytesEnd)) {
+				buffer.resize(size_t(bytesEnd - chunk));
+				read(chunk, buffer.data(), buffer.size());
+				text = { reinterpret_cast<const char*>(buffer.data()), buffer.size() };
+			} else {
+				text = { reinterpret_cast<const char*>(m_file.data() + chunk), size_t(bytesEnd - chunk) };
+			}
+			if (auto at = WorkspaceSearch::FindLiteral(text, 0, pattern, false); at != std::string_view::npos) {
+				return chunk + at;
+			}
+		}
+		return NotFound;
+	};
+
+	from = std::min<uint64_t>(from, size());
+	if (auto found = scan(from, size()); found != NotFound) {
+		return found;
+	}
+	return scan(0, from);
+}
+
+void HexViewer::startSearch(uint64_t from) {
+	cancelSearch();
+	std::string pattern;
+	if (m_hexQuery) {
+		auto parsed = ParseHexPattern(m_query);
+		m_invalidQuery = !parsed.has_value();
+		if (m_invalidQuery) {
+			return;
+		}
+		pattern = std::move(*parsed);
+	} else {
+		pattern = m_query;
+		m_invalidQuery = false;
+	}
+	if (pattern.empty()) {
+		return;
+	}
+
+	m_matchLength = pattern.size();
+	m_cancelSearch = false;
+	m_searching = Application::Async([this, pattern = std::move(pattern), from]() {
+		return find(pattern, from, &m_cancelSearch);
+	});
+}
+
+void HexViewer::cancelSearch() {
+	if (m_searching.valid()) {
+		m_cancelSearch = true;
+		m_searching.wait();
+		m_searching = { };
+	}
+}
+
+void HexViewer::scrollTo(uint64_t offset) {
+	m_cursor = std::min<uint64_t>(offset, size() == 0 ? 0 : size() - 1);
+	m_lowNibble = false;
+	m_scrollTo = m_cursor;
+	markDirty();
+}
+
+void HexViewer::moveCursor(int64_t delta) {
+	if (size() == 0) {
+		return;
+	}
+	const auto target = int64_t(m_cursor) + delta;
+	scrollTo(uint64_t(std::clamp<int64_t>(target, 0, int64_t(size() - 1))));
+}
+
+void HexViewer::handleInput() {
+	const auto rowsPerPage = int64_t(std::max(1.0f, ImGui::GetWindowHeight() / ImGui::GetTextLineHeightWithSpacing()));
+	if (ImGui::IsKeyPressed(ImGuiKey_LeftArrow)) moveCursor(-1);
+	if (ImGui::IsKeyPressed(ImGuiKey_RightArrow)) moveCursor(1);
+	if (ImGui::IsKeyPressed(ImGuiKey_UpArrow)) moveCursor(-int64_t(BytesPerRow));
+	if (ImGui::IsKeyPressed(ImGuiKey_DownArrow)) moveCursor(int64_t(BytesPerRow));
+	if (ImGui::IsKeyPressed(ImGuiKey_PageUp)) moveCursor(-rowsPerPage * int64_t(BytesPerRow));
+	if (ImGui::IsKeyPressed(ImGuiKey_PageDown)) moveCursor(rowsPerPage * int64_t(BytesPerRow));
+	if (ImGui::IsKeyPressed(ImGuiKey_Home)) scrollTo(ImGui::GetIO().KeyCtrl ? 0 : m_cursor - m_cursor % BytesPerRow);
+	if (ImGui::IsKeyPressed(ImGuiKey_End)) scrollTo(ImGui::GetIO().KeyCtrl ? NotFound : m_cursor - m_cursor % BytesPerRow + BytesPerRow - 1);
+
+	// Edits wait for a running search, it reads the patch map from its own thread.
+	if (!editable || m_searching.valid() || size() == 0) {
+		return;
+	}
+	for (auto c : ImGui::GetIO().InputQueueCharacters) {
+		const int value = c < 128 ? HexValue(char(c)) : -1;
+		if (value < 0) {
+			continue;
+		}
+		const uint8_t old = byteAt(m_cursor);
+		write(m_cursor, m_lowNibble ? uint8_t((old & 0xF0) | value) : uint8_t((old & 0x0F) | (value << 4)));
+		if (m_lowNibble) {
+			moveCursor(1);
+		} else {
+			m_lowNibble = true;
+		}
+	}
+}
+
+void HexViewer::showRows() {
+	const uint64_t totalRows = (size() + BytesPerRow - 1) / BytesPerRow;
+	const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+	const float charWidth = ImGui::CalcTextSize("F").x;
+	const int offsetDigits = size() > UINT32_MAX ? 16 : 8;
+	const auto hexColumn = [offsetDigits](size_t i) { return float(offsetDigits + 2 + i * 3 + (i >= 8 ? 1 : 0)); };
+	const auto asciiColumn = [offsetDigits](size_t i) { return float(offsetDigits + 2 + BytesPerRow * 3 + 2 + i); };
+
+	bool jumped = false;
+	if (m_scrollTo.has_value()) {
+		const uint64_t row = *m_scrollTo / BytesPerRow;
+		const uint64_t visibleRows = uint64_t(ImGui::GetWindowHeight() / lineHeight);
+		const uint64_t firstVisible = m_windowStart + uint64_t(ImGui::GetScrollY() / lineHeight);
+		if (row < m_windowStart || row >= m_windowStart + WindowRows) {
+			m_windowStart = std::min(row > WindowRows / 2 ? row - WindowRows / 2 : 0, totalRows > WindowRows ? totalRows - WindowRows : 0);
+			jumped = true;
+		}
+		if (jumped || row < firstVisible || row + 1 >= firstVisible + visibleRows) {
+			ImGui::SetScrollY(std::max(0.0f, float(row - m_windowStart) * lineHeight - ImGui::GetWindowHeight() * 0.5f));
+			jumped = true;
+		}
+		m_scrollTo.reset();
+	}
+	const uint64_t windowRows = std::min(totalRows - m_windowStart, WindowRows);
+
+	auto* drawList = ImGui::GetWindowDrawList();
+	const ImU32 cursorColor = ImGui::GetColorU32(ImGuiCol_TextSelectedBg);
+	const ImU32 matchColor = ImGui::GetColorU32(ImGuiCol_PlotHistogram, 0.5f);
+	const ImU32 patchColor = ImGui::GetColorU32(ImGuiCol_PlotLinesHovered, 0.5f);
+
+	char line[16 + 2 + BytesPerRow * 3 + 2 + BytesPerRow + 1];
+	uint8_t bytes[BytesPerRow];
+	ImGuiListClipper clipper;
+	clipper.Begin(int(windowRows), lineHeight);
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const uint64_t offset = (m_windowStart + uint64_t(row)) * BytesPerRow;
+			const auto count = size_t(std::min<uint64_t>(BytesPerRow, size() - offset));
+			read(offset, bytes, count);
+
+			std::memset(line, ' ', sizeof(line));
+			for (int digit = 0; digit < offsetDigits; digit++) {
+				line[digit] = HexDigits[(offset >> ((offsetDigits - 1 - digit) * 4)) & 0xF];
+			}
+			for (size_t i = 0; i < count; i++) {
+				const auto hex = size_t(hexColumn(i));
+				line[hex] = HexDigits[bytes[i] >> 4];
+				line[hex + 1] = HexDigits[bytes[i] & 0xF];
+				line[size_t(asciiColumn(i))] = bytes[i] >= 0x20 && bytes[i] < 0x7F ? char(bytes[i]) : '.';
+			}
+			const size_t length = size_t(asciiColumn(count));
+
+			// Backgrounds first, the row text is drawn once on top of them.
+			const ImVec2 origin = ImGui::GetCursorScreenPos();
+			const auto highlight = [&](size_t i, ImU32 color) {
+				drawList->AddRectFilled({ origin.x + hexColumn(i) * charWidth, origin.y }, { origin.x + (hexColumn(i) + 2) * charWidth, origin.y + lineHeight }, color);
+				drawList->AddRectFilled({ origin.x + asciiColumn(i) * charWidth, origin.y }, { origin.x + (asciiColumn(i) + 1) * charWidth, origin.y + lineHeight }, color);
+			};
+			const bool patchedRow = hasPatches(offset, offset + count);
+			for (size_t i = 0; i < count; i++) {
+				const uint64_t at = offset + i;
+				if (at == m_cursor) {
+					highlight(i, cursorColor);
+				} else if (m_matchOffset != NotFound && at >= m_matchOffset && at < m_matchOffset + m_matchLength) {
+					highlight(i, matchColor);
+				} else if (patchedRow && bytes[i] != m_file.data()[at]) {
+					highlight(i, patchColor);
+				}
+			}
+
+			ImGui::TextUnformatted(line, line + length);
+			if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+				const float column = (ImGui::GetIO().MousePos.x - origin.x) / charWidth;
+				for (size_t i = 0; i < count; i++) {
+					if ((column >= hexColumn(i) && column < hexColumn(i) + 3) || (column >= asciiColumn(i) && column < asciiColumn(i) + 1)) {
+						m_cursor = offset + i;
+						m_lowNibble = false;
+						break;
+					}
+				}
+			}
+		}
+	}
+	clipper.End();
+
+	// Slides the window when the view gets close to one of its edges, the scroll position moves by the same
+	// number of rows so the content stays put.
+	const float scrollY = ImGui::GetScrollY();
+	const float edge = float(WindowRows / 4) * lineHeight;
+	if (jumped) {
+		return;
+	}
+	if (scrollY < edge && m_windowStart > 0) {
+		const uint64_t shift = std::min(m_windowStart, WindowRows / 2);
+		m_windowStart -= shift;
+		ImGui::SetScrollY(scrollY + float(shift) * lineHeight);
+	} else if (scrollY > float(windowRows) * lineHeight - edge && m_windowStart + windowRows < totalRows) {
+		const uint64_t shift = std::min(totalRows - (m_windowStart + windowRows), WindowRows / 2);
+		m_windowStart += shift;
+		ImGui::SetScrollY(scrollY - float(shift) * lineHeight);
+	}
+}
+
+bool HexViewer::isDirty() const {
+	return IWidget::isDirty() || (m_searching.valid() && m_searching.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+}
+
+void HexViewer::show() {
+	if (!isOpen()) {
+		ImGui::TextDisabled("No file");
+		return;
+	}
+	if (m_searching.valid() && m_searching.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		m_matchOffset = m_searching.get();
+		if (m_matchOffset != NotFound) {
+			scrollTo(m_matchOffset);
+		}
+	}
+
+	ImGui::SetNextItemWidth(ImGui::CalcTextSize("0000000000000000").x + ImGui::GetStyle().FramePadding.x * 2.0f);
+	if (ImGui::InputTextWithHint("##GoTo", "Offset", m_goTo, sizeof(m_goTo), ImGuiInputTextFlags_CharsHexadecimal | ImGuiInputTextFlags_EnterReturnsTrue)) {
+		scrollTo(std::strtoull(m_goTo, nullptr, 16));
+	}
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 16.0f);
+	const bool submitted = ImGui::InputTextWithHint("##Find", m_hexQuery ? "Find bytes" : "Find text", m_query, sizeof(m_query), ImGuiInputTextFlags_EnterReturnsTrue);
+	ImGui::SameLine();
+	if (ImGui::Checkbox("Hex", &m_hexQuery)) {
+		m_matchOffset = NotFound;
+	}
+	ImGui::SameLine();
+	if (submitted || ImGui::Button("Next")) {
+		startSearch(m_matchOffset != NotFound && m_matchOffset == m_cursor ? m_cursor + 1 : m_cursor);
+	}
+	if (m_searching.valid()) {
+		ImGui::SameLine();
+		ImGui::TextDisabled("Searching...");
+	} else if (m_invalidQuery) {
+		ImGui::SameLine();
+		ImGui::TextDisabled("Invalid byte pattern");
+	}
+	if (editable && isModified()) {
+		ImGui::SameLine();
+		if (ImGui::Button("Save")) {
+			save();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Revert")) {
+			revert();
+		}
+	}
+	ImGui::TextDisabled("Offset %" PRIX64 " of %" PRIX64 "  Value %02X", m_cursor, size(), size() != 0 ? byteAt(m_cursor) : 0);
+
+	ImGui::BeginChild("##HexRows", { 0.0f, 0.0f }, ImGuiChildFlags_None, ImGuiWindowFlags_NoNav);
+	if (ImGui::IsWindowFocused()) {
+		handleInput();
+	}
+	if (size() != 0) {
+		showRows();
+	}
+	ImGui::EndChild();
+}
+
+std::optional<std::string> HexViewer::ParseHexPattern(std::string_view text) {
+	std::string bytes;
+	int high = -1;
+	for (char c : text) {
+		if (c == ' ' || c == '\t' || c == ',') {
+			continue;
+		}
+		const int value = HexValue(c);
+		if (value < 0) {
+			return std::nullopt;
+		}
+		if (high < 0) {
+			high = value;
+		} else {
+			bytes.push_back(char((high << 4) | value));
+			high = -1;
+		}
+	}
+	if (high >= 0) {
+		return std::nullopt;
+	}
+	return bytes;
+}
+
+bool HexViewer::IsBinaryFile(const std::filesystem::path& path) {
+	MappedFile file;
+	return file.open(path) && WorkspaceSearch::IsBinary(file.data(), file.size());
+}
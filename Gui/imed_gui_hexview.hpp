@@ -0,0 +1,90 @@
+#pragma once
+
+#include "imed_gui_layout.hpp"
+#include "imed_gui_mappedfile.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <optional>
+#include <future>
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+// Hex view of a memory mapped file, only the rows on screen are ever touched so opening is instant regardless
+// of size. Overwrites are kept in a sparse map of page copies until save() writes them back in place.
+class HexViewer : public IWidget {
+public:
+	static constexpr size_t BytesPerRow = 16;
+	static constexpr size_t PageSize = 4096;
+	static constexpr uint64_t NotFound = UINT64_MAX;
+private:
+	// The clipper only ever sees a window of rows, float scroll positions lose whole rows on multi-GB files.
+	static constexpr uint64_t WindowRows = 1 << 18;
+
+	std::filesystem::path m_path;
+	MappedFile m_file;
+	std::unordered_map<uint64_t, std::unique_ptr<std::array<uint8_t, PageSize>>> m_patches;    // By page index
+
+	uint64_t m_windowStart = 0;
+	uint64_t m_cursor = 0;
+	bool m_lowNibble = false;
+	std::optional<uint64_t> m_scrollTo;
+
+	char m_goTo[32] = { };
+	char m_query[256] = { };
+	bool m_hexQuery = true;
+	bool m_invalidQuery = false;
+	uint64_t m_matchOffset = NotFound;
+	uint64_t m_matchLength = 0;
+	std::future<uint64_t> m_searching;
+	std::atomic<bool> m_cancelSearch = false;
+
+	[[nodiscard]] bool hasPatches(uint64_t begin, uint64_t end) const;
+	void startSearch(uint64_t from);
+	void cancelSearch();
+	void moveCursor(int64_t delta);
+	void handleInput();
+	void showRows();
+public:
+	// Overwrite mode, typed hex digits replace the nibble under the cursor.
+	bool editable = false;
+
+	HexViewer() = default;
+	explicit HexViewer(const std::filesystem::path& path) { open(path); }
+	HexViewer(const HexViewer&) = delete;
+	HexViewer& operator= (const HexViewer&) = delete;
+	~HexViewer();
+
+	bool open(const std::filesystem::path& path);
+	void close();
+	// Writes every patched page back into the file, the file keeps its size.
+	bool save();
+	void revert();
+
+	[[nodiscard]] inline bool isOpen() const { return m_file.isOpen(); }
+	[[nodiscard]] inline bool isModified() const { return !m_patches.empty(); }
+	[[nodiscard]] inline uint64_t size() const { return m_file.size(); }
+	[[nodiscard]] inline const std::filesystem::path& path() const { return m_path; }
+	[[nodiscard]] inline uint64_t cursor() const { return m_cursor; }
+
+	// Reads through the patches.
+	[[nodiscard]] uint8_t byteAt(uint64_t offset) const;
+	void read(uint64_t offset, uint8_t* out, size_t count) const;
+	void write(uint64_t offset, uint8_t value);
+
+	void scrollTo(uint64_t offset);
+	// First occurrence at or after from, wrapping around to the start of the file. Patched bytes are searched as edited.
+	[[nodiscard]] uint64_t find(std::string_view pattern, uint64_t from, const std::atomic<bool>* cancel = nullptr) const;
+
+	[[nodiscard]] bool isDirty() const override;
+	void show() override;
+
+	// Bytes of a pattern such as "DE AD be ef" or "deadbeef", nullopt on an odd digit count or a non-hex character.
+	static std::optional<std::string> ParseHexPattern(std::string_view text);
+	// Files TextEditor should not be used for, sniffed with the same heuristic as find in files.
+	static bool IsBinaryFile(const std::filesystem::path& path);
+};
@@ -0,0 +1,188 @@
+#include "imed_gui_icons.hpp"
+#include "imed_gui_layout.hpp"
+#include "imed_gui_app.hpp"
+
+#include <string>
+
+IconRegistry FileIcons;
+
+static inline char ToLowerAscii(char c) {
+	return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static std::string_view ExtensionOf(std::string_view fileName) {
+	auto dot = fileName.rfind('.');
+	if (dot == std::string_view::npos || dot == 0) {
+		return { };
+	}
+	return fileName.substr(dot + 1);
+}
+
+static bool EqualsLowered(std::string_view lowered, std::string_view extension) {
+	if (lowered.size() != extension.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < lowered.size(); i++) {
+		if (lowered[i] != ToLowerAscii(extension[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t IconRegistry::HashExtension(std::string_view extension) {
+	// FNV-1a over the ASCII-lowered bytes, 0 is reserved for empty slots.
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (char c : extension) {
+		hash ^= uint8_t(ToLowerAscii(c));
+		hash *= 0x100000001b3ull;
+	}
+	return hash == 0 ? 1 : hash;
+}
+
+IconRegistry::IconRegistry(): m_slots(64), m_hasResults(false) { }
+
+IconRegistry::~IconRegistry() {
+	if (m_loader.joinable()) {
+		{
+			std::lock_guard lock(m_jobsMutex);
+			m_stopLoader = true;
+		}
+		m_jobsReady.notify_all();
+		m_loader.join();
+	}
+	for (auto& result : m_results) {
+		stbi_image_free(result.pixels);
+	}
+}
+
+size_t IconRegistry::findSlot(uint64_t hash, std::string_view extension) const {
+	const size_t mask = m_slots.size() - 1;
+	for (size_t index = size_t(hash) & mask;; index = (index + 1) & mask) {
+		const auto& slot = m_slots[index];
+		if (slot.hash == 0 || (slot.hash == hash && EqualsLowered(slot.extension, extension))) {
+			return index;
+		}
+	}
+}
+
+void IconRegistry::insert(uint64_t hash, std::string_view extension, uint32_t icon) {
+	if ((m_count + 1) * 2 > m_slots.size()) {
+		std::vector<Slot> slots(m_slots.size() * 2);
+		slots.swap(m_slots);
+		m_count = 0;
+		for (const auto& slot : slots) {
+			if (slot.hash != 0) {
+				insert(slot.hash, slot.extension, slot.icon);
+			}
+		}
+	}
+
+	auto& slot = m_slots[findSlot(hash, extension)];
+	if (slot.hash == 0) {
+		std::string lowered { extension };
+		for (char& c : lowered) {
+			c = ToLowerAscii(c);
+		}
+		slot.hash = hash;
+		slot.extension = m_extensions.intern(lowered);
+		m_count++;
+	}
+	slot.icon = icon;
+}
+
+void IconRegistry::registerIcon(std::string_view extension, Image&& image) {
+	const auto hash = HashExtension(extension);
+	auto icon = uint32_t(m_icons.size());
+	m_icons.push_back(UiIcons.add(image));
+	insert(hash, extension, icon);
+}
+
+void IconRegistry::registerIcon(std::string_view extension, const std::filesystem::path& imagePath) {
+	const auto hash = HashExtension(extension);
+	auto icon = uint32_t(m_icons.size());
+	m_icons.push_back(IconAtlas::InvalidRegion);
+	insert(hash, extension, icon);
+
+	{
+		std::lock_guard lock(m_jobsMutex);
+		m_jobs.push_back(LoadJob { icon, imagePath });
+		if (!m_loader.joinable()) {
+			m_loader = std::thread([this]() { runLoader(); });
+		}
+	}
+	m_jobsReady.notify_one();
+}
+
+void IconRegistry::runLoader() {
+	for (;;) {
+		LoadJob job;
+		{
+			std::unique_lock lock(m_jobsMutex);
+			m_jobsReady.wait(lock, [this]() { return m_stopLoader || !m_jobs.empty(); });
+			if (m_stopLoader) {
+				return;
+			}
+			job = std::move(m_jobs.back());
+			m_jobs.pop_back();
+		}
+
+		int w, h, c;
+		auto pixels = stbi_load(job.path.string().c_str(), &w, &h, &c, STBI_default);
+		if (pixels == nullptr) {
+			continue;
+		}
+
+		{
+			std::lock_guard lock(m_resultsMutex);
+			m_results.push_back(LoadResult { job.icon, pixels, w, h, c });
+			m_hasResults = true;
+		}
+		// Picked up by the next frame's update(), which has to happen even when nothing else changed.
+		Application::RequestFrameIn(0.0);
+	}
+}
+
+void IconRegistry::update() {
+	if (!m_hasResults.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	std::vector<LoadResult> results;
+	{
+		std::lock_guard lock(m_resultsMutex);
+		results.swap(m_results);
+		m_hasResults = false;
+	}
+	for (auto& result : results) {
+		m_icons.at(result.icon) = UiIcons.add(result.pixels, result.width, result.height, result.channels);
+		stbi_image_free(result.pixels);
+	}
+}
+
+uint32_t IconRegistry::resolve(uint64_t hash, std::string_view extension) {
+	// Unknown extensions go through the FileIconProvider hook once, a miss is cached as well.
+	uint32_t icon = NoIcon;
+	if (FileIconProvider != nullptr) {
+		auto image = FileIconProvider("." + std::string(extension));
+		auto region = UiIcons.add(image);
+		if (region != IconAtlas::InvalidRegion) {
+			icon = uint32_t(m_icons.size());
+			m_icons.push_back(region);
+		}
+	}
+	insert(hash, extension, icon);
+	return icon;
+}
+
+Image IconRegistry::iconFor(std::string_view fileName) {
+	const auto extension = ExtensionOf(fileName);
+	const auto hash = HashExtension(extension);
+
+	const auto& slot = m_slots[findSlot(hash, extension)];
+	auto icon = slot.hash != 0 ? slot.icon : resolve(hash, extension);
+	if (icon == NoIcon || !UiIcons.isPacked(m_icons[icon])) {
+		return UiIcons.image(m_default);
+	}
+	return UiIcons.image(m_icons[icon]);
+}
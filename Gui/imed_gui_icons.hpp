@@ -0,0 +1,75 @@
+#pragma once
+
+#include "imed_gui_types.hpp"
+#include "imed_gui_atlas.hpp"
+#include "imed_gui_filetree.hpp"
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+// Resolves file extensions to icons once and caches the result in an open-addressing table,
+// so a per-frame lookup is one hash of the extension and a probe. Icons live in UiIcons.
+class IconRegistry {
+	static constexpr uint32_t NoIcon = UINT32_MAX;
+
+	struct Slot {
+		uint64_t hash = 0;
+		std::string_view extension;
+		uint32_t icon = NoIcon;
+	};
+	struct LoadJob {
+		uint32_t icon;
+		std::filesystem::path path;
+	};
+	struct LoadResult {
+		uint32_t icon;
+		uint8_t* pixels;
+		int width, height, channels;
+	};
+
+	std::vector<Slot> m_slots;
+	size_t m_count = 0;
+	StringArena m_extensions;
+	std::vector<IconAtlas::RegionId> m_icons;
+	IconAtlas::RegionId m_default = IconAtlas::InvalidRegion;
+
+	std::thread m_loader;
+	std::mutex m_jobsMutex;
+	std::condition_variable m_jobsReady;
+	std::vector<LoadJob> m_jobs;
+	bool m_stopLoader = false;
+
+	std::mutex m_resultsMutex;
+	std::vector<LoadResult> m_results;
+	std::atomic<bool> m_hasResults;
+
+	[[nodiscard]] size_t findSlot(uint64_t hash, std::string_view extension) const;
+	uint32_t resolve(uint64_t hash, std::string_view extension);
+	void insert(uint64_t hash, std::string_view extension, uint32_t icon);
+	void runLoader();
+public:
+	IconRegistry();
+	IconRegistry(const IconRegistry&) = delete;
+	~IconRegistry();
+
+	void setDefaultIcon(IconAtlas::RegionId region) { m_default = region; }
+
+	// Decodes the image on a background thread, the default icon is shown until it is uploaded.
+	void registerIcon(std::string_view extension, const std::filesystem::path& imagePath);
+	void registerIcon(std::string_view extension, Image&& image);
+
+	// Moves finished decodes into the atlas, call once per frame before UiIcons.build().
+	void update();
+
+	[[nodiscard]] Image iconFor(std::string_view fileName);
+
+	static uint64_t HashExtension(std::string_view extension);
+};
+
+extern IconRegistry FileIcons;
@@ -0,0 +1,347 @@
+#include "imed_gui_ignore.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+static constexpr std::string_view GlobSyntax = "*?[\\";
+
+GlobAutomaton GlobAutomaton::Compile(std::string_view pattern) {
+	GlobAutomaton glob;
+	size_t token = 0;
+	for (size_t i = 0; i < pattern.size(); i++, token++) {
+		if (token >= MaxTokens) {
+			return { };
+		}
+		const uint64_t bit = 1ull << token;
+		const char c = pattern[i];
+
+		if (c == '*') {
+			size_t end = i;
+			while (end < pattern.size() && pattern[end] == '*') {
+				end++;
+			}
+			// Only a '**' that forms a whole path component crosses directories, anything else is a plain '*'.
+			const bool component = end - i >= 2 && (i == 0 || pattern[i - 1] == '/') && (end == pattern.size() || pattern[end] == '/');
+			if (component && end < pattern.size()) {
+				// '**/' gets an entry token that may skip the loop and its slash. The entry bit is gone after the
+				// first byte, so a loop that consumed something still has to reach the slash.
+				if (token + 1 >= MaxTokens) {
+					return { };
+				}
+				glob.m_skip |= bit;
+				glob.m_skipComponent |= bit;
+				token++;
+				glob.m_globstar |= bit << 1;
+				glob.m_skip |= bit << 1;
+			} else {
+				(component ? glob.m_globstar : glob.m_star) |= bit;
+				glob.m_skip |= bit;
+			}
+			i = end - 1;
+		} else if (c == '?') {
+			for (int byte = 0; byte < 256; byte++) {
+				if (byte != '/') glob.m_accepts[byte] |= bit;
+			}
+		} else if (c == '[') {
+			std::array<bool, 256> set { };
+			size_t j = i + 1;
+			const bool negated = j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^');
+			if (negated) j++;
+			for (const size_t first = j; j < pattern.size() && (pattern[j] != ']' || j == first); j++) {
+				auto low = uint8_t(pattern[j]);
+				if (low == '\\' && j + 1 < pattern.size()) {
+					low = uint8_t(pattern[++j]);
+				}
+				if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+					const auto high = uint8_t(pattern[j + 2]);
+					for (int byte = low; byte <= high; byte++) set[byte] = true;
+					j += 2;
+				} else {
+					set[low] = true;
+				}
+			}
+			if (j >= pattern.size()) {
+				// Unterminated, git treats the bracket as a literal.
+				glob.m_accepts['['] |= bit;
+			} else {
+				for (int byte = 0; byte < 256; byte++) {
+					if (set[byte] != negated && byte != '/') glob.m_accepts[byte] |= bit;
+				}
+				i = j;
+			}
+		} else {
+			auto literal = uint8_t(c);
+			if (c == '\\' && i + 1 < pattern.size()) {
+				literal = uint8_t(pattern[++i]);
+			}
+			glob.m_accepts[literal] |= bit;
+		}
+	}
+	glob.m_final = 1ull << token;
+	glob.m_valid = true;
+	return glob;
+}
+
+uint64_t GlobAutomaton::closure(uint64_t state) const {
+	for (;;) {
+		const uint64_t expanded = state | ((state & m_skip) << 1) | ((state & m_skipComponent) << 3);
+		if (expanded == state) {
+			return state;
+		}
+		state = expanded;
+	}
+}
+
+bool GlobAutomaton::matches(std::string_view text) const {
+	uint64_t state = closure(1);
+	for (char c : text) {
+		const auto byte = uint8_t(c);
+		const uint64_t loops = byte == '/' ? m_globstar : m_star | m_globstar;
+		state = closure(((state & m_accepts[byte]) << 1) | (state & loops));
+		if (state == 0) {
+			return false;
+		}
+	}
+	return (state & m_final) != 0;
+}
+
+size_t IgnoreRules::LiteralSet::FilterBit(std::string_view str) {
+	return (str.size() * 0x9E37 + uint8_t(str.front()) * 0x2F + uint8_t(str.back())) & 4095;
+}
+
+void IgnoreRules::LiteralSet::add(std::string_view str, bool directoryOnly, uint32_t index) {
+	auto& indices = m_indices[std::string(str)];
+	(directoryOnly ? indices.directory : indices.any) = int32_t(index);
+	const auto bit = FilterBit(str);
+	m_filter[bit >> 6] |= 1ull << (bit & 63);
+}
+
+int32_t IgnoreRules::LiteralSet::find(std::string_view str, bool isDirectory) const {
+	if (str.empty()) {
+		return -1;
+	}
+	const auto bit = FilterBit(str);
+	if (((m_filter[bit >> 6] >> (bit & 63)) & 1) == 0) {
+		return -1;
+	}
+	auto it = m_indices.find(str);
+	if (it == m_indices.end()) {
+		return -1;
+	}
+	return isDirectory ? std::max(it->second.any, it->second.directory) : it->second.any;
+}
+
+void IgnoreRules::add(std::string_view line) {
+	if (!line.empty() && line.back() == '\r') {
+		line.remove_suffix(1);
+	}
+	while (!line.empty() && line.back() == ' ' && !(line.size() >= 2 && line[line.size() - 2] == '\\')) {
+		line.remove_suffix(1);
+	}
+	if (line.empty() || line.front() == '#') {
+		return;
+	}
+
+	bool negated = false;
+	if (line.front() == '!') {
+		negated = true;
+		line.remove_prefix(1);
+	} else if (line.starts_with("\\!") || line.starts_with("\\#")) {
+		line.remove_prefix(1);
+	}
+	Rule rule { Rule::Literal, false, false, 0, 0, 0, { }, 0 };
+	if (!line.empty() && line.back() == '/') {
+		rule.directoryOnly = true;
+		line.remove_suffix(1);
+	}
+	// A slash anywhere but at the end anchors the pattern to this directory, otherwise it matches names at any depth.
+	rule.anchored = line.find('/') != std::string_view::npos;
+	if (!line.empty() && line.front() == '/') {
+		line.remove_prefix(1);
+	}
+	if (line.starts_with("**/") && line.find('/', 3) == std::string_view::npos) {
+		line.remove_prefix(3);
+		rule.anchored = false;
+	}
+	if (line.empty()) {
+		return;
+	}
+
+	const auto syntax = line.find_first_of(GlobSyntax);
+	if (syntax == std::string_view::npos) {
+		rule.kind = Rule::Literal;
+	} else if (!rule.anchored && syntax == 0 && line.front() == '*' && line.find_first_of(GlobSyntax, 1) == std::string_view::npos) {
+		rule.kind = Rule::Suffix;
+		line.remove_prefix(1);
+	} else if (syntax == line.size() - 1 && line.back() == '*') {
+		rule.kind = Rule::Prefix;
+		line.remove_suffix(1);
+	} else {
+		auto glob = GlobAutomaton::Compile(line);
+		if (!glob.isValid()) {
+			return;
+		}
+		rule.kind = Rule::Glob;
+		rule.glob = uint32_t(m_globs.size());
+		m_globs.push_back(glob);
+	}
+
+	rule.index = uint32_t(m_negated.size());
+	m_negated.push_back(negated ? 1 : 0);
+	if (rule.kind == Rule::Literal) {
+		(rule.anchored ? m_paths : m_names).add(line, rule.directoryOnly, rule.index);
+	} else if (rule.kind == Rule::Suffix && line.size() > 1 && line.rfind('.') == 0) {
+		m_extensions.add(line.substr(1), rule.directoryOnly, rule.index);
+	} else {
+		auto isPlain = [&](size_t i) { return GlobSyntax.find(line[i]) == std::string_view::npos && line[i] != ']' && (i == 0 || line[i - 1] != '\\'); };
+		rule.first = rule.kind != Rule::Suffix && isPlain(0) ? uint8_t(line.front()) : 0;
+		rule.last = rule.kind != Rule::Prefix && isPlain(line.size() - 1) ? uint8_t(line.back()) : 0;
+		if (!rule.directoryOnly) {
+			m_fileLastBytes.add(rule.last);
+		}
+		m_directoryLastBytes.add(rule.last);
+		rule.text = line;
+		m_patterns.push_back(std::move(rule));
+	}
+}
+
+IgnoreMatch IgnoreRules::matchLocal(std::string_view localPath, std::string_view name, bool isDirectory) const {
+	int32_t best = std::max(m_names.find(name, isDirectory), m_paths.find(localPath, isDirectory));
+	if (const auto dot = name.rfind('.'); dot != std::string_view::npos) {
+		best = std::max(best, m_extensions.find(name.substr(dot + 1), isDirectory));
+	}
+
+	// Walked from the last rule, the first match decides unless a literal with a higher index already did.
+	const bool mayMatch = !name.empty() && (isDirectory ? m_directoryLastBytes : m_fileLastBytes).contains(uint8_t(name.back()));
+	for (auto it = m_patterns.rbegin(); mayMatch && it != m_patterns.rend() && int32_t(it->index) > best; ++it) {
+		if (it->directoryOnly && !isDirectory) {
+			continue;
+		}
+		const auto subject = it->anchored ? localPath : name;
+		if ((it->first != 0 && uint8_t(subject.front()) != it->first) || (it->last != 0 && uint8_t(subject.back()) != it->last)) {
+			continue;
+		}
+		bool matched;
+		switch (it->kind) {
+			case Rule::Prefix:
+				matched = subject.starts_with(it->text) && subject.find('/', it->text.size()) == std::string_view::npos;
+				break;
+			case Rule::Suffix:
+				matched = subject.ends_with(it->text);
+				break;
+			default:
+				matched = m_globs[it->glob].matches(subject);
+				break;
+		}
+		if (matched) {
+			best = int32_t(it->index);
+			break;
+		}
+	}
+
+	if (best < 0) {
+		return IgnoreMatch::None;
+	}
+	return m_negated[size_t(best)] != 0 ? IgnoreMatch::Included : IgnoreMatch::Ignored;
+}
+
+IgnoreMatch IgnoreRules::match(std::string_view relativePath, bool isDirectory) const {
+	const auto slash = relativePath.rfind('/');
+	return match(relativePath, slash == std::string_view::npos ? relativePath : relativePath.substr(slash + 1), isDirectory);
+}
+
+IgnoreMatch IgnoreRules::match(std::string_view relativePath, std::string_view name, bool isDirectory) const {
+	for (auto rules = this; rules != nullptr; rules = rules->m_parent.get()) {
+		const auto localPath = rules->m_directory.empty() ? relativePath : relativePath.substr(rules->m_directory.size() + 1);
+		if (auto result = rules->matchLocal(localPath, name, isDirectory); result != IgnoreMatch::None) {
+			return result;
+		}
+	}
+	return IgnoreMatch::None;
+}
+
+std::shared_ptr<const IgnoreRules> IgnoreRules::Compile(std::string_view text, std::string directory, std::shared_ptr<const IgnoreRules> parent) {
+	auto rules = std::make_shared<IgnoreRules>();
+	rules->m_directory = std::move(directory);
+	while (!text.empty()) {
+		const auto end = text.find('\n');
+		rules->add(text.substr(0, end));
+		text = end == std::string_view::npos ? std::string_view { } : text.substr(end + 1);
+	}
+	if (rules->ruleCount() == 0) {
+		return parent;
+	}
+	rules->m_parent = std::move(parent);
+	return rules;
+}
+
+std::shared_ptr<const IgnoreRules> IgnoreRules::Load(const std::filesystem::path& root, std::string directory,
+	const std::vector<std::string>& fileNames, std::shared_ptr<const IgnoreRules> parent) {
+	std::string text;
+	for (const auto& fileName : fileNames) {
+		std::ifstream stream(root / directory / fileName, std::ios::binary);
+		if (stream) {
+			std::stringstream contents;
+			contents << stream.rdbuf();
+			text.append(contents.str()).push_back('\n');
+		}
+	}
+	if (text.empty()) {
+		return parent;
+	}
+	return Compile(text, std::move(directory), std::move(parent));
+}
+
+void IgnoreMatcher::reset(const std::filesystem::path& root, std::vector<std::string> fileNames) {
+	std::lock_guard lock(m_mutex);
+	m_root = root;
+	m_fileNames = std::move(fileNames);
+	m_directories.clear();
+}
+
+void IgnoreMatcher::invalidate() {
+	std::lock_guard lock(m_mutex);
+	m_directories.clear();
+}
+
+std::shared_ptr<const IgnoreRules> IgnoreMatcher::rulesFor(const std::string& directory) const {
+	if (auto it = m_directories.find(directory); it != m_directories.end()) {
+		return it->second;
+	}
+	std::shared_ptr<const IgnoreRules> parent;
+	if (!directory.empty()) {
+		const auto slash = directory.rfind('/');
+		parent = rulesFor(slash == std::string::npos ? std::string { } : directory.substr(0, slash));
+	}
+	auto rules = IgnoreRules::Load(m_root, directory, m_fileNames, std::move(parent));
+	m_directories.emplace(directory, rules);
+	return rules;
+}
+
+bool IgnoreMatcher::isIgnored(std::string_view relativePath, bool isDirectory) const {
+	std::lock_guard lock(m_mutex);
+	if (m_fileNames.empty() || relativePath.empty()) {
+		return false;
+	}
+	// Every ancestor is checked as well, the scanner never lists anything below an ignored directory.
+	auto rules = rulesFor({ });
+	for (size_t slash = relativePath.find('/');; slash = relativePath.find('/', slash + 1)) {
+		const bool last = slash == std::string_view::npos;
+		const auto path = relativePath.substr(0, slash);
+		if (rules != nullptr && rules->isIgnored(path, last ? isDirectory : true)) {
+			return true;
+		}
+		if (last) {
+			return false;
+		}
+		rules = rulesFor(std::string(path));
+	}
+}
+
+bool IgnoreMatcher::isIgnoreFile(std::string_view relativePath) const {
+	const auto slash = relativePath.rfind('/');
+	const auto name = slash == std::string_view::npos ? relativePath : relativePath.substr(slash + 1);
+	std::lock_guard lock(m_mutex);
+	return std::find(m_fileNames.begin(), m_fileNames.end(), name) != m_fileNames.end();
+}
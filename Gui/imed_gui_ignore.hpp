@@ -0,0 +1,135 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+// Glob compiled to a bit-parallel NFA, one state bit per pattern token, so matching is a few
+// shifts and masks per byte. '*', '?' and classes never match '/', a '**' component matches any
+// number of directories.
+class GlobAutomaton {
+	std::array<uint64_t, 256> m_accepts { };   // Tokens that consume the byte and advance
+	uint64_t m_star = 0;                        // '*' tokens, loop on anything but '/'
+	uint64_t m_globstar = 0;                    // '**' tokens, loop on anything
+	uint64_t m_skip = 0;                        // Tokens that may match nothing
+	uint64_t m_skipComponent = 0;               // Entry tokens of '**/', skip the loop and its slash
+	uint64_t m_final = 0;
+	bool m_valid = false;
+
+	[[nodiscard]] uint64_t closure(uint64_t state) const;
+public:
+	static constexpr size_t MaxTokens = 63;
+
+	[[nodiscard]] inline bool isValid() const { return m_valid; }
+	[[nodiscard]] bool matches(std::string_view text) const;
+
+	// Invalid if the pattern has more than MaxTokens tokens.
+	static GlobAutomaton Compile(std::string_view pattern);
+};
+
+enum class IgnoreMatch : uint8_t {
+	None,
+	Ignored,
+	Included    // Re-included by a '!' rule
+};
+
+// The rules of the ignore files of one directory, linked to the rules of its parent. Directories
+// without ignore files share their parent's node. Plain names, paths and extensions are matched
+// through hash lookups, only the remaining patterns run a GlobAutomaton.
+class IgnoreRules {
+	struct Rule {
+		enum Kind : uint8_t { Literal, Prefix, Suffix, Glob } kind;
+		bool directoryOnly;
+		bool anchored;          // Matched against the path below the directory instead of the name
+		uint32_t index;         // Position in the ignore files, later rules win
+		uint8_t first;          // Byte the subject has to start / end with, 0 if any
+		uint8_t last;
+		std::string text;
+		uint32_t glob;
+	};
+	struct StringHash {
+		using is_transparent = void;
+		inline size_t operator()(std::string_view str) const { return std::hash<std::string_view> { }(str); }
+	};
+	// Exact strings mapped to the highest index of the rules naming them. A Bloom filter over
+	// (length, first byte, last byte) rejects almost every subject before it is hashed.
+	class LiteralSet {
+		struct Indices {
+			int32_t any = -1;
+			int32_t directory = -1;
+		};
+		std::unordered_map<std::string, Indices, StringHash, std::equal_to<>> m_indices;
+		std::array<uint64_t, 64> m_filter { };
+
+		static size_t FilterBit(std::string_view str);
+	public:
+		void add(std::string_view str, bool directoryOnly, uint32_t index);
+		// Highest matching rule index, -1 if none.
+		[[nodiscard]] int32_t find(std::string_view str, bool isDirectory) const;
+	};
+	// Set of possible last bytes over a group of rules, most names end in a byte no pattern can end with.
+	struct ByteFilter {
+		std::array<uint64_t, 4> bits { };
+		bool any = false;
+
+		inline void add(uint8_t byte) { if (byte == 0) any = true; else bits[byte >> 6] |= 1ull << (byte & 63); }
+		[[nodiscard]] inline bool contains(uint8_t byte) const { return any || ((bits[byte >> 6] >> (byte & 63)) & 1) != 0; }
+	};
+
+	std::string m_directory;
+	std::shared_ptr<const IgnoreRules> m_parent;
+	std::vector<uint8_t> m_negated;     // Per rule index
+	std::vector<Rule> m_patterns;       // Every rule not handled by a LiteralSet, by index
+	std::vector<GlobAutomaton> m_globs;
+	LiteralSet m_names;
+	LiteralSet m_paths;
+	LiteralSet m_extensions;            // "*.ext" rules, by the part after the name's last dot
+	ByteFilter m_fileLastBytes;
+	ByteFilter m_directoryLastBytes;
+
+	void add(std::string_view line);
+	[[nodiscard]] IgnoreMatch matchLocal(std::string_view localPath, std::string_view name, bool isDirectory) const;
+public:
+	[[nodiscard]] inline const std::string& directory() const { return m_directory; }
+	[[nodiscard]] inline size_t ruleCount() const { return m_negated.size(); }
+
+	// Decides a path below this directory, the nearest directory with a matching rule wins. name is the
+	// last component of relativePath, callers that already have it split off save a scan per path.
+	[[nodiscard]] IgnoreMatch match(std::string_view relativePath, std::string_view name, bool isDirectory) const;
+	[[nodiscard]] IgnoreMatch match(std::string_view relativePath, bool isDirectory) const;
+	[[nodiscard]] inline bool isIgnored(std::string_view relativePath, bool isDirectory) const { return match(relativePath, isDirectory) == IgnoreMatch::Ignored; }
+
+	// Compiles the contents of a directory's ignore files, returns parent if they hold no rules.
+	static std::shared_ptr<const IgnoreRules> Compile(std::string_view text, std::string directory, std::shared_ptr<const IgnoreRules> parent);
+	// Reads and compiles the named ignore files of a workspace directory, later files take precedence.
+	static std::shared_ptr<const IgnoreRules> Load(const std::filesystem::path& root, std::string directory,
+		const std::vector<std::string>& fileNames, std::shared_ptr<const IgnoreRules> parent);
+};
+
+// Ignore rules of a whole workspace for paths that do not come from a scan, directories are compiled on first use.
+class IgnoreMatcher {
+	std::filesystem::path m_root;
+	std::vector<std::string> m_fileNames;
+	mutable std::mutex m_mutex;
+	mutable std::unordered_map<std::string, std::shared_ptr<const IgnoreRules>> m_directories;
+
+	std::shared_ptr<const IgnoreRules> rulesFor(const std::string& directory) const;
+public:
+	IgnoreMatcher() = default;
+	IgnoreMatcher(const IgnoreMatcher&) = delete;
+	IgnoreMatcher& operator= (const IgnoreMatcher&) = delete;
+
+	void reset(const std::filesystem::path& root, std::vector<std::string> fileNames);
+	// Drops every compiled directory, needed after an ignore file changed.
+	void invalidate();
+
+	// True for ignored paths and everything below an ignored directory.
+	[[nodiscard]] bool isIgnored(std::string_view relativePath, bool isDirectory) const;
+	[[nodiscard]] bool isIgnoreFile(std::string_view relativePath) const;
+};
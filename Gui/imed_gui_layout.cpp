@@ -1,32 +1,53 @@
 #include "imed_gui_layout.hpp"
+#include "imed_gui_icons.hpp"
+#include "imed_gui_atlas.hpp"
+#include "imed_gui_assets.hpp"
+#include "imed_gui_app.hpp"
 
 #include "imgui/imgui.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
 
-static Image ImgFolder;
-static Image ImgFile;
+#include <algorithm>
+#include <utility>
+
+static IconAtlas::RegionId ImgFolder = IconAtlas::InvalidRegion;
+static IconAtlas::RegionId ImgFile = IconAtlas::InvalidRegion;
 
 std::function<Image(const std::string&)> FileIconProvider = nullptr;
 
+// How often results and progress of a running search are redrawn.
+static constexpr double SearchRefreshSeconds = 0.1;
+
+template<typename Range>
+static bool AnyDirty(const Range& widgets) {
+	return std::any_of(std::begin(widgets), std::end(widgets), [](const auto& widget) { return widget->isDirty(); });
+}
+
 template<WidgetType T>
 void Layout::addWidget(T&& widget) {
 	m_widgets.emplace_back(std::forward(widget));
+	markDirty();
 }
 template<WidgetType T>
 void Layout::addWidget(const T& widget) {
 	m_widgets.emplace_back(widget);
+	markDirty();
+}
+
+bool Layout::isDirty() const {
+	return IWidget::isDirty() || AnyDirty(m_widgets);
 }
 
 void Layout::show() {
 	for (auto& widget : m_widgets) {
-		widget->show();
+		widget->draw();
 	}
 }
 
 void HLayout::show() {
 	for (size_t i = 0; i < m_widgets.size(); i++) {
-		m_widgets.at(i)->show();
+		m_widgets.at(i)->draw();
 		if (i < m_widgets.size() - 1) {
 			ImGui::SameLine();
 		}
@@ -49,23 +70,33 @@ TextInput::TextInput(const std::string& label, size_t bufferSize): label(label),
 	m_buffer.reserve(bufferSize);
 }
 void TextInput::show() {
-	ImGui::InputText(label.c_str(), m_buffer.data(), m_buffer.capacity(), flags, callback);
+	if (ImGui::InputText(label.c_str(), m_buffer.data(), m_buffer.capacity(), flags, callback)) {
+		markDirty();
+	}
 }
 
 void IntInput::show() {
-	ImGui::InputInt(label.c_str(), &value, step, stepFast, flags);
+	if (ImGui::InputInt(label.c_str(), &value, step, stepFast, flags)) {
+		markDirty();
+	}
 }
 
 void FloatInput::show() {
-	ImGui::InputFloat(label.c_str(), &value, step, stepFast, "%g", flags);
+	if (ImGui::InputFloat(label.c_str(), &value, step, stepFast, "%g", flags)) {
+		markDirty();
+	}
 }
 
 void IntSlider::show() {
-	ImGui::SliderInt(label.c_str(), &value, min, max, "%d", flags);
+	if (ImGui::SliderInt(label.c_str(), &value, min, max, "%d", flags)) {
+		markDirty();
+	}
 }
 
 void FloatSlider::show() {
-	ImGui::SliderFloat(label.c_str(), &value, min, max, "%g", flags);
+	if (ImGui::SliderFloat(label.c_str(), &value, min, max, "%g", flags)) {
+		markDirty();
+	}
 }
 
 void Button::show() {
@@ -74,7 +105,7 @@ void Button::show() {
 	}
 }
 void ImageButton::show() {
-	if (ImGui::ImageButton(image.asImTexture(), size)) {
+	if (ImGui::ImageButton(image.asImTexture(), size, image.uv0, image.uv1)) {
 		if (OnClicked != nullptr) OnClicked();
 	}
 }
@@ -86,24 +117,34 @@ void MenuItem::show() {
 
 void Menu::addItem(MenuItem&& item) {
 	m_menuItems.emplace_back(item);
+	markDirty();
 }
 void Menu::addItem(const MenuItem& item) {
 	m_menuItems.emplace_back(item);
+	markDirty();
 }
 void Menu::addSeparator(Separator&& separator) {
 	m_menuItems.emplace_back(separator);
+	markDirty();
 }
 void Menu::addSeparator(const Separator& separator) {
 	m_menuItems.emplace_back(separator);
+	markDirty();
+}
+
+bool Menu::isDirty() const {
+	return IWidget::isDirty() || std::any_of(m_menuItems.begin(), m_menuItems.end(), [](const auto& item) {
+		return std::visit([](const IWidget& widget) { return widget.isDirty(); }, item);
+	});
 }
 
 void Menu::show() {
 	if (ImGui::BeginMenu(label.c_str(), enabled)) {
 		for (auto& item : m_menuItems) {
 			if (item.index() == 0) {
-				std::get<0>(item).show();
+				std::get<0>(item).draw();
 			} else {
-				std::get<1>(item).show();
+				std::get<1>(item).draw();
 			}
 		}
 		ImGui::EndMenu();
@@ -112,24 +153,35 @@ void Menu::show() {
 
 void MenuBar::addMenu(Menu&& menu) {
 	m_menus.emplace_back(menu);
+	markDirty();
 }
 void MenuBar::addMenu(const Menu& menu) {
 	m_menus.emplace_back(menu);
+	markDirty();
+}
+
+bool TabItem::isDirty() const {
+	return IWidget::isDirty() || (m_selected && content != nullptr && content->isDirty());
 }
 
 void TabItem::show() {
-	if (ImGui::BeginTabItem(label.c_str(), &isOpen, flags)) {
+	m_selected = ImGui::BeginTabItem(label.c_str(), &isOpen, flags);
+	if (m_selected) {
 		if (content != nullptr) {
-			content->show();
+			content->draw();
 		}
 		ImGui::EndTabItem();
 	}
 }
 
+bool MenuBar::isDirty() const {
+	return IWidget::isDirty() || std::any_of(m_menus.begin(), m_menus.end(), [](const Menu& menu) { return menu.isDirty(); });
+}
+
 void MenuBar::show() {
 	if (m_mainbar ? ImGui::BeginMainMenuBar() : ImGui::BeginMenuBar()) {
 		for (auto& menu : m_menus) {
-			menu.show();
+			menu.draw();
 		}
 		if (m_mainbar) ImGui::EndMainMenuBar();
 		else ImGui::EndMenuBar();
@@ -138,15 +190,21 @@ void MenuBar::show() {
 
 void TabLayout::addTab(TabItem&& item) {
 	m_tabs.emplace_back(item);
+	markDirty();
 }
 void TabLayout::addTab(const TabItem& item) {
 	m_tabs.emplace_back(item);
+	markDirty();
+}
+
+bool TabLayout::isDirty() const {
+	return IWidget::isDirty() || std::any_of(m_tabs.begin(), m_tabs.end(), [](const TabItem& tab) { return tab.isDirty(); });
 }
 
 void TabLayout::show() {
 	if (ImGui::BeginTabBar(m_id, flags)) {
 		for (auto& tab : m_tabs) {
-			tab.show();
+			tab.draw();
 		}
 		ImGui::EndTabBar();
 	}
@@ -155,11 +213,17 @@ void TabLayout::show() {
 template<WidgetType T>
 void ColumnLayout::addWidget(int column, T&& widget) {
 	m_widgets.emplace_back(column, std::make_shared<IWidget>(widget));
+	markDirty();
 }
 
 template<WidgetType T>
 void ColumnLayout::addWidget(int column, const T& widget) {
 	m_widgets.emplace_back(column, std::make_shared<IWidget>(widget));
+	markDirty();
+}
+
+bool ColumnLayout::isDirty() const {
+	return IWidget::isDirty() || std::any_of(m_widgets.begin(), m_widgets.end(), [](const ColumnWidget& widget) { return widget.widget->isDirty(); });
 }
 
 void ColumnLayout::show() {
@@ -167,7 +231,7 @@ void ColumnLayout::show() {
 	for (int i = 0; i < m_columns; i++) {
 		for (auto& widget : m_widgets) {
 			if (widget.column == i) {
-				widget.widget->show();
+				widget.widget->draw();
 			}
 		}
 		ImGui::NextColumn();
@@ -191,6 +255,10 @@ TreeNode::TreeNode(std::string&& label, const std::vector<TreeNode>& children):
 TreeNode::TreeNode(const std::string& label, std::vector<TreeNode>&& children): label(label), nodes(std::move(children)) { }
 TreeNode::TreeNode(std::string&& label, std::vector<TreeNode>&& children): label(std::move(label)), nodes(std::move(children)) { }
 
+bool TreeNode::isDirty() const {
+	return IWidget::isDirty() || std::any_of(nodes.begin(), nodes.end(), [](const TreeNode& node) { return node.isDirty(); });
+}
+
 void TreeNode::show() {
 	if (nodes.empty()) {
 		if (ImGui::TreeNodeEx(label.c_str(), ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen)) {
@@ -199,8 +267,8 @@ void TreeNode::show() {
 	} else {
 		if (ImGui::TreeNode(label.c_str())) {
 			if (OnSelected != nullptr) OnSelected(*this);
-			for (auto child: nodes) {
-				child.show();
+			for (auto& child : nodes) {
+				child.draw();
 			}
 			ImGui::TreePop();
 		}
@@ -208,69 +276,482 @@ void TreeNode::show() {
 }
 
 
-FreeTreeNode::FreeTreeNode(const std::filesystem::path& path, const std::initializer_list<FreeTreeNode>& children): path(path) {
-	nodes.reserve(children.size());
-	for (auto& child : children) {
-		nodes.push_back(child);
-	}
+bool FreeTreeNode::isExpanded(FileTree::NodeId node) const {
+	return node < m_expanded.size() && m_expanded[node] != 0;
 }
-FreeTreeNode::FreeTreeNode(const std::filesystem::path& path, const std::vector<FreeTreeNode>& children): path(path), nodes(children) { }
-FreeTreeNode::FreeTreeNode(std::filesystem::path&& path, const std::initializer_list<FreeTreeNode>& children): path(std::move(path)) {
-	nodes.reserve(children.size());
-	for (auto& child : children) {
-		nodes.push_back(child);
+
+void FreeTreeNode::setExpanded(FileTree::NodeId node, bool expanded) {
+	if (isExpanded(node) == expanded || !tree.isDirectory(node)) {
+		return;
 	}
+	for (size_t row = 0; row < m_rows.size(); row++) {
+		if (m_rows[row].node == node) {
+			expanded ? expandRow(row) : collapseRow(row);
+			markDirty();
+			return;
+		}
+	}
+	if (node >= m_expanded.size()) {
+		m_expanded.resize(tree.size(), 0);
+	}
+	m_expanded[node] = expanded ? 1 : 0;
+	markDirty();
 }
-FreeTreeNode::FreeTreeNode(std::filesystem::path&& path, const std::vector<FreeTreeNode>& children): path(std::move(path)), nodes(children) { }
-FreeTreeNode::FreeTreeNode(const std::filesystem::path& path, std::vector<FreeTreeNode>&& children): path(path), nodes(std::move(children)) { }
-FreeTreeNode::FreeTreeNode(std::filesystem::path&& path, std::vector<FreeTreeNode>&& children): path(std::move(path)), nodes(std::move(children)) { }
 
-void FreeTreeNode::show() {
-	if (nodes.empty()) {
-		Image img;
-		if (FileIconProvider != nullptr) {
-			FileIconProvider(path.extension().string());
+void FreeTreeNode::appendVisibleDescendants(std::vector<VisibleRow>& rows, FileTree::NodeId node, uint32_t depth) const {
+	for (auto child = tree.firstChild(node); child != FileTree::InvalidNode; child = tree.nextSibling(child)) {
+		rows.push_back({ child, depth });
+		if (isExpanded(child)) {
+			appendVisibleDescendants(rows, child, depth + 1);
 		}
-		if (img.id() == 0) {
-			img = ImgFile;
+	}
+}
+
+void FreeTreeNode::expandRow(size_t row) {
+	const auto [node, depth] = m_rows.at(row);
+	if (node >= m_expanded.size()) {
+		m_expanded.resize(tree.size(), 0);
+	}
+	m_expanded[node] = 1;
+
+	std::vector<VisibleRow> rows;
+	appendVisibleDescendants(rows, node, depth + 1);
+	m_rows.insert(m_rows.begin() + ptrdiff_t(row + 1), rows.begin(), rows.end());
+}
+
+void FreeTreeNode::collapseRow(size_t row) {
+	const auto [node, depth] = m_rows.at(row);
+	m_expanded[node] = 0;
+
+	size_t end = row + 1;
+	while (end < m_rows.size() && m_rows[end].depth > depth) {
+		end++;
+	}
+	m_rows.erase(m_rows.begin() + ptrdiff_t(row + 1), m_rows.begin() + ptrdiff_t(end));
+}
+
+void FreeTreeNode::refreshChildren(FileTree::NodeId node) {
+	if (!isExpanded(node)) {
+		return;
+	}
+	for (size_t row = 0; row < m_rows.size(); row++) {
+		if (m_rows[row].node == node) {
+			collapseRow(row);
+			expandRow(row);
+			return;
 		}
+	}
+}
 
-		ImGui::Image(img.asImTexture(), { 16, 16 }); ImGui::SameLine();
-		if (ImGui::TreeNodeEx(path.filename().string().c_str(), ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen)) {
-			if (OnSelected != nullptr) OnSelected(*this);
+bool FreeTreeNode::watch(FileWatcherBackend backend, const ScanOptions& options) {
+	m_watcher = std::make_unique<FileWatcher>(backend);
+	m_watcher->OnEventsReady = Application::Wake;
+	m_watchOptions = options;
+	if (!m_watcher->watch(tree.rootPath(), options)) {
+		m_watcher = nullptr;
+		return false;
+	}
+	// Diffed like a rescan, it covers what changed between the tree's scan and the watches being in place.
+	if (auto listing = m_watcher->takeListing(); listing.valid()) {
+		m_rescan = std::move(listing);
+	}
+	return true;
+}
+
+void FreeTreeNode::applyFileEvents(std::vector<FileEvent>&& events) {
+	for (const auto& event : events) {
+		if (event.type == FileEventType::Overflow) {
+			// The kernel lost track, the tree is diffed against a fresh scan rather than rebuilt. The rest of the
+			// batch is covered by the scan, later events wait for it in m_pendingEvents.
+			ImEdLog("File watcher queue overflowed, revalidating the workspace tree", DebugMessageType::Warning);
+			if (!m_rescan.valid()) {
+				m_rescan = Application::Async([root = tree.rootPath(), options = m_watchOptions]() {
+					return WorkspaceScanner::Scan(root, options);
+				});
+			}
+			return;
 		}
+	}
+
+	std::vector<FileTree::NodeId> touched;
+	auto applied = tree.applyEvents(events, touched);
+	if (touched.size() > 64) {
+		refreshRows();
 	} else {
-		ImGui::Image(ImgFolder.asImTexture(), { 16, 16 }); ImGui::SameLine();
-		if (ImGui::TreeNode(path.filename().string().c_str())) {
-			if (OnSelected != nullptr) OnSelected(*this);
-			for (auto child: nodes) {
-				child.show();
+		std::sort(touched.begin(), touched.end());
+		touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+		for (auto node : touched) {
+			if (node != FileTree::InvalidNode && !tree.isRemoved(node)) {
+				refreshChildren(node);
 			}
-			ImGui::TreePop();
 		}
 	}
+
+	if (OnFilesChanged != nullptr && !applied.empty()) {
+		OnFilesChanged(applied);
+	}
+}
+
+void FreeTreeNode::refreshRows() {
+	m_rows.clear();
+	m_rows.push_back({ FileTree::Root, 0 });
+	if (isExpanded(FileTree::Root)) {
+		appendVisibleDescendants(m_rows, FileTree::Root, 1);
+	}
+	markDirty();
+}
+
+void FreeTreeNode::finishRevalidation() {
+	auto [events, stats] = m_revalidation.get();
+	if (!events.empty()) {
+		applyFileEvents(std::vector<FileEvent>(events));
+		for (size_t i = 0; i < events.size(); i++) {
+			if (events[i].type == FileEventType::Deleted) {
+				continue;
+			}
+			if (auto node = tree.find(events[i].path); node != FileTree::InvalidNode) {
+				tree.setStat(node, stats[i]);
+			}
+		}
+	}
+	// Held back until now, the scan may have seen a file before a change the watcher reported. A pending listing
+	// is newer than the scan, the events wait for it.
+	if (!m_rescan.valid() && !m_pendingEvents.empty()) {
+		applyFileEvents(std::exchange(m_pendingEvents, { }));
+	}
+	saveSnapshot();
+}
+
+void FreeTreeNode::finishRescan() {
+	try {
+		applyFileEvents(tree.diff(m_rescan.get()));
+	} catch (const std::future_error&) {
+		// The watcher stopped before it finished listing, the queued events are all there is.
+	}
+	if (!m_pendingEvents.empty()) {
+		applyFileEvents(std::exchange(m_pendingEvents, { }));
+	}
+}
+
+bool FreeTreeNode::saveSnapshot() {
+	if (m_snapshotPath.empty()) {
+		return false;
+	}
+	m_saving = Application::Async([path = m_snapshotPath, snapshot = tree.snapshot()]() {
+		return FileTree::WriteSnapshot(path, snapshot);
+	});
+	return true;
+}
+
+bool FreeTreeNode::isDirty() const {
+	if (IWidget::isDirty() || (m_watcher != nullptr && m_watcher->hasEvents())) {
+		return true;
+	}
+	if (!isRevalidating() && m_rescan.valid() && m_rescan.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		return true;
+	}
+	return isRevalidating() && m_revalidation.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void FreeTreeNode::show() {
+	if (m_watcher != nullptr) {
+		if (auto events = m_watcher->poll(); !events.empty()) {
+			// Applied only once the scan's diff is in, the diff is based on the tree from before them.
+			if (m_rescan.valid() || isRevalidating()) {
+				m_pendingEvents.insert(m_pendingEvents.end(), events.begin(), events.end());
+			} else {
+				applyFileEvents(std::move(events));
+			}
+		}
+	}
+	// After the revalidation, whose scan is the older one.
+	if (!isRevalidating() && m_rescan.valid() && m_rescan.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		finishRescan();
+	}
+	if (isRevalidating() && m_revalidation.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		finishRevalidation();
+	}
+	if (m_rows.empty()) {
+		refreshRows();
+	}
+
+	const float baseX = ImGui::GetCursorPosX();
+	const float indent = ImGui::GetStyle().IndentSpacing;
+	size_t toggledRow = m_rows.size();
+
+	ImGuiListClipper clipper;
+	clipper.Begin(int(m_rows.size()));
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const auto [node, depth] = m_rows[size_t(row)];
+			const auto id = reinterpret_cast<const void*>(uintptr_t(node));
+			ImGui::SetCursorPosX(baseX + float(depth) * indent);
+
+			ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanAvailWidth;
+			if (tree.isDirectory(node)) {
+				const auto icon = UiIcons.image(ImgFolder);
+				ImGui::Image(icon.asImTexture(), { 16, 16 }, icon.uv0, icon.uv1); ImGui::SameLine();
+				flags |= ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick;
+				ImGui::SetNextItemOpen(isExpanded(node), ImGuiCond_Always);
+			} else {
+				const auto icon = FileIcons.iconFor(tree.nameView(node));
+				ImGui::Image(icon.asImTexture(), { 16, 16 }, icon.uv0, icon.uv1); ImGui::SameLine();
+				flags |= ImGuiTreeNodeFlags_Leaf;
+			}
+
+			ImGui::TreeNodeEx(id, flags, "%s", tree.name(node));
+			if (ImGui::IsItemToggledOpen()) {
+				toggledRow = size_t(row);
+			} else if (ImGui::IsItemClicked() && OnSelected != nullptr) {
+				OnSelected(*this, node);
+			}
+		}
+	}
+	clipper.End();
+
+	// Applied after the clipper pass so the row list is not modified while it is being drawn.
+	if (toggledRow < m_rows.size()) {
+		isExpanded(m_rows[toggledRow].node) ? collapseRow(toggledRow) : expandRow(toggledRow);
+		markDirty();
+	}
 }
 
 FreeTreeNode FreeTreeNode::BuildFromDirPath(const std::filesystem::path& rootPath) {
-	FreeTreeNode root { rootPath, { } };
-	for (const auto& path : std::filesystem::directory_iterator(rootPath)) {
-		if (path.is_directory()) {
-			root.nodes.push_back(BuildFromDirPath(path.path()));
-		} else {
-			root.nodes.push_back(FreeTreeNode { path.path(), { } });
+	const auto snapshotPath = ImEdGui_WorkspaceCachePath(rootPath, "tree.snapshot");
+	ScanOptions options;
+	options.statFiles = true;
+
+	if (auto snapshot = FileTree::FromSnapshot(rootPath, snapshotPath)) {
+		FreeTreeNode node { std::move(*snapshot) };
+		node.setExpanded(FileTree::Root, true);
+		node.m_snapshotPath = snapshotPath;
+		// Diffed against its own copy of the snapshot, the displayed tree keeps changing meanwhile.
+		node.m_revalidation = Application::Async([rootPath, snapshotPath, options]() {
+			Revalidation revalidation;
+			if (auto base = FileTree::FromSnapshot(rootPath, snapshotPath)) {
+				revalidation.events = base->diff(WorkspaceScanner::Scan(rootPath, options), &revalidation.stats);
+			}
+			return revalidation;
+		});
+		return node;
+	}
+
+	FreeTreeNode node { FileTree::FromScan(rootPath, WorkspaceScanner::Scan(rootPath, options)) };
+	node.setExpanded(FileTree::Root, true);
+	node.m_snapshotPath = snapshotPath;
+	node.saveSnapshot();
+	return node;
+}
+
+QuickOpen::QuickOpen(const std::filesystem::path& rootPath): m_root(rootPath), m_matcher(m_index) {
+	rebuildIndex();
+}
+
+void QuickOpen::rebuildIndex(const ScanOptions& options) {
+	m_pendingEvents.clear();
+	m_indexing = Application::Async([root = m_root, options]() {
+		return PathIndex::FromScan(WorkspaceScanner::Scan(root, options));
+	});
+}
+
+void QuickOpen::applyFileEvents(const std::vector<FileEvent>& events) {
+	for (const auto& event : events) {
+		if (event.type == FileEventType::Overflow) {
+			rebuildIndex();
+			return;
 		}
 	}
-	return root;
+	if (isIndexing()) {
+		// Replayed on top of the new index, the scan may have missed them.
+		m_pendingEvents.insert(m_pendingEvents.end(), events.begin(), events.end());
+	} else {
+		m_index.applyEvents(events);
+	}
+}
+
+void QuickOpen::open() {
+	m_opening = true;
+}
+
+void QuickOpen::choose(size_t result) {
+	const auto& results = m_matcher.results();
+	if (result < results.size() && OnOpened != nullptr) {
+		OnOpened(m_root / m_index.path(results[result].path));
+	}
+	ImGui::CloseCurrentPopup();
+}
+
+bool QuickOpen::isDirty() const {
+	return IWidget::isDirty() || (isIndexing() && m_indexing.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
 }
 
-void ImEdGui_Init(const std::filesystem::path& basedir) {
-	// Preload images
+void QuickOpen::show() {
+	if (isIndexing() && m_indexing.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		m_index = m_indexing.get();
+		m_index.applyEvents(m_pendingEvents);
+		m_pendingEvents.clear();
+		m_matcher.reset();
+	}
 
-	if (std::filesystem::exists(basedir / "assets" / "folder.png")) {
-		ImgFolder = Image(basedir / "assets" / "folder.png");
+	if (ImGui::IsKeyChordPressed(shortcut)) {
+		open();
+	}
+	if (m_opening) {
+		ImGui::OpenPopup("##QuickOpen");
+		m_opening = false;
 	}
-	if (std::filesystem::exists(basedir / "assets" / "file.png")) {
-		ImgFile = Image(basedir / "assets" / "file.png");
+
+	const auto& io = ImGui::GetIO();
+	ImGui::SetNextWindowPos({ io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.1f }, ImGuiCond_Always, { 0.5f, 0.0f });
+	ImGui::SetNextWindowSize({ std::min(io.DisplaySize.x * 0.8f, 640.0f), 0.0f });
+	if (!ImGui::BeginPopup("##QuickOpen")) {
+		return;
+	}
+
+	if (ImGui::IsWindowAppearing()) {
+		ImGui::SetKeyboardFocusHere();
+	}
+	ImGui::SetNextItemWidth(-FLT_MIN);
+	if (ImGui::InputTextWithHint("##Query", isIndexing() ? "Indexing workspace..." : "Go to file", m_query, sizeof(m_query))) {
+		m_selected = 0;
+	}
+	// Cheap when nothing changed, picks up index updates as well as edits.
+	m_matcher.update(m_query);
+
+	const auto& results = m_matcher.results();
+	bool scrollToSelected = false;
+	if (!results.empty()) {
+		if (ImGui::IsKeyPressed(ImGuiKey_DownArrow)) {
+			m_selected = std::min(m_selected + 1, results.size() - 1);
+			scrollToSelected = true;
+		}
+		if (ImGui::IsKeyPressed(ImGuiKey_UpArrow) && m_selected > 0) {
+			m_selected--;
+			scrollToSelected = true;
+		}
+		m_selected = std::min(m_selected, results.size() - 1);
+	}
+	if (ImGui::IsKeyPressed(ImGuiKey_Enter) || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter)) {
+		choose(m_selected);
+	} else if (ImGui::IsKeyPressed(ImGuiKey_Escape)) {
+		ImGui::CloseCurrentPopup();
+	}
+
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	ImGui::BeginChild("##Results", { 0.0f, rowHeight * float(std::min<size_t>(results.size(), 16)) });
+	ImGuiListClipper clipper;
+	clipper.Begin(int(results.size()), rowHeight);
+	if (scrollToSelected) {
+		clipper.IncludeItemByIndex(int(m_selected));
+	}
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const auto path = m_index.path(results[size_t(row)].path);
+			const auto name = path.substr(m_index.nameOffset(results[size_t(row)].path));
+			ImGui::PushID(row);
+			if (ImGui::Selectable("##Result", size_t(row) == m_selected)) {
+				choose(size_t(row));
+			}
+			if (scrollToSelected && size_t(row) == m_selected) {
+				ImGui::SetScrollHereY();
+			}
+			ImGui::SameLine();
+			ImGui::TextUnformatted(name.data(), name.data() + name.size());
+			ImGui::SameLine();
+			ImGui::TextDisabled("%.*s", int(path.size() - name.size()), path.data());
+			ImGui::PopID();
+		}
+	}
+	clipper.End();
+	ImGui::EndChild();
+
+	ImGui::TextDisabled("%zu of %zu files", m_matcher.matchCount(), m_index.fileCount());
+	ImGui::EndPopup();
+}
+
+void SearchPanel::restart() {
+	m_hits.clear();
+	if (index != nullptr && index->isOpen() && m_query[0] != '\0') {
+		m_invalidQuery = !m_search.start(m_query, options, index->candidates(m_query, options.regex));
+	} else {
+		m_invalidQuery = !m_search.start(m_query, options);
+	}
+}
+
+void SearchPanel::search(const std::string& query) {
+	std::snprintf(m_query, sizeof(m_query), "%s", query.c_str());
+	restart();
+}
+
+void SearchPanel::show() {
+	m_search.poll(m_hits);
+	// Nothing wakes the loop for streamed hits, frames are asked for while the search runs. The one after it ended
+	// picks up the hits published last.
+	if (m_search.isRunning()) {
+		markDirty();
+		Application::RequestFrameIn(SearchRefreshSeconds);
+	}
+
+	bool changed = false;
+	ImGui::SetNextItemWidth(-ImGui::GetFrameHeight() * 4.0f);
+	changed |= ImGui::InputTextWithHint("##Find", "Find in files", m_query, sizeof(m_query));
+	ImGui::SameLine();
+	bool matchCase = !options.ignoreCase;
+	changed |= ImGui::Checkbox("Aa", &matchCase);
+	options.ignoreCase = !matchCase;
+	ImGui::SameLine();
+	changed |= ImGui::Checkbox(".*", &options.regex);
+	if (changed) {
+		// Restarting cancels the previous search, every keystroke gets fresh results.
+		restart();
+	}
+
+	if (m_invalidQuery) {
+		ImGui::TextDisabled("Invalid regular expression");
+	} else if (m_search.isRunning()) {
+		ImGui::TextDisabled("%zu results, searching %zu of %zu files...", m_hits.size(), m_search.filesSearched(), m_search.fileCount());
+	} else if (m_query[0] != '\0') {
+		ImGui::TextDisabled("%zu results in %zu files", m_hits.size(), m_search.filesSearched());
+	}
+
+	ImGui::BeginChild("##SearchResults");
+	ImGuiListClipper clipper;
+	clipper.Begin(int(m_hits.size()));
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const auto& hit = m_hits[size_t(row)];
+			m_hitPath.clear();
+			InternedPaths.append(m_search.file(hit.file), m_hitPath);
+			ImGui::PushID(row);
+			if (ImGui::Selectable("##Hit") && OnSelected != nullptr) {
+				OnSelected(m_search.root() / std::filesystem::u8path(m_hitPath), hit.line, hit.column);
+			}
+			ImGui::SameLine();
+			ImGui::TextDisabled("%s:%u", m_hitPath.c_str(), hit.line);
+			ImGui::SameLine();
+			ImGui::TextUnformatted(hit.preview.c_str(), hit.preview.c_str() + hit.preview.size());
+			ImGui::PopID();
+		}
+	}
+	clipper.End();
+	ImGui::EndChild();
+}
+
+void ImEdGui_Init() {
+	// Icons are embedded pre-decoded, they only need to be handed to the atlas.
+	if (auto asset = ImEdGui_FindAsset("folder.png")) {
+		ImgFolder = UiIcons.add(asset->pixels, asset->width, asset->height, 4);
+	}
+	if (auto asset = ImEdGui_FindAsset("file.png")) {
+		ImgFile = UiIcons.add(asset->pixels, asset->width, asset->height, 4);
+	}
+	FileIcons.setDefaultIcon(ImgFile);
+}
+
+void ImEdGui_NewFrame() {
+	FileIcons.update();
+	if (UiIcons.needsRebuild()) {
+		UiIcons.build();
 	}
 }
 
@@ -2,11 +2,30 @@
 
 #include "imed_gui_common.hpp"
 #include "imed_gui_types.hpp"
+#include "imed_gui_filetree.hpp"
+#include "imed_gui_fuzzy.hpp"
+#include "imed_gui_search.hpp"
+#include "imed_gui_trigram.hpp"
 
 #include <filesystem>
+#include <future>
 
+// Widgets remember whether they changed since they were last drawn, so the frame loop can tell if a frame would look
+// any different and containers know which of their subtrees did not change.
 struct IWidget {
 	virtual void show() = 0;
+
+	// Showing the widget again could draw something else than last time, input aside. True until it was drawn once
+	// and after markDirty(), widgets fed by background work or files also report results they did not pick up yet.
+	[[nodiscard]] virtual bool isDirty() const { return m_dirty; }
+	// Needed after changing public fields or callbacks of a widget from outside, its own handlers and setters call it
+	// already.
+	inline void markDirty() { m_dirty = true; }
+	// Shows the widget and marks it clean, containers draw their children through it. A show() that needs
+	// another frame, after picking up a result for example, calls markDirty().
+	inline void draw() { m_dirty = false; show(); }
+private:
+	bool m_dirty = true;
 };
 
 template<typename T>
@@ -22,6 +41,7 @@ public:
 	template<WidgetType T>
 	void addWidget(const T& widget);
 
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 };
 
@@ -37,6 +57,8 @@ public:
 	explicit Label(std::string&& label) noexcept: label(std::move(label)) { }
 	explicit Label(const std::string& label): label(label) { }
 
+	inline void setLabel(std::string text) { label = std::move(text); markDirty(); }
+
 	void show() override;
 };
 
@@ -47,6 +69,8 @@ public:
 	explicit Separator(std::string&& label) noexcept: label(std::move(label)) { }
 	explicit Separator(const std::string& label = ""): label(label) { }
 
+	inline void setLabel(std::string text) { label = std::move(text); markDirty(); }
+
 	void show() override;
 };
 
@@ -57,7 +81,7 @@ public:
 
 	explicit TextInput(const std::string& label, size_t bufferSize);
 
-	std::string& buffer() { return m_buffer; }
+	std::string& buffer() { markDirty(); return m_buffer; }
 	[[nodiscard]] const std::string& buffer() const { return m_buffer; }
 
 	ImGuiInputTextCallback callback = nullptr;
@@ -137,6 +161,9 @@ public:
 	Button(const std::string& label, const std::function<void()>& clicked):
 		label(label), OnClicked(clicked) { }
 
+	inline void setLabel(std::string text) { label = std::move(text); markDirty(); }
+	inline void setOnClicked(std::function<void()> clicked) { OnClicked = std::move(clicked); markDirty(); }
+
 	void show() override;
 
 	std::function<void()> OnClicked;
@@ -150,6 +177,9 @@ public:
 	ImageButton(const Image& image, const Vec2& imageSize, const std::function<void()>& clicked):
 		image(image), size(imageSize), OnClicked(clicked) { }
 
+	inline void setImage(const Image& newImage) { image = newImage; markDirty(); }
+	inline void setOnClicked(std::function<void()> clicked) { OnClicked = std::move(clicked); markDirty(); }
+
 	void show() override;
 
 	std::function<void()> OnClicked;
@@ -179,6 +209,9 @@ public:
 	MenuItem(const std::string& label, std::string&& shortcut, const std::function<void()>& onClicked):
 		label(label), shortcut(std::move(shortcut)), onClicked(onClicked) { }
 
+	inline void setLabel(std::string text) { label = std::move(text); markDirty(); }
+	inline void setEnabled(bool value) { enabled = value; markDirty(); }
+
 	void show() override;
 
 	bool enabled = true;
@@ -197,6 +230,10 @@ public:
 	void addSeparator(Separator&& separator);
 	void addSeparator(const Separator& separator);
 
+	inline void setLabel(std::string text) { label = std::move(text); markDirty(); }
+	inline void setEnabled(bool value) { enabled = value; markDirty(); }
+
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 
 	bool enabled = true;
@@ -211,10 +248,12 @@ public:
 	void addMenu(Menu&& menu);
 	void addMenu(const Menu& menu);
 
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 };
 
 class TabItem : public IWidget {
+	bool m_selected = false;
 public:
 	std::string label;
 
@@ -225,6 +264,11 @@ public:
 	bool isOpen;
 	std::shared_ptr<IWidget> content;
 
+	inline void setLabel(std::string text) { label = std::move(text); markDirty(); }
+	inline void setContent(std::shared_ptr<IWidget> widget) { content = std::move(widget); markDirty(); }
+
+	// Only the content of the selected tab counts, the others are not drawn.
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 };
 
@@ -239,6 +283,7 @@ public:
 	void addTab(TabItem&& item);
 	void addTab(const TabItem& item);
 
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 };
 
@@ -258,6 +303,7 @@ public:
 	template<WidgetType T>
 	void addWidget(int column, const T& widget);
 
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 };
 
@@ -277,30 +323,139 @@ public:
 
 	std::function<void(const TreeNode&)> OnSelected;
 
+	inline void setLabel(std::string text) { label = std::move(text); markDirty(); }
+
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 };
 
-class FreeTreeNode;
-
 class FreeTreeNode : public IWidget {
+	struct VisibleRow {
+		FileTree::NodeId node;
+		uint32_t depth;
+	};
+	struct Revalidation {
+		std::vector<FileEvent> events;
+		std::vector<FileStat> stats;    // Per event
+	};
+
+	std::vector<VisibleRow> m_rows;
+	std::vector<uint8_t> m_expanded;
+	std::unique_ptr<FileWatcher> m_watcher;
+	ScanOptions m_watchOptions;
+	std::filesystem::path m_snapshotPath;
+	std::future<Revalidation> m_revalidation;
+	std::future<std::vector<ScanEntry>> m_rescan;   // The watcher's listing, or a scan after it lost events, the tree is diffed against it
+	std::vector<FileEvent> m_pendingEvents;
+	std::future<bool> m_saving;
+
+	void appendVisibleDescendants(std::vector<VisibleRow>& rows, FileTree::NodeId node, uint32_t depth) const;
+	void expandRow(size_t row);
+	void collapseRow(size_t row);
+	void refreshChildren(FileTree::NodeId node);
+	void applyFileEvents(std::vector<FileEvent>&& events);
+	void finishRevalidation();
+	void finishRescan();
 public:
-	std::vector<FreeTreeNode> nodes;
-	std::filesystem::path path;
+	FileTree tree;
+
+	explicit FreeTreeNode(const std::filesystem::path& rootPath): tree(rootPath) { }
+	explicit FreeTreeNode(FileTree&& tree) noexcept: tree(std::move(tree)) { }
+
+	std::function<void(const FreeTreeNode&, FileTree::NodeId)> OnSelected;
+	// Receives every batch of watcher events after it was applied to the tree, for indexes built on the workspace.
+	std::function<void(const std::vector<FileEvent>&)> OnFilesChanged;
+
+	// Keeps the tree in sync with the disk, changes are applied incrementally at the start of show().
+	bool watch(FileWatcherBackend backend = FileWatcherBackend::Inotify, const ScanOptions& options = { });
+	[[nodiscard]] inline FileWatcher* watcher() const { return m_watcher.get(); }
+
+	[[nodiscard]] bool isExpanded(FileTree::NodeId node) const;
+	void setExpanded(FileTree::NodeId node, bool expanded);
 
-	FreeTreeNode(const std::filesystem::path& path, const std::initializer_list<FreeTreeNode>& children);
-	FreeTreeNode(const std::filesystem::path& path, const std::vector<FreeTreeNode>& children);
-	FreeTreeNode(std::filesystem::path&& path, const std::initializer_list<FreeTreeNode>& children);
-	FreeTreeNode(std::filesystem::path&& path, const std::vector<FreeTreeNode>& children);
-	FreeTreeNode(const std::filesystem::path& path, std::vector<FreeTreeNode>&& children);
-	FreeTreeNode(std::filesystem::path&& path, std::vector<FreeTreeNode>&& children);
+	// Rebuilds the visible row list from scratch, only needed after the tree was replaced wholesale.
+	void refreshRows();
 
-	std::function<void(const FreeTreeNode&)> OnSelected;
+	// True while a tree loaded from a snapshot is being compared against the disk.
+	[[nodiscard]] inline bool isRevalidating() const { return m_revalidation.valid(); }
+	// Writes the tree to the workspace snapshot on a background thread, false for trees not built by BuildFromDirPath.
+	bool saveSnapshot();
 
+	// Also dirty while watcher events or the revalidation result wait to be applied.
+	[[nodiscard]] bool isDirty() const override;
 	void show() override;
 
+	// Shows the workspace snapshot of the previous session right away and revalidates it against the disk in the
+	// background, the differences arrive as regular file events. Without a usable snapshot the workspace is scanned.
 	static FreeTreeNode BuildFromDirPath(const std::filesystem::path& rootPath);
 };
 
-void ImEdGui_Init(const std::filesystem::path& basedir);
+// Ctrl+P style "go to file" popup, matching against an index of the workspace that is built in the background.
+class QuickOpen : public IWidget {
+	std::filesystem::path m_root;
+	PathIndex m_index;
+	FuzzyMatcher m_matcher;
+	std::future<PathIndex> m_indexing;
+	std::vector<FileEvent> m_pendingEvents;
+	char m_query[512] = { };
+	bool m_opening = false;
+	size_t m_selected = 0;
+
+	void choose(size_t result);
+public:
+	explicit QuickOpen(const std::filesystem::path& rootPath);
+	QuickOpen(const QuickOpen&) = delete;
+	QuickOpen& operator= (const QuickOpen&) = delete;
+
+	ImGuiKeyChord shortcut = ImGuiMod_Ctrl | ImGuiKey_P;
+	std::function<void(const std::filesystem::path&)> OnOpened;
+
+	void rebuildIndex(const ScanOptions& options = { });
+	// Connect to FreeTreeNode::OnFilesChanged to keep the index current without rescanning.
+	void applyFileEvents(const std::vector<FileEvent>& events);
+
+	[[nodiscard]] inline bool isIndexing() const { return m_indexing.valid(); }
+	[[nodiscard]] inline const PathIndex& index() const { return m_index; }
+
+	void open();
+	[[nodiscard]] bool isDirty() const override;
+	void show() override;
+};
+
+// Find in files panel, results stream in while the search runs and are drawn through a clipped list.
+class SearchPanel : public IWidget {
+	WorkspaceSearch m_search;
+	std::vector<SearchHit> m_hits;
+	std::string m_hitPath;  // Reused for every row drawn
+	char m_query[512] = { };
+	bool m_invalidQuery = false;
+
+	void restart();
+public:
+	explicit SearchPanel(const std::filesystem::path& rootPath): m_search(rootPath) { }
+	// Searches the workspace root of a file tree.
+	explicit SearchPanel(const FreeTreeNode& tree): m_search(tree.tree.rootPath()) { }
+
+	SearchOptions options;
+	// Optional index over the same root, only its candidate files are searched when set. Kept current by the
+	// caller, e.g. by forwarding FreeTreeNode::OnFilesChanged to TrigramIndex::applyEvents.
+	TrigramIndex* index = nullptr;
+	std::function<void(const std::filesystem::path&, uint32_t line, uint32_t column)> OnSelected;
+
+	void search(const std::string& query);
+	// The workspace is listed by the first search and reused by later ones, forward FreeTreeNode::OnFilesChanged
+	// here so new and deleted files are picked up.
+	inline void invalidateFiles() { m_search.invalidateFiles(); }
+	[[nodiscard]] inline const std::vector<SearchHit>& hits() const { return m_hits; }
+
+	// Hits stream in for as long as the search runs.
+	[[nodiscard]] inline bool isDirty() const override { return IWidget::isDirty() || m_search.isRunning(); }
+	void show() override;
+};
+
+void ImEdGui_Init();
+// Uploads pending icons and repacks the atlas, call once per frame before the ImGui backends start a new frame.
+void ImEdGui_NewFrame();
 
+// Consulted once per unknown extension (including the leading dot), results are cached by FileIcons.
 extern std::function<Image(const std::string&)> FileIconProvider;
\ No newline at end of file
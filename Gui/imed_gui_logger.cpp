@@ -0,0 +1,470 @@
+#include "imed_gui_logger.hpp"
+
+#include <fmt/args.h>
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+AsyncLogger Logger;
+
+// Longest the drain thread sleeps while nobody asks for a flush.
+static constexpr auto FlushInterval = std::chrono::milliseconds(50);
+static constexpr size_t MinRingCapacity = 4096;
+
+static std::atomic<uint64_t> NextLoggerId = 1;
+
+// Format strings the logger writes itself, referenced by binary files like any other literal.
+static constexpr const char* TextFormat = "{}";
+static constexpr const char* DroppedFormat = "{} log messages dropped, the ring of a logging thread was full";
+
+AsyncLogger::AsyncLogger(): m_id(NextLoggerId.fetch_add(1)) { }
+
+AsyncLogger::~AsyncLogger() {
+	m_stop = true;
+	requestWake();
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+	drain();
+	closeFile();
+}
+
+AsyncLogger::Ring& AsyncLogger::threadRing() {
+	// Rings are owned by the logger as well, so whatever a thread logged right before exiting is still drained.
+	struct ThreadRings {
+		std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+		~ThreadRings() {
+			for (auto& [id, ring] : rings) {
+				ring->closed.store(true, std::memory_order_release);
+			}
+		}
+	};
+	thread_local ThreadRings local;
+	for (auto& [id, ring] : local.rings) {
+		if (id == m_id) {
+			return *ring;
+		}
+	}
+
+	auto ring = std::make_shared<Ring>(std::bit_ceil(std::max(ringCapacity, MinRingCapacity)));
+	{
+		std::lock_guard lock(m_mutex);
+		m_rings.push_back(ring);
+	}
+	local.rings.emplace_back(m_id, ring);
+	return *ring;
+}
+
+uint8_t* AsyncLogger::reserve(Ring& ring, size_t size, bool wait, uint64_t& end) {
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+	const auto offset = size_t(head & (ring.capacity - 1));
+	// Records never wrap, the rest of the buffer is skipped with a padding record instead.
+	const size_t padding = offset + size > ring.capacity ? ring.capacity - offset : 0;
+	while (head + padding + size - ring.tail.load(std::memory_order_acquire) > ring.capacity) {
+		if (!wait) {
+			return nullptr;
+		}
+		requestWake();
+		std::this_thread::yield();
+	}
+
+	if (padding != 0) {
+		auto* header = reinterpret_cast<RecordHeader*>(ring.buffer.get() + offset);
+		header->size = uint32_t(padding);
+		header->kind = RecordKind::Padding;
+	}
+	end = head + padding + size;
+	return ring.buffer.get() + ((head + padding) & (ring.capacity - 1));
+}
+
+void AsyncLogger::log(DebugMessageType type, const DebugInfo& info, std::string_view message) {
+	std::call_once(m_started, [this]() { m_thread = std::thread(&AsyncLogger::run, this); });
+
+	Ring& ring = threadRing();
+	const bool urgent = type == DebugMessageType::Error || type == DebugMessageType::FatalError;
+	message = message.substr(0, std::min(message.size(), ring.capacity / 2 - sizeof(RecordHeader)));
+	const size_t size = AlignRecord(sizeof(RecordHeader) + message.size());
+	uint64_t end;
+	uint8_t* bytes = reserve(ring, size, urgent || overflow == OverflowPolicy::Block, end);
+	if (bytes == nullptr) {
+		ring.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	FillHeader(reinterpret_cast<RecordHeader*>(bytes), size, RecordKind::Text, type, info, uint32_t(message.size()));
+	std::memcpy(bytes + sizeof(RecordHeader), message.data(), message.size());
+	commit(ring, end, urgent);
+}
+
+void AsyncLogger::FillHeader(RecordHeader* header, size_t size, RecordKind kind, DebugMessageType type, const DebugInfo& info, uint32_t length) {
+	header->size = uint32_t(size);
+	header->kind = kind;
+	header->type = uint8_t(type);
+	header->line = uint32_t(info.callerLine);
+	header->length = length;
+	header->time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	header->file = info.callerFile;
+	header->function = info.callerFunction;
+}
+
+void AsyncLogger::commit(Ring& ring, uint64_t end, bool urgent) {
+	ring.head.store(end, std::memory_order_release);
+
+	// Past half full the drain thread is woken early, so a burst does not have to wait out the interval.
+	if (urgent || end - ring.tail.load(std::memory_order_relaxed) > ring.capacity / 2) {
+		requestWake();
+	}
+}
+
+void AsyncLogger::requestWake() {
+	m_wakeRequested.store(true, std::memory_order_release);
+	m_wake.notify_one();
+}
+
+void AsyncLogger::run() {
+	std::unique_lock lock(m_wakeMutex);
+	while (!m_stop.load(std::memory_order_acquire)) {
+		m_wake.wait_for(lock, FlushInterval, [this]() { return m_stop.load() || m_wakeRequested.exchange(false); });
+		lock.unlock();
+		drain();
+		lock.lock();
+	}
+}
+
+void AsyncLogger::flush() {
+	drain();
+}
+
+void AsyncLogger::drain() {
+	std::lock_guard drainLock(m_drainMutex);
+	{
+		std::lock_guard lock(m_mutex);
+		m_draining = m_rings;
+	}
+
+	// Records are only referenced until the batch is formatted, the tails move once nothing points into the rings.
+	const bool text = m_stdout || m_history != nullptr || (m_file != nullptr && m_fileFormat == FileFormat::Text);
+	const bool binary = m_file != nullptr && m_fileFormat == FileFormat::Binary;
+	m_pending.clear();
+	m_drainEnd.resize(m_draining.size());
+	m_batch.clear();
+	m_batchLines.clear();
+	m_binary.clear();
+	for (size_t i = 0; i < m_draining.size(); i++) {
+		Ring& ring = *m_draining[i];
+		const uint64_t head = ring.head.load(std::memory_order_acquire);
+		for (uint64_t position = ring.tail.load(std::memory_order_relaxed); position < head; ) {
+			const auto* header = reinterpret_cast<const RecordHeader*>(ring.buffer.get() + (position & (ring.capacity - 1)));
+			if (header->kind != RecordKind::Padding) {
+				m_pending.push_back({ header->time, header });
+			}
+			position += header->size;
+		}
+		m_drainEnd[i] = head;
+
+		if (const uint64_t dropped = ring.dropped.exchange(0, std::memory_order_relaxed); dropped != 0) {
+			m_dropped.fetch_add(dropped, std::memory_order_relaxed);
+			const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			if (text) {
+				const size_t begin = m_batch.size();
+				FormatPrefix(m_batch, now, DebugMessageType::Warning, { }, 0, { });
+				fmt::format_to(std::back_inserter(m_batch), DroppedFormat, dropped);
+				m_batchLines.push_back({ begin, m_batch.size(), DebugMessageType::Warning });
+				m_batch.push_back('\n');
+			}
+			if (binary) {
+				uint8_t argument[1 + sizeof(uint64_t)];
+				Encode(argument, uint64_t(dropped));
+				appendBinaryMessage(now, DebugMessageType::Warning, DroppedFormat, nullptr, nullptr, 0, 1, argument, sizeof(argument));
+			}
+		}
+	}
+
+	// Per ring the records are in order already, the sort interleaves the threads.
+	std::stable_sort(m_pending.begin(), m_pending.end(), [](const Pending& a, const Pending& b) { return a.time < b.time; });
+	for (const auto& pending : m_pending) {
+		const auto* header = pending.header;
+		if (binary) {
+			appendBinary(header);
+		}
+		if (!text) {
+			continue;
+		}
+		const size_t begin = m_batch.size();
+		FormatPrefix(m_batch, header->time, DebugMessageType(header->type), header->file, header->line, header->function);
+		if (header->kind == RecordKind::Deferred) {
+			const auto* deferred = reinterpret_cast<const DeferredHeader*>(header + 1);
+			const auto* arguments = reinterpret_cast<const uint8_t*>(deferred + 1);
+			FormatArguments(m_batch, std::string_view(deferred->format, deferred->formatLength), arguments,
+				reinterpret_cast<const uint8_t*>(header + 1) + header->length, deferred->argumentCount);
+		} else {
+			m_batch.append(reinterpret_cast<const char*>(header + 1), header->length);
+		}
+		m_batchLines.push_back({ begin, m_batch.size(), DebugMessageType(header->type) });
+		m_batch.push_back('\n');
+	}
+	if (m_history != nullptr && !m_batchLines.empty()) {
+		auto lock = m_history->lock();
+		for (const auto& line : m_batchLines) {
+			m_history->append(std::string_view(m_batch).substr(line.begin, line.end - line.begin), line.type);
+		}
+		if (m_history->OnAppend) {
+			m_history->OnAppend();
+		}
+	}
+	m_written.fetch_add(m_pending.size(), std::memory_order_relaxed);
+
+	for (size_t i = 0; i < m_draining.size(); i++) {
+		m_draining[i]->tail.store(m_drainEnd[i], std::memory_order_release);
+	}
+	write();
+
+	std::lock_guard lock(m_mutex);
+	std::erase_if(m_rings, [](const std::shared_ptr<Ring>& ring) {
+		return ring->closed.load(std::memory_order_acquire) && ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+	});
+}
+
+uint32_t AsyncLogger::stringId(const char* text) {
+	if (text == nullptr) {
+		return 0;
+	}
+	auto [it, inserted] = m_stringIds.try_emplace(text, uint32_t(m_stringIds.size() + 1));
+	if (inserted) {
+		const std::string_view bytes(text);
+		const BinaryString entry { it->second, uint32_t(bytes.size()) };
+		m_binary.push_back(char(BinaryEntry::String));
+		m_binary.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+		m_binary.append(bytes);
+	}
+	return it->second;
+}
+
+void AsyncLogger::appendBinary(const RecordHeader* header) {
+	if (header->kind == RecordKind::Deferred) {
+		// The packed arguments are already in the file format.
+		const auto* deferred = reinterpret_cast<const DeferredHeader*>(header + 1);
+		appendBinaryMessage(header->time, DebugMessageType(header->type), deferred->format, header->file, header->function, header->line,
+			uint16_t(deferred->argumentCount), deferred + 1, header->length - sizeof(DeferredHeader));
+		return;
+	}
+
+	// Plain messages become "{}" with the text as its argument.
+	const uint8_t tag = uint8_t(ArgumentTag::String);
+	const uint32_t length = header->length;
+	appendBinaryMessage(header->time, DebugMessageType(header->type), TextFormat, header->file, header->function, header->line,
+		1, nullptr, sizeof(tag) + sizeof(length) + length);
+	m_binary.push_back(char(tag));
+	m_binary.append(reinterpret_cast<const char*>(&length), sizeof(length));
+	m_binary.append(reinterpret_cast<const char*>(header + 1), length);
+}
+
+void AsyncLogger::appendBinaryMessage(int64_t time, DebugMessageType type, const char* format, const char* file, const char* function, uint32_t line,
+	uint16_t argumentCount, const void* arguments, size_t argumentsSize) {
+	BinaryMessage message { };
+	message.time = time;
+	message.format = stringId(format);
+	message.file = stringId(file);
+	message.function = stringId(function);
+	message.line = line;
+	message.argumentsSize = uint32_t(argumentsSize);
+	message.argumentCount = argumentCount;
+	message.type = uint8_t(type);
+	m_binary.push_back(char(BinaryEntry::Message));
+	m_binary.append(reinterpret_cast<const char*>(&message), sizeof(message));
+	// Without arguments the caller appends them itself.
+	if (arguments != nullptr) {
+		m_binary.append(static_cast<const char*>(arguments), argumentsSize);
+	}
+}
+
+void AsyncLogger::FormatPrefix(std::string& out, int64_t time, DebugMessageType type, std::string_view file, uint32_t line, std::string_view function) {
+	const std::chrono::system_clock::time_point point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(time)));
+	if (file.empty()) {
+		fmt::format_to(std::back_inserter(out), "{} [{}] ", point, TypeName(type));
+	} else {
+		fmt::format_to(std::back_inserter(out), "{} [{}] {}:{} {} - ", point, TypeName(type), file, line, function);
+	}
+}
+
+bool AsyncLogger::FormatArguments(std::string& out, std::string_view format, const uint8_t* arguments, const uint8_t* end, uint32_t count) {
+	const uint8_t* in = arguments;
+	const auto read = [&in, end]<typename V>(V& value) {
+		if (size_t(end - in) < sizeof(V)) {
+			return false;
+		}
+		std::memcpy(&value, in, sizeof(V));
+		in += sizeof(V);
+		return true;
+	};
+	// Strings are referenced, not copied, the record stays in the ring until the batch is formatted.
+	fmt::dynamic_format_arg_store<fmt::format_context> store;
+	store.reserve(count, 0);
+	bool valid = true;
+	for (uint32_t i = 0; i < count && valid; i++) {
+		uint8_t tag;
+		if (!read(tag)) {
+			valid = false;
+			break;
+		}
+		switch (ArgumentTag(tag)) {
+			case ArgumentTag::Bool: { uint8_t value; if ((valid = read(value))) store.push_back(value != 0); break; }
+			case ArgumentTag::Char: { char value; if ((valid = read(value))) store.push_back(value); break; }
+			case ArgumentTag::Int: { int64_t value; if ((valid = read(value))) store.push_back(value); break; }
+			case ArgumentTag::UInt: { uint64_t value; if ((valid = read(value))) store.push_back(value); break; }
+			case ArgumentTag::Float: { float value; if ((valid = read(value))) store.push_back(value); break; }
+			case ArgumentTag::Double: { double value; if ((valid = read(value))) store.push_back(value); break; }
+			case ArgumentTag::Pointer: { const void* value; if ((valid = read(value))) store.push_back(value); break; }
+			case ArgumentTag::String: {
+				uint32_t length;
+				valid = read(length) && size_t(end - in) >= length;
+				if (valid) {
+					store.push_back(std::string_view(reinterpret_cast<const char*>(in), length));
+					in += length;
+				}
+				break;
+			}
+			default: valid = false; break;
+		}
+	}
+	if (!valid) {
+		fmt::format_to(std::back_inserter(out), "{} (malformed arguments)", format);
+		return false;
+	}
+	try {
+		fmt::vformat_to(std::back_inserter(out), fmt::string_view(format.data(), format.size()), store);
+	} catch (const fmt::format_error& error) {
+		fmt::format_to(std::back_inserter(out), "{} ({})", format, error.what());
+	}
+	return true;
+}
+
+void AsyncLogger::write() {
+	if (m_stdout && !m_batch.empty()) {
+		std::fwrite(m_batch.data(), 1, m_batch.size(), stdout);
+		std::fflush(stdout);
+	}
+	const std::string& data = m_fileFormat == FileFormat::Binary ? m_binary : m_batch;
+	if (m_file != nullptr && !data.empty()) {
+		std::fwrite(data.data(), 1, data.size(), m_file);
+		std::fflush(m_file);
+		m_fileSize += data.size();
+		if (m_maxFileSize != 0 && m_fileSize >= m_maxFileSize) {
+			rotate();
+		}
+	}
+}
+
+void AsyncLogger::rotate() {
+	std::fclose(m_file);
+	m_file = nullptr;
+
+	std::error_code error;
+	const auto numbered = [this](size_t index) {
+		auto path = m_filePath;
+		path += fmt::format(".{}", index);
+		return path;
+	};
+	if (m_maxFiles != 0) {
+		std::filesystem::remove(numbered(m_maxFiles), error);
+		for (size_t index = m_maxFiles; index > 1; index--) {
+			std::filesystem::rename(numbered(index - 1), numbered(index), error);
+		}
+		std::filesystem::rename(m_filePath, numbered(1), error);
+	} else {
+		std::filesystem::remove(m_filePath, error);
+	}
+
+	openFile();
+}
+
+bool AsyncLogger::openFile() {
+	m_file = std::fopen(m_filePath.string().c_str(), "ab");
+	if (m_file == nullptr) {
+		return false;
+	}
+	std::error_code error;
+	const auto size = std::filesystem::file_size(m_filePath, error);
+	m_fileSize = error ? 0 : size;
+	// Every binary file is decodable on its own, the strings are written again after opening.
+	m_stringIds.clear();
+	if (m_fileFormat == FileFormat::Binary && m_fileSize == 0) {
+		std::fwrite(BinaryMagic, 1, sizeof(BinaryMagic), m_file);
+		m_fileSize = sizeof(BinaryMagic);
+	}
+	return true;
+}
+
+void AsyncLogger::setStdout(bool enabled) {
+	std::lock_guard lock(m_drainMutex);
+	m_stdout = enabled;
+}
+
+bool AsyncLogger::setFile(const std::filesystem::path& path, uint64_t maxSize, size_t maxFiles, FileFormat format) {
+	std::lock_guard lock(m_drainMutex);
+	if (m_file != nullptr) {
+		std::fclose(m_file);
+	}
+	m_filePath = path;
+	m_maxFileSize = maxSize;
+	m_maxFiles = maxFiles;
+	m_fileFormat = format;
+	return openFile();
+}
+
+void AsyncLogger::closeFile() {
+	std::lock_guard lock(m_drainMutex);
+	if (m_file != nullptr) {
+		std::fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+std::shared_ptr<LogHistory> AsyncLogger::enableHistory(size_t byteCapacity, size_t lineCapacity) {
+	std::lock_guard lock(m_drainMutex);
+	if (m_history == nullptr) {
+		m_history = std::make_shared<LogHistory>(byteCapacity, lineCapacity);
+	}
+	return m_history;
+}
+
+LogHistory::LogHistory(size_t byteCapacity, size_t lineCapacity):
+	m_bytes(std::make_unique_for_overwrite<char[]>(std::bit_ceil(std::max<size_t>(byteCapacity, 4096)))),
+	m_byteCapacity(std::bit_ceil(std::max<size_t>(byteCapacity, 4096))),
+	m_lines(std::make_unique_for_overwrite<Line[]>(std::bit_ceil(std::max<size_t>(lineCapacity, 64)))),
+	m_lineCapacity(std::bit_ceil(std::max<size_t>(lineCapacity, 64))) { }
+
+void LogHistory::append(std::string_view text, DebugMessageType type) {
+	text = text.substr(0, std::min(text.size(), m_byteCapacity / 4));
+	uint64_t start = m_byteEnd;
+	const auto offset = size_t(start & (m_byteCapacity - 1));
+	if (offset + text.size() > m_byteCapacity) {
+		start += m_byteCapacity - offset;
+	}
+	const uint64_t end = start + text.size();
+	while (m_firstLine < m_endLine && m_lines[m_firstLine & (m_lineCapacity - 1)].offset + m_byteCapacity < end) {
+		m_firstLine++;
+	}
+	if (m_endLine - m_firstLine == m_lineCapacity) {
+		m_firstLine++;
+	}
+
+	std::memcpy(m_bytes.get() + (start & (m_byteCapacity - 1)), text.data(), text.size());
+	m_lines[m_endLine & (m_lineCapacity - 1)] = { start, uint32_t(text.size()), type };
+	m_endLine++;
+	m_byteEnd = end;
+}
+
+std::string_view AsyncLogger::TypeName(DebugMessageType type) {
+	switch (type) {
+		case DebugMessageType::Info: return "Info";
+		case DebugMessageType::Warning: return "Warning";
+		case DebugMessageType::Error: return "Error";
+		case DebugMessageType::FatalError: return "Fatal";
+	}
+	return "Info";
+}
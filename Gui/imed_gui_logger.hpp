@@ -0,0 +1,347 @@
+#pragma once
+
+#include "imed_gui_common.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+// Messages below this level are compiled out of ImEdLogFormat calls, arguments included. Release builds keep only
+// errors, the same as ImEdLogImpl does at runtime. 0 Info, 1 Warning, 2 Error, 3 Fatal.
+#if !defined(IMED_LOG_LEVEL)
+	#if defined(NDEBUG)
+		#define IMED_LOG_LEVEL 2
+	#else
+		#define IMED_LOG_LEVEL 0
+	#endif
+#endif
+
+// The latest formatted lines kept in memory for the log console, in a byte ring and a line ring of fixed size.
+// Lines never wrap around the end of the byte ring and are dropped oldest first once their bytes are reused.
+// Line numbers only grow, readers keep them across appends and check them against firstLine().
+class LogHistory {
+public:
+	struct Line {
+		uint64_t offset;            // Position in the byte ring, only grows like the line numbers
+		uint32_t length;
+		DebugMessageType type;
+	};
+private:
+	mutable std::mutex m_mutex;
+	std::unique_ptr<char[]> m_bytes;
+	size_t m_byteCapacity;
+	std::unique_ptr<Line[]> m_lines;
+	size_t m_lineCapacity;
+	uint64_t m_byteEnd = 0;
+	uint64_t m_firstLine = 0;
+	uint64_t m_endLine = 0;
+public:
+	// Both capacities are rounded up to powers of two.
+	LogHistory(size_t byteCapacity, size_t lineCapacity);
+
+	// Everything below needs the lock, the drain thread appends while holding it.
+	[[nodiscard]] inline std::unique_lock<std::mutex> lock() const { return std::unique_lock(m_mutex); }
+	void append(std::string_view text, DebugMessageType type);
+	// Called by the drain thread after each batch, with the lock held.
+	std::function<void()> OnAppend;
+	[[nodiscard]] inline uint64_t firstLine() const { return m_firstLine; }
+	[[nodiscard]] inline uint64_t endLine() const { return m_endLine; }
+	// Valid until the lock is released.
+	[[nodiscard]] inline std::string_view text(uint64_t line) const {
+		const Line& entry = m_lines[line & (m_lineCapacity - 1)];
+		return { m_bytes.get() + (entry.offset & (m_byteCapacity - 1)), entry.length };
+	}
+	[[nodiscard]] inline DebugMessageType type(uint64_t line) const { return m_lines[line & (m_lineCapacity - 1)].type; }
+};
+
+// Logging that costs the calling thread a clock read and a copy. Every thread appends to its own lock-free ring,
+// a background thread drains all of them in timestamp order and writes the lines in batches to stdout and to a
+// rotating log file, as text or in the binary format imed-logdecode reads.
+class AsyncLogger {
+public:
+	enum class OverflowPolicy : uint8_t {
+		Drop,       // Counted and reported once there is room again
+		Block       // The caller waits for the drain thread
+	};
+	enum class FileFormat : uint8_t {
+		Text, Binary
+	};
+	// Arguments are packed one after another, a tag byte followed by the value in native byte order. Strings are
+	// a uint32_t length and the bytes. Everything without a tag is formatted on the caller and stored as a string.
+	enum class ArgumentTag : uint8_t {
+		Bool, Char, Int, UInt, Float, Double, Pointer, String
+	};
+
+	// Binary files start with BinaryMagic, then entries of a BinaryEntry byte and the struct it names. Format
+	// strings, files and functions are written once per file as BinaryString and referenced by id, 0 is none.
+	// Messages are followed by their packed arguments. Appending to a file redefines the ids.
+	static constexpr char BinaryMagic[8] = { 'I', 'M', 'E', 'D', 'L', 'O', 'G', '1' };
+	enum class BinaryEntry : uint8_t {
+		String = 1, Message = 2
+	};
+	struct BinaryString {
+		uint32_t id;
+		uint32_t length;            // Of the bytes following it
+	};
+	struct BinaryMessage {
+		int64_t time;               // Nanoseconds since the epoch
+		uint32_t format;
+		uint32_t file;
+		uint32_t function;
+		uint32_t line;
+		uint32_t argumentsSize;
+		uint16_t argumentCount;
+		uint8_t type;               // DebugMessageType
+		uint8_t reserved;
+	};
+private:
+	enum class RecordKind : uint8_t {
+		Padding, Text, Deferred
+	};
+	// Follows the header of a deferred record, the packed arguments follow it.
+	struct DeferredHeader {
+		const char* format;         // Format string literals outlive the logger
+		uint32_t formatLength;
+		uint32_t argumentCount;
+	};
+	struct RecordHeader {
+		uint32_t size;              // Including the header, a multiple of 8
+		RecordKind kind;
+		uint8_t type;               // DebugMessageType
+		uint32_t line;
+		uint32_t length;            // Of the message following the header
+		int64_t time;               // Nanoseconds since the epoch
+		const char* file;           // Static strings from DEBUG_INFO
+		const char* function;
+	};
+	// One producer and one consumer. Positions only grow, the buffer index is the position modulo the capacity.
+	struct Ring {
+		std::unique_ptr<uint8_t[]> buffer;
+		size_t capacity;
+		alignas(64) std::atomic<uint64_t> head = 0;     // Written by the owning thread
+		alignas(64) std::atomic<uint64_t> tail = 0;     // Written by whoever drains
+		std::atomic<uint64_t> dropped = 0;
+		std::atomic<bool> closed = false;               // The owning thread exited
+
+		explicit Ring(size_t capacity): buffer(std::make_unique_for_overwrite<uint8_t[]>(capacity)), capacity(capacity) { }
+	};
+	struct Pending {
+		int64_t time;
+		const RecordHeader* header;
+	};
+	struct BatchLine {
+		size_t begin;
+		size_t end;
+		DebugMessageType type;
+	};
+
+	const uint64_t m_id;
+	std::mutex m_mutex;                 // Guards m_rings
+	std::vector<std::shared_ptr<Ring>> m_rings;
+
+	std::once_flag m_started;
+	std::thread m_thread;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	std::atomic<bool> m_wakeRequested = false;
+	std::atomic<bool> m_stop = false;
+
+	// Drain state and sinks, guarded by m_drainMutex so flush() can drain from any thread.
+	std::mutex m_drainMutex;
+	std::vector<std::shared_ptr<Ring>> m_draining;
+	std::vector<uint64_t> m_drainEnd;
+	std::vector<Pending> m_pending;
+	std::string m_batch;
+	std::string m_binary;
+	std::vector<BatchLine> m_batchLines;
+	std::shared_ptr<LogHistory> m_history;
+	bool m_stdout = true;
+	std::FILE* m_file = nullptr;
+	FileFormat m_fileFormat = FileFormat::Text;
+	std::unordered_map<const void*, uint32_t> m_stringIds;      // Per binary file, keyed by the string literal
+	std::filesystem::path m_filePath;
+	uint64_t m_fileSize = 0;
+	uint64_t m_maxFileSize = 0;
+	size_t m_maxFiles = 0;
+	std::atomic<uint64_t> m_written = 0;
+	std::atomic<uint64_t> m_dropped = 0;
+
+	Ring& threadRing();
+	uint8_t* reserve(Ring& ring, size_t size, bool wait, uint64_t& end);
+	void commit(Ring& ring, uint64_t end, bool urgent);
+	void requestWake();
+	void run();
+
+	template<typename T>
+	static constexpr bool IsStoredAs() {
+		using U = std::remove_cvref_t<T>;
+		return std::is_same_v<U, bool> || std::is_same_v<U, char> || (std::is_integral_v<U> && sizeof(U) <= 8) ||
+			std::is_same_v<U, float> || std::is_same_v<U, double> || std::is_same_v<U, const void*> || std::is_same_v<U, void*> ||
+			std::is_convertible_v<const U&, std::string_view>;
+	}
+	// Values the drain thread can format from their bytes are kept as they are, anything else becomes its text.
+	template<typename T>
+	static decltype(auto) Stored(const T& value) {
+		if constexpr (IsStoredAs<T>()) {
+			return (value);
+		} else {
+			return fmt::format("{}", value);
+		}
+	}
+	template<typename T>
+	static size_t EncodedSize(const T& value) {
+		using U = std::remove_cvref_t<T>;
+		if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>) {
+			return 2;
+		} else if constexpr (std::is_same_v<U, float>) {
+			return 1 + sizeof(float);
+		} else if constexpr (std::is_integral_v<U> || std::is_same_v<U, double>) {
+			return 1 + sizeof(uint64_t);
+		} else if constexpr (std::is_pointer_v<U> && !std::is_convertible_v<const U&, std::string_view>) {
+			return 1 + sizeof(const void*);
+		} else {
+			return 1 + sizeof(uint32_t) + std::string_view(value).size();
+		}
+	}
+	template<typename V>
+	static uint8_t* EncodeValue(uint8_t* out, ArgumentTag tag, V value) {
+		*out = uint8_t(tag);
+		std::memcpy(out + 1, &value, sizeof(V));
+		return out + 1 + sizeof(V);
+	}
+	template<typename T>
+	static uint8_t* Encode(uint8_t* out, const T& value) {
+		using U = std::remove_cvref_t<T>;
+		if constexpr (std::is_same_v<U, bool>) {
+			return EncodeValue(out, ArgumentTag::Bool, uint8_t(value));
+		} else if constexpr (std::is_same_v<U, char>) {
+			return EncodeValue(out, ArgumentTag::Char, value);
+		} else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+			return EncodeValue(out, ArgumentTag::Int, int64_t(value));
+		} else if constexpr (std::is_integral_v<U>) {
+			return EncodeValue(out, ArgumentTag::UInt, uint64_t(value));
+		} else if constexpr (std::is_same_v<U, float>) {
+			return EncodeValue(out, ArgumentTag::Float, value);
+		} else if constexpr (std::is_same_v<U, double>) {
+			return EncodeValue(out, ArgumentTag::Double, value);
+		} else if constexpr (std::is_pointer_v<U> && !std::is_convertible_v<const U&, std::string_view>) {
+			return EncodeValue(out, ArgumentTag::Pointer, static_cast<const void*>(value));
+		} else {
+			const std::string_view text(value);
+			out = EncodeValue(out, ArgumentTag::String, uint32_t(text.size()));
+			std::memcpy(out, text.data(), text.size());
+			return out + text.size();
+		}
+	}
+
+	template<typename... Values>
+	void logStored(DebugMessageType type, const DebugInfo& info, fmt::string_view format, const Values&... values) {
+		std::call_once(m_started, [this]() { m_thread = std::thread(&AsyncLogger::run, this); });
+
+		Ring& ring = threadRing();
+		const size_t length = sizeof(DeferredHeader) + (size_t(0) + ... + EncodedSize(values));
+		const size_t size = AlignRecord(sizeof(RecordHeader) + length);
+		if (size > ring.capacity / 2) {
+			log(type, info, fmt::vformat(format, fmt::make_format_args(values...)));
+			return;
+		}
+		const bool urgent = type == DebugMessageType::Error || type == DebugMessageType::FatalError;
+		uint64_t end;
+		uint8_t* bytes = reserve(ring, size, urgent || overflow == OverflowPolicy::Block, end);
+		if (bytes == nullptr) {
+			ring.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		auto* header = reinterpret_cast<RecordHeader*>(bytes);
+		FillHeader(header, size, RecordKind::Deferred, type, info, uint32_t(length));
+		auto* deferred = reinterpret_cast<DeferredHeader*>(header + 1);
+		deferred->format = format.data();
+		deferred->formatLength = uint32_t(format.size());
+		deferred->argumentCount = uint32_t(sizeof...(Values));
+		uint8_t* out = reinterpret_cast<uint8_t*>(deferred + 1);
+		((out = Encode(out, values)), ...);
+		commit(ring, end, urgent);
+	}
+
+	static constexpr size_t AlignRecord(size_t size) {
+		return (size + 7) & ~size_t(7);
+	}
+	static void FillHeader(RecordHeader* header, size_t size, RecordKind kind, DebugMessageType type, const DebugInfo& info, uint32_t length);
+	void drain();
+	uint32_t stringId(const char* text);
+	void appendBinary(const RecordHeader* header);
+	void appendBinaryMessage(int64_t time, DebugMessageType type, const char* format, const char* file, const char* function, uint32_t line,
+		uint16_t argumentCount, const void* arguments, size_t argumentsSize);
+	void write();
+	bool openFile();
+	void rotate();
+public:
+	// Per thread, taken when a thread logs for the first time.
+	size_t ringCapacity = 256 * 1024;
+	OverflowPolicy overflow = OverflowPolicy::Drop;
+
+	AsyncLogger();
+	AsyncLogger(const AsyncLogger&) = delete;
+	AsyncLogger& operator= (const AsyncLogger&) = delete;
+	~AsyncLogger();
+
+	// Errors wake the drain thread right away and never drop, other messages wait for the next flush interval.
+	void log(DebugMessageType type, const DebugInfo& info, std::string_view message);
+	// Stores the format string and the arguments, the drain thread formats them. The format string has to be a
+	// literal, it is kept by pointer. Use ImEdLogFormat, which also drops disabled levels at compile time.
+	template<typename... Args>
+	void logFormat(DebugMessageType type, const DebugInfo& info, fmt::format_string<Args...> format, Args&&... args) {
+		logStored(type, info, fmt::string_view(format), Stored(args)...);
+	}
+	// Everything logged before the call has been written when it returns.
+	void flush();
+
+	void setStdout(bool enabled);
+	// Appends to path, which is moved to path.1 once it grows past maxSize, keeping up to maxFiles old files.
+	bool setFile(const std::filesystem::path& path, uint64_t maxSize = 16 * 1024 * 1024, size_t maxFiles = 4, FileFormat format = FileFormat::Text);
+	void closeFile();
+	// Keeps the latest lines in memory from now on, for the log console. Calling it again keeps the existing one.
+	std::shared_ptr<LogHistory> enableHistory(size_t byteCapacity = 8 * 1024 * 1024, size_t lineCapacity = 128 * 1024);
+
+	[[nodiscard]] inline uint64_t writtenCount() const { return m_written.load(std::memory_order_relaxed); }
+	[[nodiscard]] inline uint64_t droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	static std::string_view TypeName(DebugMessageType type);
+	// The text form of a message, shared with imed-logdecode. FormatArguments returns false for malformed
+	// arguments instead of reading past end.
+	static void FormatPrefix(std::string& out, int64_t time, DebugMessageType type, std::string_view file, uint32_t line, std::string_view function);
+	static bool FormatArguments(std::string& out, std::string_view format, const uint8_t* arguments, const uint8_t* end, uint32_t count);
+	static constexpr bool Enabled(DebugMessageType type) {
+		return int(type) >= IMED_LOG_LEVEL;
+	}
+};
+
+extern AsyncLogger Logger;
+
+// Like ImEdLog with a format string, but nothing is formatted on the calling thread. Errors still go through
+// ImEdLogImpl for the notification toast. Disabled levels leave no code behind, the arguments are not evaluated either.
+#define ImEdLogFormat(__messageType, __format, ...) \
+	do { \
+		if constexpr (AsyncLogger::Enabled(__messageType)) { \
+			if constexpr (__messageType == DebugMessageType::Error || __messageType == DebugMessageType::FatalError) { \
+				ImEdLogImpl(fmt::format(__format __VA_OPT__(,) __VA_ARGS__), __messageType, DEBUG_INFO); \
+			} else { \
+				Logger.logFormat(__messageType, DEBUG_INFO, __format __VA_OPT__(,) __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
@@ -0,0 +1,814 @@
+#include "imed_gui_logview.hpp"
+#include "imed_gui_search.hpp"
+#include "imed_gui_logger.hpp"
+#include "imed_gui_app.hpp"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <utility>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+#if defined(__SSE4_2__)
+	#include <nmmintrin.h>
+#endif
+
+#if defined(__linux__)
+	#include <sys/stat.h>
+#endif
+
+// Level words are only looked for this far into a line, past the timestamp and the logger name.
+static constexpr size_t LevelSearchLength = 128;
+// Nothing announces appends to the file, it is checked this often while the view is shown.
+static constexpr double FilePollSeconds = 0.25;
+// Fewer new lines are classified on the calling thread alone.
+static constexpr size_t MinChunkLines = 16 * 1024;
+static constexpr uint32_t ContinuationLine = UINT32_MAX;
+static constexpr const char* LevelNames[] = { "All", "Trace", "Debug", "Info", "Warning", "Error", "Fatal" };
+
+static bool IsWordChar(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool IsDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static char ToLowerAscii(char c) {
+	return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static bool LevelColor(LogLevel level, ImVec4& color) {
+	switch (level) {
+		case LogLevel::Fatal:
+		case LogLevel::Error: color = Color(0xF0605AFF); return true;
+		case LogLevel::Warning: color = Color(0xE8B040FF); return true;
+		case LogLevel::Debug:
+		case LogLevel::Trace: color = ImGui::GetStyle().Colors[ImGuiCol_TextDisabled]; return true;
+		default: return false;
+	}
+}
+
+// Bit i set if times[i] is within [from, to], for 16 rows.
+static uint32_t TimeMask(const int64_t* times, int64_t from, int64_t to) {
+	uint32_t mask = 0;
+#if defined(__SSE4_2__)
+	const __m128i fromBytes = _mm_set1_epi64x(from), toBytes = _mm_set1_epi64x(to);
+	for (int i = 0; i < 16; i += 2) {
+		const __m128i pair = _mm_loadu_si128(reinterpret_cast<const __m128i*>(times + i));
+		const __m128i outside = _mm_or_si128(_mm_cmpgt_epi64(fromBytes, pair), _mm_cmpgt_epi64(pair, toBytes));
+		mask |= uint32_t(~_mm_movemask_pd(_mm_castsi128_pd(outside)) & 3) << i;
+	}
+#else
+	for (int i = 0; i < 16; i++) {
+		mask |= uint32_t(times[i] >= from && times[i] <= to) << i;
+	}
+#endif
+	return mask;
+}
+
+std::optional<LogLayout> LogLayout::Parse(std::string_view text) {
+	static constexpr std::pair<std::string_view, Field> Names[] = {
+		{ "", Field::Skip }, { "time", Field::Time }, { "level", Field::Level }, { "file", Field::File },
+		{ "line", Field::Line }, { "function", Field::Function }, { "message", Field::Message }
+	};
+
+	LogLayout layout;
+	size_t at = 0;
+	while (at < text.size()) {
+		if (text[at] != '{') {
+			const size_t end = std::min(text.find('{', at), text.size());
+			layout.m_tokens.push_back({ Field::Literal, std::string(text.substr(at, end - at)) });
+			at = end;
+			continue;
+		}
+		const size_t close = text.find('}', at);
+		if (close == std::string_view::npos) {
+			return std::nullopt;
+		}
+		const auto name = text.substr(at + 1, close - at - 1);
+		const auto* found = std::find_if(std::begin(Names), std::end(Names), [name](const auto& entry) { return entry.first == name; });
+		// A field without a literal after the one before it would have no end.
+		if (found == std::end(Names) || (!layout.m_tokens.empty() && layout.m_tokens.back().field != Field::Literal)) {
+			return std::nullopt;
+		}
+		layout.m_hasLevel |= found->second == Field::Level;
+		layout.m_tokens.push_back({ found->second, { } });
+		at = close + 1;
+	}
+	if (layout.m_tokens.empty()) {
+		return std::nullopt;
+	}
+	return layout;
+}
+
+bool LogLayout::match(std::string_view line, Record& record) const {
+	record = { NoTime, LogLevel::None, { }, 0, 0 };
+	size_t at = 0;
+	for (size_t i = 0; i < m_tokens.size(); i++) {
+		const auto& token = m_tokens[i];
+		if (token.field == Field::Literal) {
+			if (line.compare(at, token.literal.size(), token.literal) != 0) {
+				return false;
+			}
+			at += token.literal.size();
+			continue;
+		}
+
+		size_t end = line.size();
+		if (i + 1 < m_tokens.size()) {
+			// The separator can also occur inside the field, like the drive colon of a Windows path, so it is
+			// skipped when a line number has to follow it and does not.
+			const std::string_view separator = m_tokens[i + 1].literal;
+			const bool numberFollows = i + 2 < m_tokens.size() && m_tokens[i + 2].field == Field::Line;
+			end = line.find(separator, at);
+			while (numberFollows && end != std::string_view::npos && !(end + separator.size() < line.size() && IsDigit(line[end + separator.size()]))) {
+				end = line.find(separator, end + 1);
+			}
+			if (end == std::string_view::npos) {
+				return false;
+			}
+		}
+
+		const auto value = line.substr(at, end - at);
+		switch (token.field) {
+			case Field::Time:
+				record.time = ParseTime(value);
+				if (record.time == NoTime) {
+					return false;
+				}
+				break;
+			case Field::Level: record.level = LogView::DetectLevel(value); break;
+			case Field::File: record.file = value; break;
+			case Field::Line:
+				if (std::from_chars(value.data(), value.data() + value.size(), record.line).ec != std::errc()) {
+					return false;
+				}
+				break;
+			case Field::Message: record.messageOffset = uint32_t(at); break;
+			default: break;
+		}
+		at = end;
+	}
+	if (!m_hasLevel) {
+		record.level = LogView::DetectLevel(line);
+	}
+	return true;
+}
+
+int64_t LogLayout::ParseTime(std::string_view text) {
+	size_t at = 0;
+	const auto number = [&](size_t digits, int& value) {
+		if (at + digits > text.size()) {
+			return false;
+		}
+		int result = 0;
+		for (size_t i = 0; i < digits; i++) {
+			if (!IsDigit(text[at + i])) {
+				return false;
+			}
+			result = result * 10 + (text[at + i] - '0');
+		}
+		value = result;
+		at += digits;
+		return true;
+	};
+	const auto expect = [&](char c) {
+		if (at < text.size() && text[at] == c) {
+			at++;
+			return true;
+		}
+		return false;
+	};
+
+	int year, month, day;
+	if (!number(4, year) || !expect('-') || !number(2, month) || !expect('-') || !number(2, day)) {
+		return NoTime;
+	}
+	const std::chrono::year_month_day date { std::chrono::year(year), std::chrono::month(unsigned(month)), std::chrono::day(unsigned(day)) };
+	if (!date.ok()) {
+		return NoTime;
+	}
+
+	int hour = 0, minute = 0, second = 0, millis = 0;
+	if ((expect(' ') || expect('T')) && number(2, hour) && expect(':') && number(2, minute) && expect(':') && number(2, second) && (expect('.') || expect(','))) {
+		int digits = 0;
+		for (; at < text.size() && IsDigit(text[at]); at++, digits++) {
+			if (digits < 3) {
+				millis = millis * 10 + (text[at] - '0');
+			}
+		}
+		for (; digits < 3; digits++) {
+			millis *= 10;
+		}
+	}
+	const int64_t days = std::chrono::sys_days(date).time_since_epoch().count();
+	return (((days * 24 + hour) * 60 + minute) * 60 + second) * 1000 + millis;
+}
+
+size_t LogLayout::FormatTime(int64_t time, char* out) {
+	const auto days = std::chrono::floor<std::chrono::days>(std::chrono::sys_time<std::chrono::milliseconds>(std::chrono::milliseconds(time)));
+	const std::chrono::year_month_day date(days);
+	const int64_t millis = time - int64_t(days.time_since_epoch().count()) * 86400000;
+	const int length = std::snprintf(out, 24, "%04d-%02u-%02u %02d:%02d:%02d.%03d", int(date.year()), unsigned(date.month()), unsigned(date.day()),
+		int(millis / 3600000), int(millis / 60000 % 60), int(millis / 1000 % 60), int(millis % 1000));
+	return size_t(std::clamp(length, 0, 23));
+}
+
+LogView::LogView() {
+	std::memcpy(m_layoutInput, LogLayout::ImEdLayout.data(), LogLayout::ImEdLayout.size());
+}
+
+bool LogView::open(const std::filesystem::path& path) {
+	close();
+	m_path = path;
+	std::error_code error;
+	const auto size = std::filesystem::file_size(path, error);
+	if (error || !reopen(size > maxBytes ? size - maxBytes : 0)) {
+		ImEdLogFormat(DebugMessageType::Warning, "Failed to open \"{}\"", path.string());
+		m_path.clear();
+		return false;
+	}
+	return true;
+}
+
+void LogView::close() {
+	m_stream.close();
+	m_path.clear();
+	clearLines();
+	m_lineStart.clear();
+}
+
+void LogView::clearLines() {
+	m_text.clear();
+	m_lineStart.assign(1, m_textOffset);
+	m_lineLevel.clear();
+	m_time.clear();
+	m_sourceFile.clear();
+	m_sourceLine.clear();
+	m_messageOffset.clear();
+	m_droppedLines = 0;
+	m_view.clear();
+	m_droppedViewRows = 0;
+	m_hits.clear();
+	m_currentHit = SIZE_MAX;
+}
+
+bool LogView::reopen(uint64_t offset) {
+#if defined(__linux__)
+	// Taken before opening, a rotation in between only causes one more reopen.
+	struct stat info { };
+	m_fileId = ::stat(m_path.c_str(), &info) == 0 ? uint64_t(info.st_ino) : 0;
+#endif
+	m_stream.close();
+	m_stream.clear();
+	m_stream.open(m_path, std::ios::binary);
+	if (!m_stream.is_open()) {
+		return false;
+	}
+
+	m_readOffset = offset;
+	m_skipPartialLine = offset != 0;
+	m_textOffset = offset;
+	clearLines();
+	return true;
+}
+
+size_t LogView::poll() {
+	m_backlog = false;
+	if (!isOpen()) {
+		return 0;
+	}
+
+	uint64_t size;
+#if defined(__linux__)
+	struct stat info { };
+	if (::stat(m_path.c_str(), &info) != 0) {
+		// Moved away and not recreated yet, keeps the old file open until the new one shows up.
+		return 0;
+	}
+	if (uint64_t(info.st_ino) != m_fileId) {
+		if (!reopen(0)) {
+			return 0;
+		}
+	}
+	size = uint64_t(info.st_size);
+#else
+	std::error_code error;
+	size = std::filesystem::file_size(m_path, error);
+	if (error) {
+		return 0;
+	}
+#endif
+	if (size < m_readOffset && !reopen(0)) {
+		return 0;
+	}
+	if (size == m_readOffset) {
+		return 0;
+	}
+
+	const auto count = size_t(std::min<uint64_t>(size - m_readOffset, maxReadPerPoll));
+	m_backlog = size - m_readOffset > count;
+	const size_t oldSize = m_text.size();
+	m_text.resize(oldSize + count);
+	m_stream.clear();
+	m_stream.seekg(std::streamoff(m_readOffset));
+	m_stream.read(m_text.data() + oldSize, std::streamsize(count));
+	const auto read = size_t(std::max<std::streamsize>(m_stream.gcount(), 0));
+	m_text.resize(oldSize + read);
+	m_readOffset += read;
+
+	if (m_skipPartialLine) {
+		const auto end = m_text.find('\n');
+		const size_t skip = end == std::string::npos ? m_text.size() : end + 1;
+		m_text.erase(0, skip);
+		m_textOffset += skip;
+		m_lineStart.assign(1, m_textOffset);
+		m_skipPartialLine = end == std::string::npos;
+	}
+
+	const size_t firstLine = lineCount();
+	index();
+	classify(firstLine);
+	findHits(firstLine);
+	filter(firstLine);
+	const size_t added = lineCount() - firstLine;
+	trim();
+	return added;
+}
+
+void LogView::index() {
+	const char* data = m_text.data();
+	auto at = size_t(m_lineStart.back() - m_textOffset);
+	while (const void* found = std::memchr(data + at, '\n', m_text.size() - at)) {
+		at = size_t(static_cast<const char*>(found) - data) + 1;
+		m_lineStart.push_back(m_textOffset + at);
+	}
+	// A line that never ends would otherwise keep everything read after it in memory.
+	if (m_text.size() - at > maxBytes / 2) {
+		m_lineStart.push_back(m_textOffset + m_text.size());
+	}
+}
+
+void LogView::classify(size_t firstLine) {
+	const size_t count = lineCount();
+	m_lineLevel.resize(count);
+	if (m_layout.has_value()) {
+		m_time.resize(count);
+		m_sourceFile.resize(count);
+		m_sourceLine.resize(count);
+		m_messageOffset.resize(count);
+	}
+	if (firstLine >= count) {
+		return;
+	}
+
+	// Every chunk writes its own range of the columns, a large tail is split across the cores.
+	const size_t lines = count - firstLine;
+	const size_t chunkCount = std::clamp<size_t>(lines / MinChunkLines, 1, std::max(1u, std::thread::hardware_concurrency()));
+	const auto chunkBegin = [&](size_t chunk) { return firstLine + lines * chunk / chunkCount; };
+	const auto classifyChunk = [&](size_t chunk) {
+		LogLayout::Record record { };
+		std::string_view lastFile;
+		PathInterner::PathId lastFileId = PathInterner::EmptyPath;
+		const size_t begin = chunkBegin(chunk);
+		for (size_t i = begin, end = chunkBegin(chunk + 1); i < end; i++) {
+			const auto text = line(i);
+			if (!m_layout.has_value()) {
+				m_lineLevel[i] = DetectLevel(text);
+				continue;
+			}
+			if (!m_layout->match(text, record)) {
+				// The line above a later chunk is still being written by another thread, fixed up afterwards.
+				const bool inherit = i > begin || (chunk == 0 && i > 0);
+				m_messageOffset[i] = ContinuationLine;
+				m_lineLevel[i] = inherit ? m_lineLevel[i - 1] : LogLevel::None;
+				m_time[i] = inherit ? m_time[i - 1] : LogLayout::NoTime;
+				m_sourceFile[i] = inherit ? m_sourceFile[i - 1] : PathInterner::EmptyPath;
+				m_sourceLine[i] = inherit ? m_sourceLine[i - 1] : 0;
+				continue;
+			}
+			// Consecutive records mostly come from the same file, the interner lock is only taken on a change.
+			if (record.file != lastFile) {
+				lastFile = record.file;
+				lastFileId = InternedPaths.intern(record.file);
+			}
+			m_lineLevel[i] = record.level;
+			m_time[i] = record.time;
+			m_sourceFile[i] = lastFileId;
+			m_sourceLine[i] = record.line;
+			m_messageOffset[i] = record.messageOffset;
+		}
+	};
+
+	std::vector<std::future<void>> workers;
+	for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+		workers.push_back(std::async(std::launch::async, classifyChunk, chunk));
+	}
+	classifyChunk(0);
+	for (auto& worker : workers) {
+		worker.wait();
+	}
+
+	// Continuation lines at the head of a later chunk take the record of the chunk before.
+	if (m_layout.has_value()) {
+		for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+			for (size_t i = chunkBegin(chunk), end = chunkBegin(chunk + 1); i < end && m_messageOffset[i] == ContinuationLine; i++) {
+				m_lineLevel[i] = m_lineLevel[i - 1];
+				m_time[i] = m_time[i - 1];
+				m_sourceFile[i] = m_sourceFile[i - 1];
+				m_sourceLine[i] = m_sourceLine[i - 1];
+			}
+		}
+	}
+}
+
+void LogView::findHits(size_t firstLine) {
+	if (m_query.empty() || firstLine >= lineCount()) {
+		return;
+	}
+
+	// One pass over the new lines as a block, each hit is mapped to its line and the rest of that line is skipped.
+	const std::string_view text(m_text.data(), size_t(m_lineStart.back() - m_textOffset));
+	size_t line = firstLine;
+	auto at = size_t(m_lineStart[firstLine] - m_textOffset);
+	while ((at = WorkspaceSearch::FindLiteral(text, at, m_query, true)) != std::string_view::npos) {
+		line = size_t(std::upper_bound(m_lineStart.begin() + ptrdiff_t(line), m_lineStart.end(), m_textOffset + at) - m_lineStart.begin()) - 1;
+		m_hits.push_back(m_droppedLines + line);
+		at = size_t(m_lineStart[line + 1] - m_textOffset);
+	}
+}
+
+void LogView::filter(size_t firstLine) {
+	if (!m_layout.has_value()) {
+		return;
+	}
+
+	// Scans the level and time columns only, 16 rows at a time. Levels are compared as unsigned bytes:
+	// max(level, minimum) equals the level when it is at or above the minimum.
+	const auto* levels = reinterpret_cast<const uint8_t*>(m_lineLevel.data());
+	const int64_t* times = m_time.data();
+	const bool timeBound = m_timeFrom != LogLayout::NoTime || m_timeTo != INT64_MAX;
+	const size_t count = lineCount();
+	size_t i = firstLine;
+#if defined(__SSE2__)
+	const __m128i minimum = _mm_set1_epi8(char(m_minLevel));
+	for (; i + 16 <= count; i += 16) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + i));
+		auto mask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(block, minimum), block)));
+		if (timeBound && mask != 0) {
+			mask &= TimeMask(times + i, m_timeFrom, m_timeTo);
+		}
+		for (; mask != 0; mask &= mask - 1) {
+			m_view.push_back(m_droppedLines + i + size_t(std::countr_zero(mask)));
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		if (levels[i] >= uint8_t(m_minLevel) && (!timeBound || (times[i] >= m_timeFrom && times[i] <= m_timeTo))) {
+			m_view.push_back(m_droppedLines + i);
+		}
+	}
+}
+
+void LogView::trim() {
+	if (m_text.size() <= maxBytes && lineCount() <= maxLines) {
+		return;
+	}
+
+	// Down to half of either budget at once, so the front of the buffers is only moved once in a while.
+	size_t count = 0;
+	if (m_text.size() > maxBytes) {
+		count = size_t(std::lower_bound(m_lineStart.begin(), m_lineStart.end() - 1, m_readOffset - maxBytes / 2) - m_lineStart.begin());
+	}
+	if (lineCount() > maxLines) {
+		count = std::max(count, lineCount() - maxLines / 2);
+	}
+	count = std::min(count, lineCount());
+
+	const uint64_t cut = m_lineStart[count];
+	m_text.erase(0, size_t(cut - m_textOffset));
+	m_textOffset = cut;
+	const auto eraseFront = [count](auto& column) {
+		column.erase(column.begin(), column.begin() + ptrdiff_t(std::min(count, column.size())));
+	};
+	eraseFront(m_lineStart);
+	eraseFront(m_lineLevel);
+	eraseFront(m_time);
+	eraseFront(m_sourceFile);
+	eraseFront(m_sourceLine);
+	eraseFront(m_messageOffset);
+	m_droppedLines += count;
+
+	const auto droppedRows = size_t(std::lower_bound(m_view.begin(), m_view.end(), m_droppedLines) - m_view.begin());
+	m_view.erase(m_view.begin(), m_view.begin() + ptrdiff_t(droppedRows));
+	m_droppedViewRows += droppedRows;
+
+	const auto droppedHits = size_t(std::lower_bound(m_hits.begin(), m_hits.end(), m_droppedLines) - m_hits.begin());
+	m_hits.erase(m_hits.begin(), m_hits.begin() + ptrdiff_t(droppedHits));
+	if (m_currentHit != SIZE_MAX) {
+		m_currentHit = m_currentHit < droppedHits ? SIZE_MAX : m_currentHit - droppedHits;
+	}
+}
+
+std::string_view LogView::line(size_t line) const {
+	const auto begin = size_t(m_lineStart[line] - m_textOffset);
+	auto end = size_t(m_lineStart[line + 1] - m_textOffset);
+	if (end > begin && m_text[end - 1] == '\n') end--;
+	if (end > begin && m_text[end - 1] == '\r') end--;
+	return { m_text.data() + begin, end - begin };
+}
+
+std::string_view LogView::message(size_t line) const {
+	const auto text = this->line(line);
+	return m_messageOffset[line] == ContinuationLine ? text : text.substr(std::min<size_t>(m_messageOffset[line], text.size()));
+}
+
+void LogView::search(std::string_view query) {
+	m_query.resize(query.size());
+	std::transform(query.begin(), query.end(), m_query.begin(), ToLowerAscii);
+	m_hits.clear();
+	m_currentHit = SIZE_MAX;
+	findHits(0);
+}
+
+void LogView::setLayout(std::optional<LogLayout> layout) {
+	m_layout = std::move(layout);
+	m_time.clear();
+	m_sourceFile.clear();
+	m_sourceLine.clear();
+	m_messageOffset.clear();
+	m_view.clear();
+	if (!m_layout.has_value()) {
+		m_time.shrink_to_fit();
+		m_sourceFile.shrink_to_fit();
+		m_sourceLine.shrink_to_fit();
+		m_messageOffset.shrink_to_fit();
+		m_view.shrink_to_fit();
+	}
+	classify(0);
+	filter(0);
+}
+
+void LogView::setFilter(LogLevel minLevel, int64_t from, int64_t to) {
+	m_minLevel = minLevel;
+	m_timeFrom = from;
+	m_timeTo = to;
+	m_view.clear();
+	filter(0);
+}
+
+void LogView::showFilters() {
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 24.0f);
+	if (ImGui::InputTextWithHint("##Layout", "Layout", m_layoutInput, sizeof(m_layoutInput), ImGuiInputTextFlags_EnterReturnsTrue)) {
+		auto layout = LogLayout::Parse(m_layoutInput);
+		m_invalidLayout = !layout.has_value();
+		if (layout.has_value()) {
+			setLayout(std::move(layout));
+		}
+	}
+	ImGui::SameLine();
+	int level = int(m_minLevel);
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 6.0f);
+	bool changed = ImGui::Combo("##Level", &level, LevelNames, int(std::size(LevelNames)));
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 10.0f);
+	changed |= ImGui::InputTextWithHint("##From", "From", m_timeFromInput, sizeof(m_timeFromInput));
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 10.0f);
+	changed |= ImGui::InputTextWithHint("##To", "To", m_timeToInput, sizeof(m_timeToInput));
+	if (changed) {
+		const int64_t to = LogLayout::ParseTime(m_timeToInput);
+		setFilter(LogLevel(level), LogLayout::ParseTime(m_timeFromInput), to == LogLayout::NoTime ? INT64_MAX : to);
+	}
+	ImGui::SameLine();
+	if (m_invalidLayout) {
+		ImGui::TextDisabled("Invalid layout");
+	} else {
+		ImGui::TextDisabled("%zu of %zu records", m_view.size(), lineCount());
+	}
+}
+
+void LogView::showLines(size_t added, uint64_t droppedBefore) {
+	ImGui::BeginChild("##LogLines", { 0.0f, 0.0f }, ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar);
+	const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+	// Judged against last frame's content, before this frame's lines make it taller.
+	const bool pinned = ImGui::GetScrollY() >= ImGui::GetScrollMaxY() - lineHeight * 0.5f;
+	if (!pinned && m_droppedLines > droppedBefore) {
+		// Lines dropped from the front move everything up, the scroll position follows so the view stays put.
+		ImGui::SetScrollY(std::max(0.0f, ImGui::GetScrollY() - float(m_droppedLines - droppedBefore) * lineHeight));
+	}
+
+	auto* drawList = ImGui::GetWindowDrawList();
+	const ImU32 matchColor = ImGui::GetColorU32(ImGuiCol_TextSelectedBg, 0.5f);
+	const ImU32 currentColor = ImGui::GetColorU32(ImGuiCol_TextSelectedBg);
+	const uint64_t currentLine = m_currentHit != SIZE_MAX ? m_hits[m_currentHit] : UINT64_MAX;
+	ImGuiListClipper clipper;
+	clipper.Begin(int(lineCount()), lineHeight);
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const std::string_view text = line(size_t(row));
+			const uint64_t number = m_droppedLines + uint64_t(row);
+			if (!m_query.empty() && std::binary_search(m_hits.begin(), m_hits.end(), number)) {
+				const ImVec2 origin = ImGui::GetCursorScreenPos();
+				const ImU32 color = number == currentLine ? currentColor : matchColor;
+				for (size_t at = 0; (at = WorkspaceSearch::FindLiteral(text, at, m_query, true)) != std::string_view::npos; at += m_query.size()) {
+					const float x = origin.x + ImGui::CalcTextSize(text.data(), text.data() + at).x;
+					const float width = ImGui::CalcTextSize(text.data() + at, text.data() + at + m_query.size()).x;
+					drawList->AddRectFilled({ x, origin.y }, { x + width, origin.y + lineHeight }, color);
+				}
+			}
+
+			ImVec4 color;
+			const bool colored = LevelColor(m_lineLevel[size_t(row)], color);
+			if (colored) {
+				ImGui::PushStyleColor(ImGuiCol_Text, color);
+			}
+			ImGui::TextUnformatted(text.data(), text.data() + text.size());
+			if (colored) {
+				ImGui::PopStyleColor();
+			}
+		}
+	}
+	clipper.End();
+
+	if (m_scrollToHit && m_currentHit != SIZE_MAX) {
+		ImGui::SetScrollY(std::max(0.0f, float(m_hits[m_currentHit] - m_droppedLines) * lineHeight - ImGui::GetWindowHeight() * 0.5f));
+		m_scrollToHit = false;
+	} else if (follow && pinned && added != 0) {
+		ImGui::SetScrollHereY(1.0f);
+	}
+	ImGui::EndChild();
+}
+
+void LogView::showRecords(size_t added, uint64_t droppedRowsBefore) {
+	const ImGuiTableFlags flags = ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit;
+	if (!ImGui::BeginTable("##LogRecords", 4, flags)) {
+		return;
+	}
+	ImGui::TableSetupScrollFreeze(0, 1);
+	ImGui::TableSetupColumn("Time");
+	ImGui::TableSetupColumn("Level");
+	ImGui::TableSetupColumn("Source");
+	ImGui::TableSetupColumn("Message");
+	ImGui::TableHeadersRow();
+
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	const bool pinned = ImGui::GetScrollY() >= ImGui::GetScrollMaxY() - rowHeight * 0.5f;
+	if (!pinned && m_droppedViewRows > droppedRowsBefore) {
+		ImGui::SetScrollY(std::max(0.0f, ImGui::GetScrollY() - float(m_droppedViewRows - droppedRowsBefore) * rowHeight));
+	}
+
+	const ImU32 matchColor = ImGui::GetColorU32(ImGuiCol_TextSelectedBg, 0.5f);
+	const ImU32 currentColor = ImGui::GetColorU32(ImGuiCol_TextSelectedBg);
+	const uint64_t currentLine = m_currentHit != SIZE_MAX ? m_hits[m_currentHit] : UINT64_MAX;
+	char time[24];
+	ImGuiListClipper clipper;
+	clipper.Begin(int(m_view.size()), rowHeight);
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const uint64_t number = m_view[size_t(row)];
+			const auto i = size_t(number - m_droppedLines);
+			ImGui::TableNextRow();
+			if (!m_query.empty() && std::binary_search(m_hits.begin(), m_hits.end(), number)) {
+				ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg1, number == currentLine ? currentColor : matchColor);
+			}
+
+			// Continuation lines only show their text, the other columns belong to the record above.
+			const bool continuation = m_messageOffset[i] == ContinuationLine;
+			if (!continuation && ImGui::TableSetColumnIndex(0) && m_time[i] != LogLayout::NoTime) {
+				const size_t length = LogLayout::FormatTime(m_time[i], time);
+				ImGui::TextUnformatted(time, time + length);
+			}
+			ImVec4 color;
+			const bool colored = LevelColor(m_lineLevel[i], color);
+			if (colored) {
+				ImGui::PushStyleColor(ImGuiCol_Text, color);
+			}
+			if (!continuation && ImGui::TableSetColumnIndex(1)) {
+				ImGui::TextUnformatted(LevelNames[size_t(m_lineLevel[i])]);
+			}
+			if (!continuation && ImGui::TableSetColumnIndex(2) && m_sourceFile[i] != PathInterner::EmptyPath) {
+				m_scratch.clear();
+				InternedPaths.append(m_sourceFile[i], m_scratch);
+				fmt::format_to(std::back_inserter(m_scratch), ":{}", m_sourceLine[i]);
+				ImGui::TextUnformatted(m_scratch.data(), m_scratch.data() + m_scratch.size());
+			}
+			if (ImGui::TableSetColumnIndex(3)) {
+				const auto text = message(i);
+				ImGui::TextUnformatted(text.data(), text.data() + text.size());
+			}
+			if (colored) {
+				ImGui::PopStyleColor();
+			}
+		}
+	}
+	clipper.End();
+
+	if (m_scrollToHit && m_currentHit != SIZE_MAX) {
+		// A hit filtered out of the view scrolls to the nearest record after it.
+		const auto row = size_t(std::lower_bound(m_view.begin(), m_view.end(), m_hits[m_currentHit]) - m_view.begin());
+		ImGui::SetScrollY(std::max(0.0f, float(row) * rowHeight - ImGui::GetWindowHeight() * 0.5f));
+		m_scrollToHit = false;
+	} else if (follow && pinned && added != 0) {
+		ImGui::SetScrollHereY(1.0f);
+	}
+	ImGui::EndTable();
+}
+
+void LogView::show() {
+	if (!isOpen()) {
+		ImGui::TextDisabled("No file");
+		return;
+	}
+	const uint64_t droppedBefore = m_droppedLines;
+	const uint64_t droppedRowsBefore = m_droppedViewRows;
+	const size_t added = poll();
+	Application::RequestFrameIn(m_backlog ? 0.0 : FilePollSeconds);
+
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 16.0f);
+	if (ImGui::InputTextWithHint("##Find", "Find", m_queryInput, sizeof(m_queryInput))) {
+		search(m_queryInput);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Previous") && !m_hits.empty()) {
+		m_currentHit = m_currentHit == SIZE_MAX || m_currentHit == 0 ? m_hits.size() - 1 : m_currentHit - 1;
+		m_scrollToHit = true;
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Next") && !m_hits.empty()) {
+		m_currentHit = m_currentHit == SIZE_MAX || m_currentHit + 1 == m_hits.size() ? 0 : m_currentHit + 1;
+		m_scrollToHit = true;
+	}
+	ImGui::SameLine();
+	ImGui::Checkbox("Follow", &follow);
+	ImGui::SameLine();
+	bool structured = isStructured();
+	if (ImGui::Checkbox("Structured", &structured)) {
+		auto layout = structured ? LogLayout::Parse(m_layoutInput) : std::nullopt;
+		m_invalidLayout = structured && !layout.has_value();
+		setLayout(std::move(layout));
+	}
+	ImGui::SameLine();
+	if (m_query.empty()) {
+		ImGui::TextDisabled("%zu lines", lineCount());
+	} else {
+		ImGui::TextDisabled("%zu lines, %zu matches", lineCount(), m_hits.size());
+	}
+
+	if (isStructured()) {
+		showFilters();
+		showRecords(added, droppedRowsBefore);
+	} else {
+		showLines(added, droppedBefore);
+	}
+}
+
+LogLevel LogView::DetectLevel(std::string_view line) {
+	static constexpr std::pair<std::string_view, LogLevel> Words[] = {
+		{ "fatal", LogLevel::Fatal }, { "critical", LogLevel::Fatal }, { "error", LogLevel::Error }, { "err", LogLevel::Error },
+		{ "warning", LogLevel::Warning }, { "warn", LogLevel::Warning }, { "info", LogLevel::Info },
+		{ "debug", LogLevel::Debug }, { "trace", LogLevel::Trace }, { "verbose", LogLevel::Trace }
+	};
+
+	line = line.substr(0, std::min(line.size(), LevelSearchLength));
+	for (size_t at = 0; at < line.size(); at++) {
+		if (!IsWordChar(line[at]) || (at > 0 && IsWordChar(line[at - 1]))) {
+			continue;
+		}
+		size_t end = at;
+		while (end < line.size() && IsWordChar(line[end])) {
+			end++;
+		}
+		const std::string_view word = line.substr(at, end - at);
+		// Single letters only count in logcat's "E/Tag" and the bracketed "[E]" form.
+		if (word.size() == 1 && end < line.size() && (line[end] == '/' || line[end] == ']')) {
+			switch (word[0]) {
+				case 'F': return LogLevel::Fatal;
+				case 'E': return LogLevel::Error;
+				case 'W': return LogLevel::Warning;
+				case 'I': return LogLevel::Info;
+				case 'D': return LogLevel::Debug;
+				case 'V':
+				case 'T': return LogLevel::Trace;
+				default: break;
+			}
+		}
+		for (const auto& [name, level] : Words) {
+			if (word.size() == name.size() && std::equal(word.begin(), word.end(), name.begin(), [](char a, char b) { return ToLowerAscii(a) == b; })) {
+				return level;
+			}
+		}
+		at = end;
+	}
+	return LogLevel::None;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "imed_gui_layout.hpp"
+#include "imed_gui_paths.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+enum class LogLevel : uint8_t {
+	None,
+	Trace,
+	Debug,
+	Info,
+	Warning,
+	Error,
+	Fatal
+};
+
+// Splits log lines into fields. A layout is the line with its fields in braces, "{time} [{level}] {file}:{line}",
+// everything between them has to match literally and "{}" skips a field. Fields run up to the next literal.
+class LogLayout {
+public:
+	enum class Field : uint8_t {
+		Literal, Skip, Time, Level, File, Line, Function, Message
+	};
+	struct Token {
+		Field field;
+		std::string literal;
+	};
+	struct Record {
+		int64_t time;
+		LogLevel level;
+		std::string_view file;
+		uint32_t line;
+		uint32_t messageOffset;
+	};
+
+	static constexpr int64_t NoTime = INT64_MIN;
+	// What ImEdLogImpl writes, "{} [{}] {}:{} {} - {}" with the chrono timestamp first.
+	static constexpr std::string_view ImEdLayout = "{time} [{level}] {file}:{line} {function} - {message}";
+private:
+	std::vector<Token> m_tokens;
+	bool m_hasLevel = false;
+public:
+	// nullopt on an unknown field name or two fields without a literal between them.
+	static std::optional<LogLayout> Parse(std::string_view layout);
+
+	bool match(std::string_view line, Record& record) const;
+
+	// Milliseconds since the epoch of "2024-05-01 12:00:00.123", the T separator and a trailing zone are accepted,
+	// missing time of day fields count as zero. NoTime if there is no date.
+	static int64_t ParseTime(std::string_view text);
+	// "2024-05-01 12:00:00.123", out needs 24 bytes.
+	static size_t FormatTime(int64_t time, char* out);
+};
+
+// Follows a growing log file. Every poll reads only the bytes appended since the last one, and the line index,
+// level highlighting and search hits are extended over just those bytes. Only the tail of the file is kept in
+// memory, older lines are dropped in bulk once it grows past maxBytes.
+class LogView : public IWidget {
+	std::filesystem::path m_path;
+	std::ifstream m_stream;
+	uint64_t m_fileId = 0;          // Inode on Linux, a new one means the log was rotated
+	uint64_t m_readOffset = 0;      // File offset of the next byte to read
+	bool m_skipPartialLine = false; // Reading started in the middle of the file
+	bool m_backlog = false;         // The last poll stopped at maxReadPerPoll
+
+	std::string m_text;             // Bytes from m_textOffset up to m_readOffset
+	uint64_t m_textOffset = 0;
+	std::vector<uint64_t> m_lineStart;  // File offsets, plus the end of the last complete line which the unfinished one starts at
+	std::vector<LogLevel> m_lineLevel;
+	uint64_t m_droppedLines = 0;
+
+	// Structured mode columns, one entry per line. Lines the layout does not match continue the record above them.
+	std::optional<LogLayout> m_layout;
+	std::vector<int64_t> m_time;
+	std::vector<PathInterner::PathId> m_sourceFile;
+	std::vector<uint32_t> m_sourceLine;
+	std::vector<uint32_t> m_messageOffset;
+	// Absolute numbers of the lines that pass the level and time filter.
+	std::vector<uint64_t> m_view;
+	uint64_t m_droppedViewRows = 0;
+	LogLevel m_minLevel = LogLevel::None;
+	int64_t m_timeFrom = LogLayout::NoTime;
+	int64_t m_timeTo = INT64_MAX;
+
+	std::string m_query;            // Lowered
+	std::vector<uint64_t> m_hits;   // Absolute line numbers
+	size_t m_currentHit = SIZE_MAX;
+	char m_queryInput[256] = { };
+	bool m_scrollToHit = false;
+	char m_layoutInput[256] = { };
+	char m_timeFromInput[32] = { };
+	char m_timeToInput[32] = { };
+	bool m_invalidLayout = false;
+	std::string m_scratch;
+
+	bool reopen(uint64_t offset);
+	void clearLines();
+	void index();
+	void classify(size_t firstLine);
+	void findHits(size_t firstLine);
+	void filter(size_t firstLine);
+	void trim();
+	void showFilters();
+	void showLines(size_t added, uint64_t droppedBefore);
+	void showRecords(size_t added, uint64_t droppedRowsBefore);
+public:
+	// Scrolls along with appended lines while the view is at the bottom.
+	bool follow = true;
+	size_t maxBytes = 64 * 1024 * 1024;
+	size_t maxLines = 1000000;
+	// Caps the work one frame does when a writer bursts or a large tail is loaded.
+	size_t maxReadPerPoll = 8 * 1024 * 1024;
+
+	LogView();
+	explicit LogView(const std::filesystem::path& path): LogView() { open(path); }
+
+	// Starts at the last maxBytes of the file.
+	bool open(const std::filesystem::path& path);
+	void close();
+	// Picks up appended bytes and starts over when the file was truncated or rotated. Returns the number of new lines.
+	size_t poll();
+
+	[[nodiscard]] inline bool isOpen() const { return m_stream.is_open(); }
+	[[nodiscard]] inline const std::filesystem::path& path() const { return m_path; }
+	[[nodiscard]] inline size_t lineCount() const { return m_lineStart.empty() ? 0 : m_lineStart.size() - 1; }
+	// Absolute number of the first line still in memory.
+	[[nodiscard]] inline uint64_t firstLineNumber() const { return m_droppedLines; }
+	[[nodiscard]] std::string_view line(size_t line) const;
+	[[nodiscard]] inline LogLevel level(size_t line) const { return m_lineLevel[line]; }
+	[[nodiscard]] inline const std::vector<uint64_t>& hits() const { return m_hits; }
+
+	// Case-insensitive, lines appended later are searched as they arrive.
+	void search(std::string_view query);
+
+	// Parses every line in memory into columns, nullopt goes back to plain lines.
+	void setLayout(std::optional<LogLayout> layout);
+	[[nodiscard]] inline bool isStructured() const { return m_layout.has_value(); }
+	[[nodiscard]] inline int64_t time(size_t line) const { return m_time[line]; }
+	[[nodiscard]] inline PathInterner::PathId sourceFile(size_t line) const { return m_sourceFile[line]; }
+	[[nodiscard]] inline uint32_t sourceLine(size_t line) const { return m_sourceLine[line]; }
+	[[nodiscard]] std::string_view message(size_t line) const;
+
+	// Records at or above a level within [from, to], the bounds in LogLayout::ParseTime milliseconds.
+	void setFilter(LogLevel minLevel, int64_t from = LogLayout::NoTime, int64_t to = INT64_MAX);
+	[[nodiscard]] inline const std::vector<uint64_t>& view() const { return m_view; }
+
+	// Nothing tells when the file grows, show() polls it and always has to run.
+	[[nodiscard]] inline bool isDirty() const override { return true; }
+	void show() override;
+
+	// Level named by the first level word ("ERROR", "warn", "E/Tag", ...) near the start of a line.
+	static LogLevel DetectLevel(std::string_view line);
+};
@@ -0,0 +1,94 @@
+#include "imed_gui_mappedfile.hpp"
+
+#include <fstream>
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& file) noexcept: m_data(file.m_data), m_size(file.m_size), m_mapped(file.m_mapped),
+	m_open(file.m_open), m_buffer(std::move(file.m_buffer)) {
+	file.m_data = nullptr;
+	file.m_size = 0;
+	file.m_mapped = false;
+	file.m_open = false;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile& MappedFile::operator= (MappedFile&& file) noexcept {
+	if (this != &file) {
+		close();
+		m_data = file.m_data;
+		m_size = file.m_size;
+		m_mapped = file.m_mapped;
+		m_open = file.m_open;
+		m_buffer = std::move(file.m_buffer);
+		file.m_data = nullptr;
+		file.m_size = 0;
+		file.m_mapped = false;
+		file.m_open = false;
+	}
+	return *this;
+}
+
+bool MappedFile::open(const std::filesystem::path& path) {
+	close();
+#if defined(__linux__)
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st { };
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		::close(fd);
+		return false;
+	}
+	m_open = true;
+	m_size = size_t(st.st_size);
+	if (m_size > 0) {
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			::close(fd);
+			m_open = false;
+			m_size = 0;
+			return false;
+		}
+		m_data = static_cast<const uint8_t*>(data);
+		m_mapped = true;
+	}
+	// The mapping stays valid after the descriptor is closed.
+	::close(fd);
+	return true;
+#else
+	std::ifstream stream(path, std::ios::binary | std::ios::ate);
+	if (!stream) {
+		return false;
+	}
+	m_buffer.resize(size_t(stream.tellg()));
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(m_buffer.data()), std::streamsize(m_buffer.size()));
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+	m_open = true;
+	return true;
+#endif
+}
+
+void MappedFile::close() {
+#if defined(__linux__)
+	if (m_mapped) {
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+#endif
+	m_buffer.clear();
+	m_data = nullptr;
+	m_size = 0;
+	m_mapped = false;
+	m_open = false;
+}
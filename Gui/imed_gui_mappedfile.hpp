@@ -0,0 +1,33 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Read-only view of a whole file, memory mapped where the platform allows it and read into memory otherwise.
+class MappedFile {
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_mapped = false;
+	bool m_open = false;
+	std::vector<uint8_t> m_buffer;
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::filesystem::path& path) { open(path); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile&& file) noexcept;
+	~MappedFile();
+
+	MappedFile& operator= (const MappedFile&) = delete;
+	MappedFile& operator= (MappedFile&& file) noexcept;
+
+	bool open(const std::filesystem::path& path);
+	void close();
+
+	[[nodiscard]] inline bool isOpen() const { return m_open; }
+	[[nodiscard]] inline bool isMapped() const { return m_mapped; }
+	[[nodiscard]] inline const uint8_t* data() const { return m_data; }
+	[[nodiscard]] inline size_t size() const { return m_size; }
+	[[nodiscard]] inline std::string_view view() const { return { reinterpret_cast<const char*>(m_data), m_size }; }
+};
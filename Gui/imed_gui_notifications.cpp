@@ -0,0 +1,197 @@
+#include "imed_gui_notifications.hpp"
+#include "imed_gui_app.hpp"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cstring>
+
+NotificationCenter Notifications;
+
+static constexpr double FadeSeconds = 0.5;
+
+static bool SameSite(const char* file, uint32_t line, const char* otherFile, uint32_t otherLine) {
+	if (line != otherLine) {
+		return false;
+	}
+	if (file == otherFile) {
+		return true;
+	}
+	return file != nullptr && otherFile != nullptr && std::strcmp(file, otherFile) == 0;
+}
+
+static ImVec4 ToastColor(DebugMessageType type) {
+	switch (type) {
+		case DebugMessageType::Error:
+		case DebugMessageType::FatalError: return Color(0xF0605AFF);
+		case DebugMessageType::Warning: return Color(0xE8B040FF);
+		default: return ImGui::GetStyle().Colors[ImGuiCol_Text];
+	}
+}
+
+static std::string_view ToastTitle(DebugMessageType type) {
+	switch (type) {
+		case DebugMessageType::Info: return "Info";
+		case DebugMessageType::Warning: return "Warning";
+		case DebugMessageType::Error: return "Error";
+		case DebugMessageType::FatalError: return "Fatal error";
+	}
+	return "Info";
+}
+
+void NotificationCenter::post(DebugMessageType type, const DebugInfo& info, std::string_view message) {
+	std::lock_guard lock(m_mutex);
+	for (auto& pending : m_pending) {
+		if (SameSite(pending.file, pending.line, info.callerFile, uint32_t(info.callerLine))) {
+			pending.type = std::max(pending.type, type);
+			pending.message = message;
+			pending.count++;
+			return;
+		}
+	}
+	if (m_pending.size() >= MaxPending) {
+		m_overflow++;
+		return;
+	}
+	m_pending.push_back({ type, info.callerFile, uint32_t(info.callerLine), std::string(message), 1 });
+	Application::Wake();
+}
+
+bool NotificationCenter::isQuiet(const char* file, uint32_t line) const {
+	return std::any_of(m_quiet.begin(), m_quiet.end(), [&](const QuietSite& site) { return SameSite(site.file, site.line, file, line); });
+}
+
+void NotificationCenter::merge(Notification&& notification, double now) {
+	for (auto& toast : m_toasts) {
+		auto& shown = toast.notification;
+		if (!toast.closed && SameSite(shown.file, shown.line, notification.file, notification.line)) {
+			shown.type = std::max(shown.type, notification.type);
+			shown.message = std::move(notification.message);
+			shown.count += notification.count;
+			toast.lastTime = now;
+			return;
+		}
+	}
+	if (notification.file != nullptr && isQuiet(notification.file, notification.line)) {
+		m_suppressed += notification.count;
+		return;
+	}
+	m_toasts.push_back({ std::move(notification), m_nextId++, now });
+}
+
+bool NotificationCenter::isDirty() const {
+	if (IWidget::isDirty() || m_suppressed != 0) {
+		return true;
+	}
+	std::lock_guard lock(m_mutex);
+	return !m_pending.empty() || m_overflow != 0;
+}
+
+void NotificationCenter::show() {
+	{
+		std::lock_guard lock(m_mutex);
+		std::swap(m_pending, m_incoming);
+		m_suppressed += m_overflow;
+		m_overflow = 0;
+	}
+	const double now = ImGui::GetTime();
+	std::erase_if(m_quiet, [now](const QuietSite& site) { return site.until <= now; });
+	for (auto& notification : m_incoming) {
+		merge(std::move(notification), now);
+	}
+	// New toasts are sized on their first frame and only appear on the next one.
+	if (!m_incoming.empty()) {
+		markDirty();
+	}
+	m_incoming.clear();
+
+	// Whatever was held back is reported as one toast of its own, which is itself quiet after being closed.
+	if (m_suppressed != 0 && !isQuiet(nullptr, 0)) {
+		const auto it = std::find_if(m_toasts.begin(), m_toasts.end(), [](const Toast& toast) { return toast.notification.file == nullptr && !toast.closed; });
+		const uint64_t total = m_suppressed + (it != m_toasts.end() ? it->notification.count : 0);
+		merge({ DebugMessageType::Warning, nullptr, 0, fmt::format("{} repeated notifications were not shown, see the log", total), m_suppressed }, now);
+		m_suppressed = 0;
+	}
+	if (m_toasts.empty()) {
+		return;
+	}
+
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	const float margin = ImGui::GetFontSize();
+	const float width = ImGui::GetFontSize() * 24.0f;
+	const float right = viewport->WorkPos.x + viewport->WorkSize.x - margin;
+	float bottom = viewport->WorkPos.y + viewport->WorkSize.y - margin;
+	constexpr ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings |
+		ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+
+	// Newest at the bottom. Toasts past MaxVisible wait without aging until there is room.
+	size_t visible = 0;
+	for (size_t i = m_toasts.size(); i-- > 0; ) {
+		Toast& toast = m_toasts[i];
+		if (visible == MaxVisible) {
+			toast.lastTime = now;
+			continue;
+		}
+		visible++;
+
+		const auto& notification = toast.notification;
+		const double lifetime = notification.type >= DebugMessageType::Error ? ErrorSeconds : WarningSeconds;
+		const float alpha = float(std::clamp((lifetime - (now - toast.lastTime)) / FadeSeconds, 0.0, 1.0));
+		ImGui::SetNextWindowPos(ImVec2(right, bottom), ImGuiCond_Always, ImVec2(1.0f, 1.0f));
+		ImGui::SetNextWindowSize(ImVec2(width, 0.0f));
+		ImGui::PushStyleVar(ImGuiStyleVar_Alpha, alpha);
+		const auto name = fmt::format("##Toast{}", toast.id);
+		bool hovered = false;
+		if (ImGui::Begin(name.c_str(), nullptr, flags)) {
+			hovered = ImGui::IsWindowHovered();
+			const auto title = ToastTitle(notification.type);
+			ImGui::TextColored(ToastColor(notification.type), "%.*s", int(title.size()), title.data());
+			if (notification.count > 1) {
+				ImGui::SameLine();
+				ImGui::TextDisabled("x%llu", static_cast<unsigned long long>(notification.count));
+			}
+			ImGui::SameLine(ImGui::GetWindowWidth() - margin * 2.0f);
+			if (ImGui::SmallButton("x")) {
+				toast.closed = true;
+			}
+			ImGui::PushTextWrapPos(0.0f);
+			ImGui::TextUnformatted(notification.message.data(), notification.message.data() + notification.message.size());
+			ImGui::PopTextWrapPos();
+			if (notification.file != nullptr) {
+				ImGui::TextDisabled("%s:%u", notification.file, notification.line);
+			}
+			bottom -= ImGui::GetWindowHeight() + margin * 0.5f;
+		}
+		ImGui::End();
+		ImGui::PopStyleVar();
+
+		// Hovering keeps a toast open so it can be read.
+		if (hovered) {
+			toast.lastTime = now;
+		} else if (now - toast.lastTime >= lifetime) {
+			toast.closed = true;
+		}
+		// Frames are needed for the fade and to close it on time.
+		if (!toast.closed) {
+			Application::RequestFrameIn(std::max(0.0, toast.lastTime + lifetime - FadeSeconds - now));
+		}
+	}
+
+	for (const auto& toast : m_toasts) {
+		if (toast.closed) {
+			m_quiet.push_back({ toast.notification.file, toast.notification.line, now + QuietSeconds });
+		}
+	}
+	std::erase_if(m_toasts, [](const Toast& toast) { return toast.closed; });
+}
+
+void NotificationCenter::clear() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_pending.clear();
+		m_overflow = 0;
+	}
+	m_toasts.clear();
+	m_quiet.clear();
+	m_suppressed = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "imed_gui_layout.hpp"
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Errors shown as toasts in the corner of the main viewport instead of modal dialogs. post() only queues and can be
+// called from any thread, show() draws on the render thread once per frame after the rest of the UI. Repeats from
+// one call site fold into a single toast with a count, and a site whose toast was just closed stays quiet for a
+// while, so an error raised every frame is one toast instead of a storm.
+class NotificationCenter : public IWidget {
+public:
+	static constexpr size_t MaxPending = 64;            // Per frame, further posts are only counted
+	static constexpr size_t MaxVisible = 5;
+	static constexpr double WarningSeconds = 5.0;
+	static constexpr double ErrorSeconds = 10.0;
+	static constexpr double QuietSeconds = 3.0;
+private:
+	struct Notification {
+		DebugMessageType type;
+		const char* file;           // Static strings from DEBUG_INFO, nullptr for the suppression summary
+		uint32_t line;
+		std::string message;
+		uint64_t count;
+	};
+	struct Toast {
+		Notification notification;
+		uint64_t id;
+		double lastTime;            // Of the latest repeat, the toast expires relative to it
+		bool closed = false;
+	};
+	struct QuietSite {
+		const char* file;
+		uint32_t line;
+		double until;
+	};
+
+	mutable std::mutex m_mutex;     // Guards m_pending and m_overflow
+	std::vector<Notification> m_pending;
+	uint64_t m_overflow = 0;
+
+	std::vector<Notification> m_incoming;
+	std::vector<Toast> m_toasts;
+	std::vector<QuietSite> m_quiet;
+	uint64_t m_suppressed = 0;      // Not shown because of the queue limit or a quiet site
+	uint64_t m_nextId = 1;
+
+	void merge(Notification&& notification, double now);
+	bool isQuiet(const char* file, uint32_t line) const;
+public:
+	void post(DebugMessageType type, const DebugInfo& info, std::string_view message);
+	// Toasts on screen ask for their own frames to fade, only new posts make it dirty.
+	[[nodiscard]] bool isDirty() const override;
+	void show() override;
+	void clear();
+
+	[[nodiscard]] inline size_t toastCount() const { return m_toasts.size(); }
+};
+
+extern NotificationCenter Notifications;
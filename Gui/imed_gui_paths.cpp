@@ -0,0 +1,234 @@
+#include "imed_gui_paths.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+PathInterner InternedPaths;
+
+static inline uint32_t HashName(std::string_view name) {
+	uint32_t hash = 2166136261u;
+	for (char c : name) {
+		hash = (hash ^ uint8_t(c)) * 16777619u;
+	}
+	return hash;
+}
+
+static inline uint32_t HashChild(uint32_t parent, uint32_t component) {
+	uint64_t key = (uint64_t(parent) << 32) | component;
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	return uint32_t(key);
+}
+
+// Doubles a table once it is half full, rehash returns the hash of a stored id.
+template<typename Rehash>
+static void GrowSlots(std::vector<uint32_t>& slots, size_t count, uint32_t empty, Rehash&& rehash) {
+	if ((count + 1) * 2 <= slots.size()) {
+		return;
+	}
+	std::vector<uint32_t> grown(std::max<size_t>(slots.size() * 2, 1024), empty);
+	const size_t mask = grown.size() - 1;
+	for (auto id : slots) {
+		if (id == empty) {
+			continue;
+		}
+		size_t slot = rehash(id) & mask;
+		while (grown[slot] != empty) {
+			slot = (slot + 1) & mask;
+		}
+		grown[slot] = id;
+	}
+	slots = std::move(grown);
+}
+
+PathInterner::PathInterner() {
+	std::lock_guard lock(m_mutex);
+	const auto root = internComponent({ });
+	m_records[0] = std::make_unique<Record[]>(ChunkSize);
+	m_records[0][0] = { InvalidPath, root };
+	m_pathCount = 1;
+}
+
+const char* PathInterner::store(std::string_view name) {
+	const size_t required = name.size() + 1;
+	char* storage;
+	if (required > BlockSize) {
+		auto block = std::make_unique<char[]>(required);
+		storage = block.get();
+		m_blocks.insert(m_blocks.empty() ? m_blocks.end() : m_blocks.end() - 1, std::move(block));
+		m_allocated += required;
+	} else {
+		if (m_used + required > BlockSize) {
+			m_blocks.push_back(std::make_unique<char[]>(BlockSize));
+			m_used = 0;
+			m_allocated += BlockSize;
+		}
+		storage = m_blocks.back().get() + m_used;
+		m_used += required;
+	}
+	std::memcpy(storage, name.data(), name.size());
+	storage[name.size()] = '\0';
+	return storage;
+}
+
+PathInterner::ComponentId PathInterner::findComponent(std::string_view name, uint32_t hash) const {
+	if (m_componentSlots.empty()) {
+		return EmptySlot;
+	}
+	const size_t mask = m_componentSlots.size() - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+		const auto id = m_componentSlots[slot];
+		if (id == EmptySlot) {
+			return EmptySlot;
+		}
+		const auto& component = componentAt(id);
+		if (component.hash == hash && std::string_view(component.data, component.length) == name) {
+			return id;
+		}
+	}
+}
+
+PathInterner::ComponentId PathInterner::internComponent(std::string_view name) {
+	const auto hash = HashName(name);
+	if (auto existing = findComponent(name, hash); existing != EmptySlot) {
+		return existing;
+	}
+
+	const ComponentId id = m_componentCount.load(std::memory_order_relaxed);
+	auto& chunk = m_components[id >> ChunkBits];
+	if (chunk == nullptr) {
+		chunk = std::make_unique<Component[]>(ChunkSize);
+	}
+	chunk[id & (ChunkSize - 1)] = { store(name), uint32_t(name.size()), hash };
+	m_componentCount.store(id + 1, std::memory_order_release);
+
+	GrowSlots(m_componentSlots, id + 1, EmptySlot, [this](uint32_t component) { return componentAt(component).hash; });
+	const size_t mask = m_componentSlots.size() - 1;
+	size_t slot = hash & mask;
+	while (m_componentSlots[slot] != EmptySlot) {
+		slot = (slot + 1) & mask;
+	}
+	m_componentSlots[slot] = id;
+	return id;
+}
+
+PathInterner::PathId PathInterner::findChild(PathId parent, ComponentId component) const {
+	if (m_pathSlots.empty()) {
+		return InvalidPath;
+	}
+	const size_t mask = m_pathSlots.size() - 1;
+	for (size_t slot = HashChild(parent, component) & mask;; slot = (slot + 1) & mask) {
+		const auto id = m_pathSlots[slot];
+		if (id == EmptySlot) {
+			return InvalidPath;
+		}
+		if (record(id).parent == parent && record(id).component == component) {
+			return id;
+		}
+	}
+}
+
+PathInterner::PathId PathInterner::internChild(PathId parent, ComponentId component) {
+	if (auto existing = findChild(parent, component); existing != InvalidPath) {
+		return existing;
+	}
+
+	const PathId id = m_pathCount.load(std::memory_order_relaxed);
+	auto& chunk = m_records[id >> ChunkBits];
+	if (chunk == nullptr) {
+		chunk = std::make_unique<Record[]>(ChunkSize);
+	}
+	chunk[id & (ChunkSize - 1)] = { parent, component };
+	m_pathCount.store(id + 1, std::memory_order_release);
+
+	GrowSlots(m_pathSlots, id, EmptySlot, [this](uint32_t path) { return HashChild(record(path).parent, record(path).component); });
+	const size_t mask = m_pathSlots.size() - 1;
+	size_t slot = HashChild(parent, component) & mask;
+	while (m_pathSlots[slot] != EmptySlot) {
+		slot = (slot + 1) & mask;
+	}
+	m_pathSlots[slot] = id;
+	return id;
+}
+
+PathInterner::PathId PathInterner::intern(std::string_view relativePath) {
+	std::lock_guard lock(m_mutex);
+	PathId path = EmptyPath;
+	while (!relativePath.empty()) {
+		const auto separator = relativePath.find('/');
+		const auto name = relativePath.substr(0, separator);
+		if (!name.empty()) {
+			path = internChild(path, internComponent(name));
+		}
+		relativePath = separator == std::string_view::npos ? std::string_view { } : relativePath.substr(separator + 1);
+	}
+	return path;
+}
+
+PathInterner::PathId PathInterner::child(PathId parent, std::string_view name) {
+	std::lock_guard lock(m_mutex);
+	return internChild(parent, internComponent(name));
+}
+
+PathInterner::PathId PathInterner::find(std::string_view relativePath) const {
+	std::lock_guard lock(m_mutex);
+	PathId path = EmptyPath;
+	while (!relativePath.empty() && path != InvalidPath) {
+		const auto separator = relativePath.find('/');
+		const auto name = relativePath.substr(0, separator);
+		if (!name.empty()) {
+			const auto component = findComponent(name, HashName(name));
+			path = component == EmptySlot ? InvalidPath : findChild(path, component);
+		}
+		relativePath = separator == std::string_view::npos ? std::string_view { } : relativePath.substr(separator + 1);
+	}
+	return path;
+}
+
+std::string_view PathInterner::component(std::string_view name) {
+	std::lock_guard lock(m_mutex);
+	const auto& component = componentAt(internComponent(name));
+	return { component.data, component.length };
+}
+
+void PathInterner::append(PathId path, std::string& out) const {
+	// Sized up front and filled back to front, the chain is only walked twice.
+	size_t length = 0;
+	for (auto current = path; current != EmptyPath; current = parent(current)) {
+		length += name(current).size() + 1;
+	}
+	if (length == 0) {
+		return;
+	}
+	const size_t start = out.size();
+	out.resize(start + length - 1);
+	size_t end = out.size();
+	for (auto current = path; current != EmptyPath; current = parent(current)) {
+		const auto part = name(current);
+		end -= part.size();
+		std::memcpy(out.data() + end, part.data(), part.size());
+		if (end > start) {
+			out[--end] = '/';
+		}
+	}
+}
+
+std::string PathInterner::string(PathId path) const {
+	std::string out;
+	append(path, out);
+	return out;
+}
+
+std::filesystem::path PathInterner::resolve(const std::filesystem::path& root, PathId path) const {
+	return path == EmptyPath ? root : root / std::filesystem::u8path(string(path));
+}
+
+size_t PathInterner::memoryUsage() const {
+	std::lock_guard lock(m_mutex);
+	size_t chunks = 0;
+	for (size_t i = 0; i < MaxChunks; i++) {
+		chunks += (m_records[i] != nullptr ? ChunkSize * sizeof(Record) : 0) + (m_components[i] != nullptr ? ChunkSize * sizeof(Component) : 0);
+	}
+	return chunks + (m_pathSlots.capacity() + m_componentSlots.capacity()) * sizeof(uint32_t) + m_allocated;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Process-wide pool of root-relative paths. A path is its parent's id plus an interned component, so paths
+// below the same directory share every byte of it and a path costs one 8 byte record and a hash slot.
+// Ids are never released, and reading a known id never takes the lock.
+class PathInterner {
+public:
+	using PathId = uint32_t;
+	using ComponentId = uint32_t;
+	static constexpr PathId EmptyPath = 0;      // The root itself
+	static constexpr PathId InvalidPath = UINT32_MAX;
+private:
+	static constexpr size_t ChunkBits = 16;
+	static constexpr size_t ChunkSize = size_t(1) << ChunkBits;
+	static constexpr size_t MaxChunks = 4096;
+	static constexpr size_t BlockSize = 64 * 1024;
+	static constexpr uint32_t EmptySlot = UINT32_MAX;
+
+	struct Record {
+		PathId parent;
+		ComponentId component;
+	};
+	struct Component {
+		const char* data;
+		uint32_t length;
+		uint32_t hash;
+	};
+
+	// Chunks never move once allocated, so ids handed out earlier stay readable while others are added.
+	std::array<std::unique_ptr<Record[]>, MaxChunks> m_records;
+	std::array<std::unique_ptr<Component[]>, MaxChunks> m_components;
+	std::atomic<uint32_t> m_pathCount = 0;
+	std::atomic<uint32_t> m_componentCount = 0;
+
+	// Open addressing tables of ids, guarded by m_mutex.
+	std::vector<uint32_t> m_pathSlots;
+	std::vector<uint32_t> m_componentSlots;
+	std::vector<std::unique_ptr<char[]>> m_blocks;
+	size_t m_used = BlockSize;
+	size_t m_allocated = 0;
+	mutable std::mutex m_mutex;
+
+	[[nodiscard]] inline const Record& record(PathId path) const { return m_records[path >> ChunkBits][path & (ChunkSize - 1)]; }
+	[[nodiscard]] inline const Component& componentAt(ComponentId component) const { return m_components[component >> ChunkBits][component & (ChunkSize - 1)]; }
+
+	ComponentId internComponent(std::string_view name);
+	PathId internChild(PathId parent, ComponentId component);
+	[[nodiscard]] ComponentId findComponent(std::string_view name, uint32_t hash) const;
+	[[nodiscard]] PathId findChild(PathId parent, ComponentId component) const;
+	const char* store(std::string_view name);
+public:
+	PathInterner();
+	PathInterner(const PathInterner&) = delete;
+	PathInterner& operator= (const PathInterner&) = delete;
+
+	// '/' separated, empty components are skipped.
+	PathId intern(std::string_view relativePath);
+	PathId child(PathId parent, std::string_view name);
+	// InvalidPath if the path was never interned.
+	[[nodiscard]] PathId find(std::string_view relativePath) const;
+	// Stable, null-terminated copy of a single name, shared with every path that has it as a component.
+	std::string_view component(std::string_view name);
+
+	[[nodiscard]] inline PathId parent(PathId path) const { return record(path).parent; }
+	[[nodiscard]] inline std::string_view name(PathId path) const {
+		const auto& component = componentAt(record(path).component);
+		return { component.data, component.length };
+	}
+	[[nodiscard]] inline size_t size() const { return m_pathCount.load(std::memory_order_relaxed); }
+	[[nodiscard]] size_t memoryUsage() const;
+
+	// Appends the '/' separated path to out, which allocates nothing once out has the capacity.
+	void append(PathId path, std::string& out) const;
+	[[nodiscard]] std::string string(PathId path) const;
+	[[nodiscard]] std::filesystem::path resolve(const std::filesystem::path& root, PathId path) const;
+};
+
+extern PathInterner InternedPaths;
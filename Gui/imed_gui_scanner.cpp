@@ -0,0 +1,461 @@
+#include "imed_gui_scanner.hpp"
+#include "imed_gui_ignore.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <dirent.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+
+struct LinuxDirent64 {
+	ino64_t d_ino;
+	off64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+#endif
+
+static constexpr size_t DirentBufferSize = 64 * 1024;
+
+struct WorkspaceScanner::DirHandle {
+	int fd;
+
+	explicit DirHandle(int fd): fd(fd) { }
+	DirHandle(const DirHandle&) = delete;
+	~DirHandle() {
+#if defined(__linux__)
+		if (fd >= 0) close(fd);
+#endif
+	}
+};
+
+WorkspaceScanner::WorkspaceScanner(ScanOptions options): m_options(std::move(options)), m_pending(0), m_nextDirId(0),
+	m_runningWorkers(0), m_cancelled(false) {
+	if (m_options.threadCount == 0) {
+		m_options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (m_options.batchSize == 0) {
+		m_options.batchSize = 1;
+	}
+}
+
+WorkspaceScanner::~WorkspaceScanner() {
+	cancel();
+	wait();
+}
+
+void WorkspaceScanner::start(const std::filesystem::path& root) {
+	cancel();
+	wait();
+
+	m_root = root;
+	m_workers.clear();
+	m_results.clear();
+	m_cancelled = false;
+	m_nextDirId = RootDirectory + 1;
+	m_pending = 1;
+
+	for (size_t i = 0; i < m_options.threadCount; i++) {
+		auto worker = std::make_unique<Worker>();
+		worker->batch.reserve(m_options.batchSize);
+		m_workers.push_back(std::move(worker));
+	}
+	m_workers.front()->queue.push_back(WorkItem { RootDirectory, "", "", nullptr, nullptr });
+
+	m_runningWorkers = m_workers.size();
+	for (size_t i = 0; i < m_workers.size(); i++) {
+		m_workers.at(i)->thread = std::thread([this, i]() { run(i); });
+	}
+}
+
+void WorkspaceScanner::cancel() {
+	m_cancelled = true;
+}
+
+void WorkspaceScanner::wait() {
+	for (auto& worker : m_workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+}
+
+std::vector<ScanEntry> WorkspaceScanner::poll() {
+	std::vector<std::vector<ScanEntry>> results;
+	{
+		std::lock_guard lock(m_resultsMutex);
+		results.swap(m_results);
+	}
+	if (results.size() == 1) {
+		return std::move(results.front());
+	}
+
+	size_t count = 0;
+	for (const auto& batch : results) {
+		count += batch.size();
+	}
+	std::vector<ScanEntry> entries;
+	entries.reserve(count);
+	for (auto& batch : results) {
+		std::move(batch.begin(), batch.end(), std::back_inserter(entries));
+	}
+	return entries;
+}
+
+std::vector<ScanEntry> WorkspaceScanner::Scan(const std::filesystem::path& root, const ScanOptions& options) {
+	WorkspaceScanner scanner { options };
+	scanner.start(root);
+	scanner.wait();
+	return scanner.poll();
+}
+
+std::vector<std::string> WorkspaceScanner::ResolvePaths(const std::vector<ScanEntry>& entries) {
+	// Batches arrive in any order, so a directory entry may come after its own children.
+	std::vector<size_t> directoryEntry;
+	for (size_t i = 0; i < entries.size(); i++) {
+		const auto& entry = entries.at(i);
+		if (entry.isDirectory()) {
+			if (entry.directory >= directoryEntry.size()) {
+				directoryEntry.resize(entry.directory + 1, SIZE_MAX);
+			}
+			directoryEntry.at(entry.directory) = i;
+		}
+	}
+
+	std::vector<std::string> paths(entries.size());
+	std::vector<bool> resolved(entries.size(), false);
+	std::vector<size_t> chain;
+	for (size_t i = 0; i < entries.size(); i++) {
+		for (size_t current = i; !resolved.at(current);) {
+			chain.push_back(current);
+			auto parent = entries.at(current).parent;
+			if (parent == RootDirectory || parent >= directoryEntry.size() || directoryEntry.at(parent) == SIZE_MAX) {
+				break;
+			}
+			current = directoryEntry.at(parent);
+		}
+
+		while (!chain.empty()) {
+			auto current = chain.back();
+			chain.pop_back();
+			if (resolved.at(current)) {
+				continue;
+			}
+			const auto& entry = entries.at(current);
+			auto parent = entry.parent < directoryEntry.size() ? directoryEntry.at(entry.parent) : SIZE_MAX;
+			if (entry.parent != RootDirectory && parent != SIZE_MAX) {
+				paths.at(current).reserve(paths.at(parent).size() + entry.name.size() + 1);
+				paths.at(current).append(paths.at(parent)).push_back('/');
+			}
+			paths.at(current).append(entry.name);
+			resolved.at(current) = true;
+		}
+	}
+	return paths;
+}
+
+std::vector<PathInterner::PathId> WorkspaceScanner::InternPaths(const std::vector<ScanEntry>& entries) {
+	std::vector<size_t> directoryEntry;
+	for (size_t i = 0; i < entries.size(); i++) {
+		const auto& entry = entries.at(i);
+		if (entry.isDirectory()) {
+			if (entry.directory >= directoryEntry.size()) {
+				directoryEntry.resize(entry.directory + 1, SIZE_MAX);
+			}
+			directoryEntry.at(entry.directory) = i;
+		}
+	}
+
+	// Same walk as ResolvePaths, but every entry only costs one child lookup below its parent's id.
+	std::vector<PathInterner::PathId> paths(entries.size(), PathInterner::InvalidPath);
+	std::vector<size_t> chain;
+	for (size_t i = 0; i < entries.size(); i++) {
+		for (size_t current = i; paths.at(current) == PathInterner::InvalidPath;) {
+			chain.push_back(current);
+			auto parent = entries.at(current).parent;
+			if (parent == RootDirectory || parent >= directoryEntry.size() || directoryEntry.at(parent) == SIZE_MAX) {
+				break;
+			}
+			current = directoryEntry.at(parent);
+		}
+
+		while (!chain.empty()) {
+			auto current = chain.back();
+			chain.pop_back();
+			if (paths.at(current) != PathInterner::InvalidPath) {
+				continue;
+			}
+			const auto& entry = entries.at(current);
+			auto parent = entry.parent < directoryEntry.size() ? directoryEntry.at(entry.parent) : SIZE_MAX;
+			const auto parentPath = entry.parent != RootDirectory && parent != SIZE_MAX ? paths.at(parent) : PathInterner::EmptyPath;
+			paths.at(current) = InternedPaths.child(parentPath, entry.name);
+		}
+	}
+	return paths;
+}
+
+bool WorkspaceScanner::take(size_t index, WorkItem& item) {
+	{
+		// Owner works depth-first from the back, which keeps few directory handles open at once.
+		auto& own = *m_workers.at(index);
+		std::lock_guard lock(own.mutex);
+		if (!own.queue.empty()) {
+			item = std::move(own.queue.back());
+			own.queue.pop_back();
+			return true;
+		}
+	}
+	for (size_t i = 1; i < m_workers.size(); i++) {
+		auto& victim = *m_workers.at((index + i) % m_workers.size());
+		std::lock_guard lock(victim.mutex);
+		if (!victim.queue.empty()) {
+			// Thieves take the oldest, shallowest directories, which tend to carry the largest subtrees.
+			item = std::move(victim.queue.front());
+			victim.queue.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkspaceScanner::push(size_t index, WorkItem&& item) {
+	m_pending.fetch_add(1);
+	auto& own = *m_workers.at(index);
+	std::lock_guard lock(own.mutex);
+	own.queue.push_back(std::move(item));
+}
+
+void WorkspaceScanner::run(size_t index) {
+	auto& worker = *m_workers.at(index);
+	worker.buffer.resize(DirentBufferSize);
+
+	size_t idleRounds = 0;
+	while (!m_cancelled.load(std::memory_order_relaxed)) {
+		WorkItem item;
+		if (!take(index, item)) {
+			if (m_pending.load() == 0) {
+				break;
+			}
+			if (++idleRounds < 64) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+			continue;
+		}
+		idleRounds = 0;
+		scanDirectory(worker, index, item);
+		m_pending.fetch_sub(1);
+	}
+
+	flush(worker);
+	worker.buffer = { };
+	m_runningWorkers.fetch_sub(1);
+}
+
+void WorkspaceScanner::emit(Worker& worker, ScanEntry&& entry) {
+	worker.batch.push_back(std::move(entry));
+	if (worker.batch.size() >= m_options.batchSize) {
+		flush(worker);
+	}
+}
+
+void WorkspaceScanner::flush(Worker& worker) {
+	if (worker.batch.empty()) {
+		return;
+	}
+	std::vector<ScanEntry> batch;
+	batch.reserve(m_options.batchSize);
+	batch.swap(worker.batch);
+
+	std::lock_guard lock(m_resultsMutex);
+	m_results.push_back(std::move(batch));
+}
+
+std::shared_ptr<const IgnoreRules> WorkspaceScanner::loadIgnoreRules(const WorkItem& item, int fd, uint32_t present) const {
+	if (m_options.ignoreFiles.empty() || present == 0) {
+		return item.rules;
+	}
+#if defined(__linux__)
+	std::string text;
+	for (size_t i = 0; i < m_options.ignoreFiles.size(); i++) {
+		int file = (present >> std::min<size_t>(i, 31)) & 1 ? openat(fd, m_options.ignoreFiles[i].c_str(), O_RDONLY | O_CLOEXEC) : -1;
+		if (file < 0) {
+			continue;
+		}
+		char buffer[4096];
+		for (ssize_t read; (read = ::read(file, buffer, sizeof(buffer))) > 0;) {
+			text.append(buffer, size_t(read));
+		}
+		close(file);
+		text.push_back('\n');
+	}
+	return text.empty() ? item.rules : IgnoreRules::Compile(text, item.relativePath, item.rules);
+#else
+	return IgnoreRules::Load(m_root, item.relativePath, m_options.ignoreFiles, item.rules);
+#endif
+}
+
+bool WorkspaceScanner::isIgnored(std::string_view name, std::string_view relativePath, bool isDirectory, const IgnoreRules* rules) const {
+	for (const auto& ignored : m_options.ignoredNames) {
+		if (name == ignored) {
+			return true;
+		}
+	}
+	if (rules != nullptr && rules->match(relativePath, name, isDirectory) == IgnoreMatch::Ignored) {
+		return true;
+	}
+	return m_options.ignore != nullptr && m_options.ignore(relativePath, isDirectory);
+}
+
+#if defined(__linux__)
+
+void WorkspaceScanner::scanDirectory(Worker& worker, size_t index, WorkItem& item) {
+	constexpr int openFlags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW;
+
+	// Open relative to the parent's descriptor so the kernel does not re-walk the full path,
+	// falling back to the absolute path if the parent is gone or we ran out of descriptors.
+	int fd = -1;
+	if (item.parent != nullptr) {
+		fd = openat(item.parent->fd, item.name.c_str(), openFlags);
+	}
+	if (fd < 0) {
+		fd = open((m_root / item.relativePath).c_str(), openFlags);
+	}
+	item.parent = nullptr;
+	if (fd < 0) {
+		return;
+	}
+	auto handle = std::make_shared<DirHandle>(fd);
+	auto rules = item.rules;
+
+	for (bool first = true;; first = false) {
+		long read = syscall(SYS_getdents64, fd, worker.buffer.data(), worker.buffer.size());
+		if (read <= 0) {
+			break;
+		}
+		if (first && !m_options.ignoreFiles.empty()) {
+			// Ignore files are only opened when the listing has them, saving a failed openat per file name in
+			// most directories. A batch that filled the buffer may be followed by more entries, then all are tried.
+			uint32_t present = read + 1024 > long(worker.buffer.size()) ? UINT32_MAX : 0;
+			for (long offset = 0; offset < read && present != UINT32_MAX;) {
+				auto dirent = reinterpret_cast<const LinuxDirent64*>(worker.buffer.data() + offset);
+				offset += dirent->d_reclen;
+				for (size_t i = 0; i < m_options.ignoreFiles.size(); i++) {
+					if (m_options.ignoreFiles[i] == dirent->d_name) present |= 1u << std::min<size_t>(i, 31);
+				}
+			}
+			rules = loadIgnoreRules(item, fd, present);
+		}
+
+		for (long offset = 0; offset < read;) {
+			auto dirent = reinterpret_cast<const LinuxDirent64*>(worker.buffer.data() + offset);
+			offset += dirent->d_reclen;
+
+			std::string_view name = dirent->d_name;
+			if (name == "." || name == "..") {
+				continue;
+			}
+
+			bool isDirectory = dirent->d_type == DT_DIR;
+			struct stat st { };
+			bool hasStat = false;
+			if (dirent->d_type == DT_UNKNOWN || (m_options.statFiles && !isDirectory)) {
+				hasStat = fstatat(fd, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+				isDirectory = hasStat && S_ISDIR(st.st_mode);
+			}
+
+			std::string relativePath;
+			relativePath.reserve(item.relativePath.size() + name.size() + 1);
+			if (!item.relativePath.empty()) {
+				relativePath.append(item.relativePath).push_back('/');
+			}
+			relativePath.append(name);
+
+			if (isIgnored(name, relativePath, isDirectory, rules.get())) {
+				continue;
+			}
+
+			ScanEntry entry { item.id, ScanEntry::NoDirectory, std::string(name) };
+			if (hasStat) {
+				entry.size = uint64_t(st.st_size);
+				entry.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+			}
+			if (isDirectory) {
+				entry.directory = m_nextDirId.fetch_add(1);
+				push(index, WorkItem { entry.directory, std::move(relativePath), entry.name, handle, rules });
+			}
+			emit(worker, std::move(entry));
+		}
+	}
+}
+
+#else
+
+void WorkspaceScanner::scanDirectory(Worker& worker, size_t index, WorkItem& item) {
+	std::error_code ec;
+	auto it = std::filesystem::directory_iterator(m_root / std::filesystem::u8path(item.relativePath), ec);
+	if (ec) {
+		return;
+	}
+	auto rules = loadIgnoreRules(item, -1, UINT32_MAX);
+
+	for (const auto& dirEntry : it) {
+		auto name = dirEntry.path().filename().u8string();
+		std::string nameStr { name.begin(), name.end() };
+		bool isDirectory = dirEntry.is_directory(ec) && !dirEntry.is_symlink(ec);
+
+		std::string relativePath = item.relativePath.empty() ? nameStr : item.relativePath + '/' + nameStr;
+		if (isIgnored(nameStr, relativePath, isDirectory, rules.get())) {
+			continue;
+		}
+
+		ScanEntry entry { item.id, ScanEntry::NoDirectory, nameStr };
+		if (m_options.statFiles && !isDirectory) {
+			entry.size = dirEntry.file_size(ec);
+			entry.mtime = dirEntry.last_write_time(ec).time_since_epoch().count();
+		}
+		if (isDirectory) {
+			entry.directory = m_nextDirId.fetch_add(1);
+			push(index, WorkItem { entry.directory, std::move(relativePath), nameStr, nullptr, rules });
+		}
+		emit(worker, std::move(entry));
+	}
+}
+
+#endif
+
+std::filesystem::path ImEdGui_WorkspaceCachePath(const std::filesystem::path& root, std::string_view fileName) {
+	std::filesystem::path base;
+#if defined(_WIN32)
+	if (const char* local = std::getenv("LOCALAPPDATA")) base = std::filesystem::path(local) / "imed" / "cache";
+#else
+	if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr && cache[0] != '\0') base = std::filesystem::path(cache) / "imed";
+	else if (const char* home = std::getenv("HOME")) base = std::filesystem::path(home) / ".cache" / "imed";
+#endif
+	if (base.empty()) {
+		base = std::filesystem::temp_directory_path() / "imed";
+	}
+
+	std::error_code ec;
+	auto canonical = std::filesystem::weakly_canonical(root, ec);
+	const auto key = (ec ? root : canonical).string();
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (char c : key) {
+		hash ^= uint8_t(c);
+		hash *= 0x100000001b3ull;
+	}
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+
+	auto directory = base / name;
+	std::filesystem::create_directories(directory, ec);
+	return directory / fileName;
+}
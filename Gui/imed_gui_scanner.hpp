@@ -0,0 +1,104 @@
+#pragma once
+
+#include "imed_gui_paths.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+struct ScanEntry {
+	static constexpr uint32_t NoDirectory = UINT32_MAX;
+
+	uint32_t parent;                    // Directory id of the containing directory
+	uint32_t directory = NoDirectory;   // Directory id of this entry if it is a directory
+	std::string name;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+
+	[[nodiscard]] inline constexpr bool isDirectory() const { return directory != NoDirectory; }
+};
+
+class IgnoreRules;
+
+struct ScanOptions {
+	size_t threadCount = 0;             // 0 = std::thread::hardware_concurrency()
+	size_t batchSize = 1024;
+	bool statFiles = false;             // Fill in size and mtime, costs one fstatat per file
+	std::vector<std::string> ignoredNames = { ".git", ".hg", ".svn" };
+	// Per-directory gitignore style rule files, later files take precedence. Empty to list everything.
+	std::vector<std::string> ignoreFiles = { ".gitignore", ".ignore" };
+	std::function<bool(std::string_view relativePath, bool isDirectory)> ignore = nullptr;
+};
+
+class WorkspaceScanner {
+	struct DirHandle;
+	struct WorkItem {
+		uint32_t id;
+		std::string relativePath;
+		std::string name;
+		std::shared_ptr<DirHandle> parent;
+		std::shared_ptr<const IgnoreRules> rules;   // Rules in effect in the containing directory
+	};
+	struct Worker {
+		std::mutex mutex;
+		std::deque<WorkItem> queue;
+		std::vector<ScanEntry> batch;
+		std::vector<char> buffer;
+		std::thread thread;
+	};
+
+	ScanOptions m_options;
+	std::filesystem::path m_root;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::atomic<size_t> m_pending;
+	std::atomic<uint32_t> m_nextDirId;
+	std::atomic<size_t> m_runningWorkers;
+	std::atomic<bool> m_cancelled;
+
+	std::mutex m_resultsMutex;
+	std::vector<std::vector<ScanEntry>> m_results;
+
+	void run(size_t index);
+	bool take(size_t index, WorkItem& item);
+	void push(size_t index, WorkItem&& item);
+	void scanDirectory(Worker& worker, size_t index, WorkItem& item);
+	void emit(Worker& worker, ScanEntry&& entry);
+	void flush(Worker& worker);
+	// present has a bit per ScanOptions::ignoreFiles entry that may exist in the directory.
+	[[nodiscard]] std::shared_ptr<const IgnoreRules> loadIgnoreRules(const WorkItem& item, int fd, uint32_t present) const;
+	[[nodiscard]] bool isIgnored(std::string_view name, std::string_view relativePath, bool isDirectory, const IgnoreRules* rules) const;
+public:
+	static constexpr uint32_t RootDirectory = 0;
+
+	explicit WorkspaceScanner(ScanOptions options = { });
+	WorkspaceScanner(const WorkspaceScanner&) = delete;
+	WorkspaceScanner& operator= (const WorkspaceScanner&) = delete;
+	~WorkspaceScanner();
+
+	void start(const std::filesystem::path& root);
+	void cancel();
+	void wait();
+
+	[[nodiscard]] inline bool isRunning() const { return m_runningWorkers.load() != 0; }
+	[[nodiscard]] inline const std::filesystem::path& root() const { return m_root; }
+
+	// Drains the batches the workers have finished so far, safe to call every frame.
+	std::vector<ScanEntry> poll();
+
+	static std::vector<ScanEntry> Scan(const std::filesystem::path& root, const ScanOptions& options = { });
+	// Root-relative, '/' separated path of every entry, in the same order as entries.
+	static std::vector<std::string> ResolvePaths(const std::vector<ScanEntry>& entries);
+	// The same paths as InternedPaths ids, no string is built for them.
+	static std::vector<PathInterner::PathId> InternPaths(const std::vector<ScanEntry>& entries);
+};
+
+// Per-workspace file in the user's cache directory (XDG_CACHE_HOME/imed/<root hash>/), the directory is created on demand.
+std::filesystem::path ImEdGui_WorkspaceCachePath(const std::filesystem::path& root, std::string_view fileName);
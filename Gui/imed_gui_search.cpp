@@ -0,0 +1,433 @@
+#include "imed_gui_search.hpp"
+#include "imed_gui_mappedfile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/stat.h>
+#endif
+
+// Only the head of a file is sniffed for NUL bytes.
+static constexpr size_t BinarySniffSize = 8 * 1024;
+// Smaller files are read into a reused buffer, mapping them costs more than copying.
+static constexpr size_t MapThreshold = 64 * 1024;
+static constexpr size_t MaxPreviewLength = 256;
+
+static inline char ToLowerAscii(char c) {
+	return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static inline char ToUpperAscii(char c) {
+	return (c >= 'a' && c <= 'z') ? char(c - 'a' + 'A') : c;
+}
+
+static bool EqualsIgnoreCase(const char* text, std::string_view lowered) {
+	for (size_t i = 0; i < lowered.size(); i++) {
+		if (ToLowerAscii(text[i]) != lowered[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool HasRegexSyntax(std::string_view query) {
+	return query.find_first_of("\\^$.|?*+()[]{}") != std::string_view::npos;
+}
+
+bool WorkspaceSearch::IsBinary(const uint8_t* data, size_t size) {
+	if (data == nullptr) {
+		return false;
+	}
+	size = std::min(size, BinarySniffSize);
+	size_t i = 0;
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 64 <= size; i += 64) {
+		const auto* block = reinterpret_cast<const __m128i*>(data + i);
+		const __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(block + 0), zero);
+		const __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(block + 1), zero);
+		const __m128i c = _mm_cmpeq_epi8(_mm_loadu_si128(block + 2), zero);
+		const __m128i d = _mm_cmpeq_epi8(_mm_loadu_si128(block + 3), zero);
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0) {
+			return true;
+		}
+	}
+#endif
+	return std::memchr(data + i, 0, size - i) != nullptr;
+}
+
+size_t WorkspaceSearch::FindLiteral(std::string_view text, size_t from, std::string_view needle, bool ignoreCase) {
+	if (needle.empty() || from > text.size() || text.size() - from < needle.size()) {
+		return std::string_view::npos;
+	}
+
+	// Candidates need both the first and the last needle byte at the right distance, 16 positions are tested at once
+	// and only the survivors are compared in full.
+	const size_t last = text.size() - needle.size();
+	const size_t tail = needle.size() - 1;
+	const char firstLower = needle[0], firstUpper = ignoreCase ? ToUpperAscii(needle[0]) : needle[0];
+	const char lastLower = needle[tail], lastUpper = ignoreCase ? ToUpperAscii(needle[tail]) : needle[tail];
+	auto verify = [&](size_t at) {
+		return ignoreCase ? EqualsIgnoreCase(text.data() + at, needle) : std::memcmp(text.data() + at, needle.data(), needle.size()) == 0;
+	};
+
+	size_t i = from;
+#if defined(__SSE2__)
+	const __m128i firstLowerBytes = _mm_set1_epi8(firstLower), firstUpperBytes = _mm_set1_epi8(firstUpper);
+	const __m128i lastLowerBytes = _mm_set1_epi8(lastLower), lastUpperBytes = _mm_set1_epi8(lastUpper);
+	for (; i + 16 <= last + 1; i += 16) {
+		const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+		const __m128i end = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i + tail));
+		const __m128i headMatch = _mm_or_si128(_mm_cmpeq_epi8(head, firstLowerBytes), _mm_cmpeq_epi8(head, firstUpperBytes));
+		const __m128i endMatch = _mm_or_si128(_mm_cmpeq_epi8(end, lastLowerBytes), _mm_cmpeq_epi8(end, lastUpperBytes));
+		auto mask = uint32_t(_mm_movemask_epi8(_mm_and_si128(headMatch, endMatch)));
+		while (mask != 0) {
+			const auto candidate = i + size_t(__builtin_ctz(mask));
+			if (verify(candidate)) {
+				return candidate;
+			}
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for (; i <= last; i++) {
+		if ((text[i] == firstLower || text[i] == firstUpper) && verify(i)) {
+			return i;
+		}
+	}
+	return std::string_view::npos;
+}
+
+std::string WorkspaceSearch::RequiredLiteral(std::string_view pattern) {
+	// Conservative: alternations give up, only runs outside of groups and classes count.
+	if (pattern.find('|') != std::string_view::npos) {
+		return { };
+	}
+	std::string best, run;
+	auto endRun = [&]() {
+		if (run.size() > best.size()) best = run;
+		run.clear();
+	};
+	int depth = 0;
+	for (size_t i = 0; i < pattern.size(); i++) {
+		const char c = pattern[i];
+		std::optional<char> literal;
+		switch (c) {
+			case '\\':
+				if (i + 1 < pattern.size() && !std::isalnum(uint8_t(pattern[i + 1]))) {
+					literal = pattern[++i];
+				} else {
+					i++;
+					endRun();
+				}
+				break;
+			case '[':
+				while (i < pattern.size() && pattern[i] != ']') {
+					i += pattern[i] == '\\' ? 2 : 1;
+				}
+				endRun();
+				break;
+			case '(': depth++; endRun(); break;
+			case ')': depth--; endRun(); break;
+			case '?': case '*': case '{':
+				// The previous character is optional after all.
+				if (!run.empty()) run.pop_back();
+				endRun();
+				if (c == '{') i = std::min(pattern.find('}', i), pattern.size());
+				break;
+			case '+': endRun(); break;
+			case '.': case '^': case '$': endRun(); break;
+			default: literal = c; break;
+		}
+		if (literal.has_value()) {
+			if (depth == 0) run.push_back(*literal);
+			else endRun();
+		}
+	}
+	endRun();
+	return best;
+}
+
+WorkspaceSearch::WorkspaceSearch(const std::filesystem::path& rootPath): m_root(rootPath), m_cancelled(false), m_running(false),
+	m_nextFile(0), m_filesSearched(0), m_hitCount(0), m_fileCount(0), m_filesGeneration(0) { }
+
+WorkspaceSearch::~WorkspaceSearch() {
+	cancel();
+}
+
+void WorkspaceSearch::cancel() {
+	m_cancelled = true;
+	{
+		std::lock_guard lock(m_scannerMutex);
+		if (m_scanner != nullptr) {
+			m_scanner->cancel();
+		}
+	}
+	if (m_driver.joinable()) {
+		m_driver.join();
+	}
+	m_running = false;
+}
+
+bool WorkspaceSearch::start(const std::string& query, const SearchOptions& options) {
+	return launch(query, options, std::nullopt);
+}
+
+bool WorkspaceSearch::start(const std::string& query, const SearchOptions& options, std::vector<std::string> files) {
+	return launch(query, options, std::move(files));
+}
+
+bool WorkspaceSearch::launch(const std::string& query, const SearchOptions& options, std::optional<std::vector<std::string>> files) {
+	cancel();
+
+	Matcher matcher { { }, options.ignoreCase, std::nullopt, { } };
+	if (options.regex && HasRegexSyntax(query)) {
+		auto flags = std::regex::ECMAScript | std::regex::optimize;
+		if (options.ignoreCase) {
+			flags |= std::regex::icase;
+		}
+		try {
+			matcher.regex.emplace(query, flags);
+		} catch (const std::regex_error&) {
+			return false;
+		}
+		matcher.required = RequiredLiteral(query);
+		if (options.ignoreCase) {
+			std::transform(matcher.required.begin(), matcher.required.end(), matcher.required.begin(), ToLowerAscii);
+		}
+	} else {
+		// Regexes without any syntax are plain literals, which take the much faster path.
+		matcher.literal = query;
+		if (options.ignoreCase) {
+			std::transform(matcher.literal.begin(), matcher.literal.end(), matcher.literal.begin(), ToLowerAscii);
+		}
+	}
+
+	m_hits.clear();
+	m_files.clear();
+	m_nextFile = 0;
+	m_filesSearched = 0;
+	m_hitCount = 0;
+	m_fileCount = 0;
+	m_cancelled = false;
+	if (query.empty()) {
+		return true;
+	}
+
+	m_running = true;
+	m_driver = std::thread([this, matcher = std::move(matcher), options, files = std::move(files)]() mutable {
+		run(std::move(matcher), std::move(options), std::move(files));
+	});
+	return true;
+}
+
+size_t WorkspaceSearch::poll(std::vector<SearchHit>& hits) {
+	std::lock_guard lock(m_hitsMutex);
+	const size_t count = m_hits.size();
+	std::move(m_hits.begin(), m_hits.end(), std::back_inserter(hits));
+	m_hits.clear();
+	return count;
+}
+
+void WorkspaceSearch::run(Matcher matcher, SearchOptions options, std::optional<std::vector<std::string>> files) {
+	if (files.has_value()) {
+		m_files.reserve(files->size());
+		for (const auto& file : *files) {
+			m_files.push_back(InternedPaths.intern(file));
+		}
+	} else {
+		if (!listWorkspace(options.scan)) {
+			m_running = false;
+			return;
+		}
+		m_files = m_workspaceFiles;
+	}
+	m_fileCount = m_files.size();
+
+	size_t threads = options.threadCount != 0 ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+	threads = std::max<size_t>(1, std::min(threads, m_files.size()));
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++) {
+		workers.emplace_back([this, &matcher, &options]() {
+			Worker worker;
+			searchFiles(matcher, options, worker);
+		});
+	}
+	Worker worker;
+	searchFiles(matcher, options, worker);
+	for (auto& thread : workers) {
+		thread.join();
+	}
+	m_running = false;
+}
+
+bool WorkspaceSearch::listWorkspace(const ScanOptions& options) {
+	const uint64_t generation = m_filesGeneration.load();
+	if (m_listedGeneration == generation) {
+		return true;
+	}
+
+	WorkspaceScanner scanner { options };
+	{
+		// Started under the lock, so a cancel() from now on reaches the scanner instead of being reset by start().
+		std::lock_guard lock(m_scannerMutex);
+		if (m_cancelled) {
+			return false;
+		}
+		scanner.start(m_root);
+		m_scanner = &scanner;
+	}
+	scanner.wait();
+	{
+		std::lock_guard lock(m_scannerMutex);
+		m_scanner = nullptr;
+	}
+	// A cancelled scan is incomplete and never cached.
+	if (m_cancelled) {
+		return false;
+	}
+
+	auto entries = scanner.poll();
+	auto paths = WorkspaceScanner::InternPaths(entries);
+	m_workspaceFiles.clear();
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (!entries[i].isDirectory()) {
+			m_workspaceFiles.push_back(paths[i]);
+		}
+	}
+	m_listedGeneration = generation;
+	return true;
+}
+
+void WorkspaceSearch::searchFiles(const Matcher& matcher, const SearchOptions& options, Worker& worker) {
+	const auto root = m_root.string() + "/";
+	std::string path;
+	MappedFile mapped;
+	for (;;) {
+		const size_t file = m_nextFile.fetch_add(1, std::memory_order_relaxed);
+		if (file >= m_files.size() || m_cancelled.load(std::memory_order_relaxed) || m_hitCount.load(std::memory_order_relaxed) >= options.maxHits) {
+			return;
+		}
+		path.assign(root);
+		InternedPaths.append(m_files[file], path);
+
+		std::string_view text;
+#if defined(__linux__)
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			continue;
+		}
+		struct stat st { };
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || size_t(st.st_size) > options.maxFileSize) {
+			close(fd);
+			continue;
+		}
+		if (size_t(st.st_size) < MapThreshold) {
+			worker.buffer.resize(size_t(st.st_size));
+			const auto read = ::read(fd, worker.buffer.data(), worker.buffer.size());
+			close(fd);
+			if (read < 0) {
+				continue;
+			}
+			text = { reinterpret_cast<const char*>(worker.buffer.data()), size_t(read) };
+		} else {
+			close(fd);
+			if (!mapped.open(path)) {
+				continue;
+			}
+			text = mapped.view();
+		}
+#else
+		if (!mapped.open(path) || mapped.size() > options.maxFileSize) {
+			continue;
+		}
+		text = mapped.view();
+#endif
+
+		if (!IsBinary(reinterpret_cast<const uint8_t*>(text.data()), text.size())) {
+			searchFile(matcher, uint32_t(file), text, worker);
+			publish(worker);
+		}
+		mapped.close();
+		m_filesSearched.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+static void AddHit(std::vector<SearchHit>& hits, uint32_t file, uint32_t line, std::string_view lineText, size_t column, size_t length) {
+	// Long lines (minified files) are previewed around the match.
+	size_t previewStart = 0;
+	if (lineText.size() > MaxPreviewLength && column > MaxPreviewLength / 4) {
+		previewStart = column - MaxPreviewLength / 4;
+	}
+	auto preview = lineText.substr(previewStart, MaxPreviewLength);
+	while (!preview.empty() && (preview.back() == '\r' || preview.back() == '\n')) {
+		preview.remove_suffix(1);
+	}
+	hits.push_back(SearchHit { file, line, uint32_t(column), uint32_t(length), std::string(preview) });
+}
+
+void WorkspaceSearch::searchFile(const Matcher& matcher, uint32_t file, std::string_view text, Worker& worker) {
+	auto searchLine = [&](uint32_t line, std::string_view lineText) {
+		if (!matcher.regex.has_value()) {
+			for (size_t pos = 0; (pos = FindLiteral(lineText, pos, matcher.literal, matcher.ignoreCase)) != std::string_view::npos; pos += matcher.literal.size()) {
+				AddHit(worker.hits, file, line, lineText, pos, matcher.literal.size());
+			}
+			return;
+		}
+		for (std::cregex_iterator it(lineText.data(), lineText.data() + lineText.size(), *matcher.regex), end; it != end; ++it) {
+			if (it->length(0) == 0) {
+				break;
+			}
+			AddHit(worker.hits, file, line, lineText, size_t(it->position(0)), size_t(it->length(0)));
+		}
+	};
+
+	const std::string_view anchor = matcher.regex.has_value() ? matcher.required : matcher.literal;
+	if (anchor.empty()) {
+		uint32_t line = 1;
+		for (size_t lineStart = 0; lineStart < text.size() && !m_cancelled.load(std::memory_order_relaxed); line++) {
+			auto lineEnd = text.find('\n', lineStart);
+			lineEnd = lineEnd == std::string_view::npos ? text.size() : lineEnd;
+			searchLine(line, text.substr(lineStart, lineEnd - lineStart));
+			lineStart = lineEnd + 1;
+		}
+		return;
+	}
+
+	// Jump between occurrences of the anchor literal and count newlines only over the skipped stretches.
+	uint32_t line = 1;
+	size_t counted = 0;
+	for (size_t pos = 0;;) {
+		const auto match = FindLiteral(text, pos, anchor, matcher.ignoreCase);
+		if (match == std::string_view::npos || m_cancelled.load(std::memory_order_relaxed)) {
+			return;
+		}
+		auto lineStart = text.rfind('\n', match);
+		lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+		auto lineEnd = text.find('\n', match);
+		lineEnd = lineEnd == std::string_view::npos ? text.size() : lineEnd;
+
+		line += uint32_t(std::count(text.begin() + ptrdiff_t(counted), text.begin() + ptrdiff_t(lineStart), '\n'));
+		counted = lineStart;
+		searchLine(line, text.substr(lineStart, lineEnd - lineStart));
+		pos = lineEnd + 1;
+	}
+}
+
+void WorkspaceSearch::publish(Worker& worker) {
+	if (worker.hits.empty()) {
+		return;
+	}
+	m_hitCount.fetch_add(worker.hits.size(), std::memory_order_relaxed);
+	std::lock_guard lock(m_hitsMutex);
+	std::move(worker.hits.begin(), worker.hits.end(), std::back_inserter(m_hits));
+	worker.hits.clear();
+}
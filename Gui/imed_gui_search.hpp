@@ -0,0 +1,105 @@
+#pragma once
+
+#include "imed_gui_scanner.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <regex>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+struct SearchOptions {
+	bool regex = false;
+	bool ignoreCase = true;
+	size_t threadCount = 0;                 // 0 = std::thread::hardware_concurrency()
+	size_t maxFileSize = 64 * 1024 * 1024;  // Larger files are skipped
+	size_t maxHits = 100000;                // The search stops once this many hits were found
+	ScanOptions scan;
+};
+
+struct SearchHit {
+	uint32_t file;      // Index into WorkspaceSearch::file()
+	uint32_t line;      // 1-based
+	uint32_t column;    // 0-based byte offset into the line
+	uint32_t length;
+	std::string preview;
+};
+
+// Find in files over a workspace, every file is searched on a worker pool and hits are streamed as they are found.
+class WorkspaceSearch {
+	struct Worker {
+		std::vector<uint8_t> buffer;
+		std::vector<SearchHit> hits;
+	};
+	struct Matcher {
+		std::string literal;        // Lowered when ignoring case
+		bool ignoreCase;
+		std::optional<std::regex> regex;
+		std::string required;       // Literal every regex match contains, lines without it are never handed to the regex
+	};
+
+	std::filesystem::path m_root;
+	std::thread m_driver;
+	std::atomic<bool> m_cancelled;
+	std::atomic<bool> m_running;
+	std::atomic<size_t> m_nextFile;
+	std::atomic<size_t> m_filesSearched;
+	std::atomic<size_t> m_hitCount;
+	std::atomic<size_t> m_fileCount;
+	std::vector<PathInterner::PathId> m_files;
+
+	// The workspace is listed once and reused by later searches until invalidateFiles() bumps the generation.
+	std::atomic<uint64_t> m_filesGeneration;
+	std::optional<uint64_t> m_listedGeneration;
+	std::vector<PathInterner::PathId> m_workspaceFiles;
+	// Scanner listing the workspace for the running search, cancel() stops it along with the workers.
+	std::mutex m_scannerMutex;
+	WorkspaceScanner* m_scanner = nullptr;
+
+	std::mutex m_hitsMutex;
+	std::vector<SearchHit> m_hits;
+
+	bool launch(const std::string& query, const SearchOptions& options, std::optional<std::vector<std::string>> files);
+	bool listWorkspace(const ScanOptions& options);
+	void run(Matcher matcher, SearchOptions options, std::optional<std::vector<std::string>> files);
+	void searchFiles(const Matcher& matcher, const SearchOptions& options, Worker& worker);
+	void searchFile(const Matcher& matcher, uint32_t file, std::string_view text, Worker& worker);
+	void publish(Worker& worker);
+public:
+	explicit WorkspaceSearch(const std::filesystem::path& rootPath);
+	WorkspaceSearch(const WorkspaceSearch&) = delete;
+	WorkspaceSearch& operator= (const WorkspaceSearch&) = delete;
+	~WorkspaceSearch();
+
+	// Cancels the running search and starts a new one, hits of the previous search become invalid.
+	// Returns false if the query is not a valid regex.
+	bool start(const std::string& query, const SearchOptions& options = { });
+	// Searches only the given root-relative files instead of scanning the workspace, e.g. TrigramIndex::candidates().
+	bool start(const std::string& query, const SearchOptions& options, std::vector<std::string> files);
+	void cancel();
+	// Drops the cached workspace listing, the next search without a file list scans again. Connect to
+	// FreeTreeNode::OnFilesChanged, or call after changing SearchOptions::scan.
+	inline void invalidateFiles() { m_filesGeneration.fetch_add(1); }
+
+	[[nodiscard]] inline bool isRunning() const { return m_running.load(); }
+	[[nodiscard]] inline const std::filesystem::path& root() const { return m_root; }
+	[[nodiscard]] inline size_t filesSearched() const { return m_filesSearched.load(); }
+	[[nodiscard]] inline size_t fileCount() const { return m_fileCount.load(); }
+	// Interned root-relative path of a hit's file, only valid for files referenced by hits returned from poll().
+	[[nodiscard]] inline PathInterner::PathId file(uint32_t file) const { return m_files[file]; }
+
+	// Appends the hits found since the last call, returns how many were added.
+	size_t poll(std::vector<SearchHit>& hits);
+
+	// True if the first bytes contain a NUL, the same heuristic git and ripgrep use.
+	static bool IsBinary(const uint8_t* data, size_t size);
+	// Position of the first occurrence of needle at or after from, needle has to be lowered when ignoring case.
+	static size_t FindLiteral(std::string_view text, size_t from, std::string_view needle, bool ignoreCase);
+	// Longest literal run that has to occur in every match of an ECMAScript pattern, empty if there is none.
+	static std::string RequiredLiteral(std::string_view pattern);
+};
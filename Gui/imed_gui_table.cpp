@@ -0,0 +1,375 @@
+#include "imed_gui_table.hpp"
+#include "imed_gui_search.hpp"
+#include "imed_gui_logger.hpp"
+#include "imed_gui_app.hpp"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <thread>
+
+// Smaller texts are not worth a thread per chunk.
+static constexpr size_t MinChunkSize = 1024 * 1024;
+// Column count is taken from the first rows, later rows with more cells show the extra ones truncated.
+static constexpr size_t ColumnSampleRows = 1024;
+// IMGUI_TABLE_MAX_COLUMNS
+static constexpr size_t MaxColumns = 512;
+
+template<typename Function>
+static void ParallelFor(size_t count, Function&& function) {
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < count; i++) {
+		threads.emplace_back([&function, i]() { function(i); });
+	}
+	if (count != 0) {
+		function(0);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+DelimitedIndex DelimitedIndex::Build(std::string_view text, char delimiter, size_t threadCount) {
+	DelimitedIndex index;
+	index.m_text = text;
+	index.m_delimiter = delimiter;
+	if (text.empty()) {
+		return index;
+	}
+
+	const size_t threads = threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+	const size_t chunkCount = std::clamp<size_t>(text.size() / MinChunkSize, 1, threads);
+	const size_t chunkSize = (text.size() + chunkCount - 1) / chunkCount;
+	const auto chunk = [&](size_t i) {
+		return text.substr(std::min(i * chunkSize, text.size()), chunkSize);
+	};
+
+	std::vector<size_t> quotes(chunkCount);
+	ParallelFor(chunkCount, [&](size_t i) {
+		const auto part = chunk(i);
+		quotes[i] = size_t(std::count(part.begin(), part.end(), '"'));
+	});
+
+	// An escaped quote is a pair, so the parity of all quotes before a chunk tells whether it starts inside a field.
+	std::vector<uint8_t> startsQuoted(chunkCount, 0);
+	for (size_t i = 1; i < chunkCount; i++) {
+		startsQuoted[i] = uint8_t(startsQuoted[i - 1] ^ (quotes[i - 1] & 1));
+	}
+
+	std::vector<std::vector<uint64_t>> rowStarts(chunkCount);
+	ParallelFor(chunkCount, [&](size_t i) {
+		const auto part = chunk(i);
+		const uint64_t base = uint64_t(part.data() - text.data());
+		bool quoted = startsQuoted[i] != 0;
+		for (size_t pos = 0; pos < part.size();) {
+			const auto* newline = static_cast<const char*>(std::memchr(part.data() + pos, '\n', part.size() - pos));
+			if (newline == nullptr) {
+				break;
+			}
+			const size_t end = size_t(newline - part.data());
+			quoted ^= (std::count(part.begin() + ptrdiff_t(pos), part.begin() + ptrdiff_t(end), '"') & 1) != 0;
+			if (!quoted) {
+				rowStarts[i].push_back(base + end + 1);
+			}
+			pos = end + 1;
+		}
+	});
+
+	size_t total = 1;
+	for (const auto& starts : rowStarts) {
+		total += starts.size();
+	}
+	index.m_rowStart.reserve(total + 1);
+	index.m_rowStart.push_back(0);
+	for (const auto& starts : rowStarts) {
+		index.m_rowStart.insert(index.m_rowStart.end(), starts.begin(), starts.end());
+	}
+	// A trailing line break ends the last row rather than starting an empty one.
+	if (index.m_rowStart.back() != text.size()) {
+		index.m_rowStart.push_back(text.size());
+	}
+
+	std::vector<std::string_view> cells;
+	for (size_t row = 0; row < std::min(index.rowCount(), ColumnSampleRows); row++) {
+		index.cells(row, cells);
+		index.m_columnCount = std::max(index.m_columnCount, cells.size());
+	}
+	return index;
+}
+
+std::string_view DelimitedIndex::row(size_t row) const {
+	auto text = m_text.substr(m_rowStart[row], m_rowStart[row + 1] - m_rowStart[row]);
+	if (!text.empty() && text.back() == '\n') text.remove_suffix(1);
+	if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+	return text;
+}
+
+void DelimitedIndex::cells(size_t row, std::vector<std::string_view>& cells) const {
+	SplitRow(this->row(row), m_delimiter, cells);
+}
+
+void DelimitedIndex::SplitRow(std::string_view row, char delimiter, std::vector<std::string_view>& cells) {
+	cells.clear();
+	for (size_t pos = 0;;) {
+		size_t end = pos;
+		if (end < row.size() && row[end] == '"') {
+			for (end++; end < row.size(); end++) {
+				if (row[end] == '"') {
+					if (end + 1 < row.size() && row[end + 1] == '"') {
+						end++;
+						continue;
+					}
+					end++;
+					break;
+				}
+			}
+		}
+		const auto next = row.find(delimiter, end);
+		if (next == std::string_view::npos) {
+			cells.push_back(row.substr(pos));
+			return;
+		}
+		cells.push_back(row.substr(pos, next - pos));
+		pos = next + 1;
+	}
+}
+
+std::string_view DelimitedIndex::Unquote(std::string_view cell, std::string& scratch) {
+	if (cell.empty() || cell.front() != '"') {
+		return cell;
+	}
+	cell.remove_prefix(1);
+	if (!cell.empty() && cell.back() == '"') {
+		cell.remove_suffix(1);
+	}
+	if (cell.find("\"\"") == std::string_view::npos) {
+		return cell;
+	}
+	scratch.clear();
+	for (size_t i = 0; i < cell.size(); i++) {
+		scratch.push_back(cell[i]);
+		if (cell[i] == '"' && i + 1 < cell.size() && cell[i + 1] == '"') {
+			i++;
+		}
+	}
+	return scratch;
+}
+
+DelimitedTable::~DelimitedTable() {
+	cancelView();
+	if (m_indexing.valid()) {
+		m_indexing.wait();
+	}
+}
+
+bool DelimitedTable::open(const std::filesystem::path& path, char delimiter) {
+	markDirty();
+	cancelView();
+	if (m_indexing.valid()) {
+		m_indexing.wait();
+		m_indexing = { };
+	}
+	m_index = { };
+	m_view.clear();
+	m_hasView = false;
+	m_columnNames.clear();
+	if (!m_file.open(path)) {
+		ImEdLogFormat(DebugMessageType::Warning, "Failed to open \"{}\"", path.string());
+		return false;
+	}
+
+	if (delimiter == 0) {
+		auto extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(std::tolower(uint8_t(c))); });
+		delimiter = extension == ".tsv" || extension == ".tab" ? '\t' : ',';
+	}
+	m_indexing = Application::Async([text = m_file.view(), delimiter]() {
+		return DelimitedIndex::Build(text, delimiter);
+	});
+	return true;
+}
+
+size_t DelimitedTable::visibleRowCount() const {
+	return m_hasView ? m_view.size() : m_index.rowCount() - firstDataRow();
+}
+
+void DelimitedTable::refreshColumnNames() {
+	m_columnNames.clear();
+	const size_t columns = std::clamp<size_t>(m_index.columnCount(), 1, MaxColumns);
+	if (hasHeader && m_index.rowCount() != 0) {
+		m_index.cells(0, m_cells);
+	} else {
+		m_cells.clear();
+	}
+	for (size_t column = 0; column < columns; column++) {
+		if (column < m_cells.size()) {
+			m_columnNames.emplace_back(DelimitedIndex::Unquote(m_cells[column], m_scratch));
+		} else {
+			m_columnNames.push_back(fmt::format("Column {}", column + 1));
+		}
+	}
+}
+
+std::vector<uint32_t> DelimitedTable::buildView(const ViewRequest& request) const {
+	std::vector<uint32_t> view;
+	const size_t first = firstDataRow();
+	view.reserve(m_index.rowCount() - first);
+	for (size_t row = first; row < m_index.rowCount(); row++) {
+		if ((row & 4095) == 0 && m_cancelView.load(std::memory_order_relaxed)) {
+			return { };
+		}
+		if (request.filter.empty() || WorkspaceSearch::FindLiteral(m_index.row(row), 0, request.filter, true) != std::string_view::npos) {
+			view.push_back(uint32_t(row));
+		}
+	}
+	if (request.sortColumn < 0) {
+		return view;
+	}
+
+	// Keys are extracted once, numbers compare as numbers and sort ahead of text.
+	struct Key {
+		double number;
+		std::string_view text;
+		uint32_t row;
+		bool numeric;
+	};
+	std::vector<Key> keys;
+	keys.reserve(view.size());
+	std::vector<std::string_view> cells;
+	for (auto row : view) {
+		if ((keys.size() & 4095) == 0 && m_cancelView.load(std::memory_order_relaxed)) {
+			return { };
+		}
+		m_index.cells(row, cells);
+		auto text = size_t(request.sortColumn) < cells.size() ? cells[size_t(request.sortColumn)] : std::string_view { };
+		if (!text.empty() && text.front() == '"') {
+			text = text.substr(1, text.size() >= 2 && text.back() == '"' ? text.size() - 2 : text.size() - 1);
+		}
+		const auto trimmed = text.substr(std::min(text.find_first_not_of(' '), text.size()));
+		Key key { 0.0, text, row, false };
+		const auto [end, error] = std::from_chars(trimmed.data(), trimmed.data() + trimmed.size(), key.number);
+		key.numeric = !trimmed.empty() && error == std::errc { } && (end == trimmed.data() + trimmed.size() || *end == ' ');
+		keys.push_back(key);
+	}
+	const auto less = [](const Key& lhs, const Key& rhs) {
+		if (lhs.numeric != rhs.numeric) return lhs.numeric;
+		return lhs.numeric ? lhs.number < rhs.number : lhs.text < rhs.text;
+	};
+	if (request.descending) {
+		std::stable_sort(keys.begin(), keys.end(), [&less](const Key& lhs, const Key& rhs) { return less(rhs, lhs); });
+	} else {
+		std::stable_sort(keys.begin(), keys.end(), less);
+	}
+	for (size_t i = 0; i < keys.size(); i++) {
+		view[i] = keys[i].row;
+	}
+	return view;
+}
+
+void DelimitedTable::cancelView() {
+	if (m_viewing.valid()) {
+		m_cancelView = true;
+		m_viewing.wait();
+		m_viewing = { };
+	}
+}
+
+void DelimitedTable::startView() {
+	cancelView();
+	if (m_request.sortColumn < 0 && m_request.filter.empty()) {
+		m_view.clear();
+		m_hasView = false;
+		return;
+	}
+	m_cancelView = false;
+	m_viewing = Application::Async([this, request = m_request]() {
+		return buildView(request);
+	});
+}
+
+bool DelimitedTable::isDirty() const {
+	if (IWidget::isDirty()) {
+		return true;
+	}
+	const auto ready = [](const auto& future) { return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; };
+	return ready(m_indexing) || ready(m_viewing);
+}
+
+void DelimitedTable::show() {
+	if (!m_file.isOpen()) {
+		ImGui::TextDisabled("No file");
+		return;
+	}
+	if (isIndexing()) {
+		if (m_indexing.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			ImGui::TextDisabled("Indexing rows...");
+			return;
+		}
+		m_index = m_indexing.get();
+		refreshColumnNames();
+		startView();
+	}
+	if (m_viewing.valid() && m_viewing.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		m_view = m_viewing.get();
+		m_hasView = true;
+	}
+
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 20.0f);
+	if (ImGui::InputTextWithHint("##Filter", "Filter rows", m_filter, sizeof(m_filter))) {
+		m_request.filter = m_filter;
+		std::transform(m_request.filter.begin(), m_request.filter.end(), m_request.filter.begin(), [](char c) {
+			return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+		});
+		startView();
+	}
+	ImGui::SameLine();
+	ImGui::TextDisabled("%zu of %zu rows%s", visibleRowCount(), m_index.rowCount() - firstDataRow(), m_viewing.valid() ? ", updating..." : "");
+
+	const int columns = int(m_columnNames.size());
+	const ImGuiTableFlags flags = ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable |
+		ImGuiTableFlags_Hideable | ImGuiTableFlags_Sortable | ImGuiTableFlags_SortTristate | ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit;
+	if (!ImGui::BeginTable("##Table", columns, flags)) {
+		return;
+	}
+	ImGui::TableSetupScrollFreeze(0, 1);
+	for (const auto& name : m_columnNames) {
+		ImGui::TableSetupColumn(name.c_str());
+	}
+	ImGui::TableHeadersRow();
+
+	if (auto* specs = ImGui::TableGetSortSpecs(); specs != nullptr && specs->SpecsDirty) {
+		m_request.sortColumn = specs->SpecsCount > 0 ? specs->Specs[0].ColumnIndex : -1;
+		m_request.descending = specs->SpecsCount > 0 && specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+		specs->SpecsDirty = false;
+		startView();
+	}
+
+	const size_t first = firstDataRow();
+	ImGuiListClipper clipper;
+	clipper.Begin(int(visibleRowCount()));
+	while (clipper.Step()) {
+		for (int visible = clipper.DisplayStart; visible < clipper.DisplayEnd; visible++) {
+			const size_t row = m_hasView ? m_view[size_t(visible)] : first + size_t(visible);
+			ImGui::TableNextRow();
+			m_index.cells(row, m_cells);
+			for (int column = 0; column < columns && size_t(column) < m_cells.size(); column++) {
+				// Columns scrolled out of view are skipped before their cell is formatted.
+				if (!ImGui::TableSetColumnIndex(column)) {
+					continue;
+				}
+				auto text = DelimitedIndex::Unquote(m_cells[size_t(column)], m_scratch);
+				const auto lineBreak = text.find_first_of("\r\n");
+				ImGui::TextUnformatted(text.data(), text.data() + std::min(lineBreak, text.size()));
+				if (lineBreak != std::string_view::npos) {
+					ImGui::SameLine(0.0f, 0.0f);
+					ImGui::TextDisabled("...");
+				}
+			}
+		}
+	}
+	clipper.End();
+	ImGui::EndTable();
+}
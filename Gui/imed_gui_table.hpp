@@ -0,0 +1,84 @@
+#pragma once
+
+#include "imed_gui_layout.hpp"
+#include "imed_gui_mappedfile.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <future>
+#include <atomic>
+#include <cstdint>
+
+// Row offsets of a delimited (CSV/TSV) text, RFC 4180 quoting included: newlines inside quoted fields do not end
+// a row. Cells are split on demand, only rows that are drawn, sorted or filtered are ever parsed.
+class DelimitedIndex {
+	std::string_view m_text;
+	std::vector<uint64_t> m_rowStart;   // One per row plus the end of the text
+	size_t m_columnCount = 0;
+	char m_delimiter = ',';
+public:
+	[[nodiscard]] inline size_t rowCount() const { return m_rowStart.empty() ? 0 : m_rowStart.size() - 1; }
+	[[nodiscard]] inline size_t columnCount() const { return m_columnCount; }
+	[[nodiscard]] inline char delimiter() const { return m_delimiter; }
+	// Without the line break.
+	[[nodiscard]] std::string_view row(size_t row) const;
+	void cells(size_t row, std::vector<std::string_view>& cells) const;
+
+	// Rows are found in two parallel passes over equal chunks: the quotes of every chunk are counted, which tells
+	// each chunk whether it starts inside a quoted field, then every chunk collects its line breaks outside quotes.
+	static DelimitedIndex Build(std::string_view text, char delimiter, size_t threadCount = 0);
+	// Raw cells of a row, still quoted.
+	static void SplitRow(std::string_view row, char delimiter, std::vector<std::string_view>& cells);
+	// Cell contents without the surrounding quotes, escaped quotes are collapsed into scratch if there are any.
+	static std::string_view Unquote(std::string_view cell, std::string& scratch);
+};
+
+// Virtual grid over a delimited file. Only the visible cells are split and formatted each frame,
+// sorting and filtering build a row order on a background thread while the previous one stays on screen.
+class DelimitedTable : public IWidget {
+	struct ViewRequest {
+		int sortColumn = -1;
+		bool descending = false;
+		std::string filter;     // Lowered, matched against the whole row
+	};
+
+	MappedFile m_file;
+	DelimitedIndex m_index;
+	std::future<DelimitedIndex> m_indexing;
+	std::vector<uint32_t> m_view;       // Data rows in display order when sorted or filtered
+	bool m_hasView = false;
+	ViewRequest m_request;
+	std::future<std::vector<uint32_t>> m_viewing;
+	std::atomic<bool> m_cancelView = false;
+	char m_filter[256] = { };
+
+	std::vector<std::string> m_columnNames;
+	std::vector<std::string_view> m_cells;
+	std::string m_scratch;
+
+	[[nodiscard]] inline size_t firstDataRow() const { return hasHeader && m_index.rowCount() != 0 ? 1 : 0; }
+	[[nodiscard]] size_t visibleRowCount() const;
+	void refreshColumnNames();
+	void startView();
+	void cancelView();
+	std::vector<uint32_t> buildView(const ViewRequest& request) const;
+public:
+	bool hasHeader = true;
+
+	DelimitedTable() = default;
+	// A delimiter of 0 picks tabs for .tsv/.tab files and commas otherwise.
+	explicit DelimitedTable(const std::filesystem::path& path, char delimiter = 0) { open(path, delimiter); }
+	DelimitedTable(const DelimitedTable&) = delete;
+	DelimitedTable& operator= (const DelimitedTable&) = delete;
+	~DelimitedTable();
+
+	bool open(const std::filesystem::path& path, char delimiter = 0);
+
+	[[nodiscard]] inline bool isIndexing() const { return m_indexing.valid(); }
+	[[nodiscard]] inline const DelimitedIndex& index() const { return m_index; }
+
+	[[nodiscard]] bool isDirty() const override;
+	void show() override;
+};
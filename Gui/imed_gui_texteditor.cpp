@@ -11,5 +11,7 @@ TextEditor::TextEditor(const std::string& initialText, size_t bufferCapacity) :
 }
 
 void TextEditor::show() {
-	ImGui::InputTextMultiline("##text", m_buffer.data(), m_buffer.capacity());
+	if (ImGui::InputTextMultiline("##text", m_buffer.data(), m_buffer.capacity())) {
+		markDirty();
+	}
 }
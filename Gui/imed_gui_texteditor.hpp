@@ -8,7 +8,7 @@ public:
 	explicit TextEditor(size_t bufferCapacity);
 	TextEditor(const std::string& initialText, size_t bufferCapacity);
 
-	inline std::string& buffer() { return m_buffer; }
+	inline std::string& buffer() { markDirty(); return m_buffer; }
 	inline const std::string& buffer() const { return m_buffer; }
 
 	void show() override;
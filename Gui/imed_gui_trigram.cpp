@@ -0,0 +1,567 @@
+#include "imed_gui_trigram.hpp"
+#include "imed_gui_search.hpp"
+#include "imed_gui_common.hpp"
+#include "imed_gui_logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <thread>
+#include <utility>
+
+static constexpr char IndexMagic[8] = { 'I', 'M', 'E', 'D', 'T', 'R', 'I', 'G' };
+
+static constexpr auto LowerAscii = [] {
+	std::array<uint8_t, 256> table { };
+	for (int c = 0; c < 256; c++) {
+		table[c] = uint8_t((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+	}
+	return table;
+}();
+
+static inline size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void WriteVarint(std::vector<uint8_t>& out, uint32_t value) {
+	while (value >= 0x80) {
+		out.push_back(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+static uint32_t ReadVarint(const uint8_t*& data) {
+	uint32_t value = 0;
+	for (int shift = 0;; shift += 7) {
+		const uint8_t byte = *data++;
+		value |= uint32_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+}
+
+// Walks a posting list once without trusting it, every file id has to be in range and increasing.
+static bool ValidPostings(const uint8_t* data, const uint8_t* end, uint32_t count, uint32_t fileCount) {
+	uint64_t file = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint64_t delta = 0;
+		for (int shift = 0;; shift += 7) {
+			if (data == end || shift > 28) {
+				return false;
+			}
+			const uint8_t byte = *data++;
+			delta |= uint64_t(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				break;
+			}
+		}
+		if ((i != 0 && delta == 0) || (file += delta) >= fileCount) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Written without adding to the offset, which a corrupt header could wrap around.
+static bool FitsIn(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size) {
+	return offset <= size && count <= (size - offset) / elementSize;
+}
+
+template<typename T>
+static void Append(std::vector<uint8_t>& out, const T& value) {
+	const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Stable LSD radix sort on the 24-bit trigram in the upper half, two passes of 12 bits. Each worker appends its
+// files in increasing order, so keeping that order yields pairs sorted by (trigram, file) without comparing.
+static void SortByTrigram(std::vector<uint64_t>& pairs) {
+	std::vector<uint64_t> scratch(pairs.size());
+	std::vector<size_t> counts(1 << 12);
+	for (int shift = 32; shift < 56; shift += 12) {
+		std::fill(counts.begin(), counts.end(), 0);
+		for (auto pair : pairs) {
+			counts[(pair >> shift) & 0xFFF]++;
+		}
+		size_t offset = 0;
+		for (auto& count : counts) {
+			offset += std::exchange(count, offset);
+		}
+		for (auto pair : pairs) {
+			scratch[counts[(pair >> shift) & 0xFFF]++] = pair;
+		}
+		pairs.swap(scratch);
+	}
+}
+
+// Unique case-folded trigrams in order of first appearance.
+static void CollectTrigrams(std::string_view text, std::vector<uint32_t>& trigrams) {
+	// One bit per possible trigram, cleared again through the list so each call only touches what it set.
+	thread_local std::vector<uint64_t> seen(size_t(1) << 18);
+	trigrams.clear();
+	if (text.size() < 3) {
+		return;
+	}
+	// Written unconditionally and only kept when new, repeated trigrams are too common to predict the branch.
+	trigrams.resize(text.size());
+	const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+	size_t count = 0;
+	uint32_t trigram = (uint32_t(LowerAscii[bytes[0]]) << 8) | LowerAscii[bytes[1]];
+	for (size_t i = 2; i < text.size(); i++) {
+		trigram = ((trigram << 8) | LowerAscii[bytes[i]]) & 0xFFFFFF;
+		auto& word = seen[trigram >> 6];
+		const uint64_t bit = 1ull << (trigram & 63);
+		trigrams[count] = trigram;
+		count += (word & bit) == 0;
+		word |= bit;
+	}
+	trigrams.resize(count);
+	for (auto t : trigrams) {
+		seen[t >> 6] = 0;
+	}
+}
+
+void TrigramIndex::Tokenize(std::string_view text, std::vector<uint32_t>& trigrams) {
+	CollectTrigrams(text, trigrams);
+	std::sort(trigrams.begin(), trigrams.end());
+}
+
+TrigramIndex::TrigramIndex(TrigramIndex&& index) noexcept {
+	*this = std::move(index);
+}
+
+TrigramIndex& TrigramIndex::operator= (TrigramIndex&& index) noexcept {
+	if (this != &index) {
+		m_root = std::move(index.m_root);
+		m_mapped = std::move(index.m_mapped);
+		m_built = std::move(index.m_built);
+		m_data = index.m_data;
+		m_size = index.m_size;
+		m_stale = std::move(index.m_stale);
+		m_unindexed = std::move(index.m_unindexed);
+		m_overlay = std::move(index.m_overlay);
+		m_lookup = std::move(index.m_lookup);
+		m_maxFileSize = index.m_maxFileSize;
+		index.m_data = nullptr;
+		index.m_size = 0;
+	}
+	return *this;
+}
+
+bool TrigramIndex::attach(const uint8_t* data, size_t size) {
+	m_data = nullptr;
+	m_size = 0;
+	if (data == nullptr || size < sizeof(Header)) {
+		return false;
+	}
+	const auto& h = *reinterpret_cast<const Header*>(data);
+	if (std::memcmp(h.magic, IndexMagic, sizeof(IndexMagic)) != 0 || h.version != Version || h.size != size ||
+		h.pathsOffset > size || !FitsIn(h.filesOffset, h.fileCount, sizeof(FileRecord), size) ||
+		!FitsIn(h.trigramsOffset, h.trigramCount, sizeof(TrigramRecord), size) || h.postingsOffset > size ||
+		sizeof(Header) + h.rootLength > h.pathsOffset || h.pathsOffset > h.filesOffset ||
+		h.filesOffset % alignof(FileRecord) != 0 || h.trigramsOffset % alignof(TrigramRecord) != 0) {
+		return false;
+	}
+	// Everything below is read without further checks, a corrupt file must not get past here.
+	const auto* fileRecords = reinterpret_cast<const FileRecord*>(data + h.filesOffset);
+	for (uint32_t file = 0; file < h.fileCount; file++) {
+		if (uint64_t(fileRecords[file].pathOffset) + fileRecords[file].pathLength > h.filesOffset - h.pathsOffset) {
+			return false;
+		}
+	}
+	const auto* trigramRecords = reinterpret_cast<const TrigramRecord*>(data + h.trigramsOffset);
+	const uint8_t* postingsEnd = data + size;
+	for (uint32_t i = 0; i < h.trigramCount; i++) {
+		const auto& record = trigramRecords[i];
+		if ((i != 0 && record.trigram <= trigramRecords[i - 1].trigram) || record.postingsOffset >= size - h.postingsOffset ||
+			!ValidPostings(data + h.postingsOffset + record.postingsOffset, postingsEnd, record.fileCount, h.fileCount)) {
+			return false;
+		}
+	}
+
+	m_data = data;
+	m_size = size;
+	m_root = std::string(reinterpret_cast<const char*>(data + sizeof(Header)), h.rootLength);
+	m_stale.assign(h.fileCount, 0);
+	m_unindexed.clear();
+	for (FileId file = 0; file < h.fileCount; file++) {
+		if (files()[file].flags & FileFlags_Unindexed) m_unindexed.push_back(file);
+	}
+	m_overlay.clear();
+	m_lookup.clear();
+	return true;
+}
+
+bool TrigramIndex::open(const std::filesystem::path& indexPath, const ScanOptions& options) {
+	MappedFile mapped;
+	if (!mapped.open(indexPath) || !attach(mapped.data(), mapped.size())) {
+		return false;
+	}
+	if (!refresh(options)) {
+		m_data = nullptr;
+		m_size = 0;
+		return false;
+	}
+	m_mapped = std::move(mapped);
+	m_built.clear();
+	return true;
+}
+
+bool TrigramIndex::refresh(const ScanOptions& options) {
+	auto scanOptions = options;
+	scanOptions.statFiles = true;
+	auto entries = WorkspaceScanner::Scan(m_root, scanOptions);
+	auto paths = WorkspaceScanner::ResolvePaths(entries);
+
+	// Files created, modified or deleted while nothing was watching.
+	std::vector<uint8_t> seen(fileCount(), 0);
+	std::vector<std::string> changed;
+	size_t deleted = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].isDirectory()) {
+			continue;
+		}
+		if (auto file = lookup(paths[i]); file != UINT32_MAX) {
+			seen[file] = 1;
+			if (files()[file].size == entries[i].size && files()[file].mtime == entries[i].mtime) {
+				continue;
+			}
+			m_stale[file] = 1;
+		}
+		changed.push_back(std::move(paths[i]));
+	}
+	for (FileId file = 0; file < fileCount(); file++) {
+		if (seen[file] == 0) {
+			m_stale[file] = 1;
+			deleted++;
+		}
+	}
+
+	// The overlay is searched linearly and tokenized one file at a time, past this a rebuild is cheaper.
+	if (changed.size() + deleted > fileCount() / 4 + 64) {
+		ImEdLogFormat(DebugMessageType::Info, "Trigram index of \"{}\" is outdated, {} files changed", m_root.string(),
+			changed.size() + deleted);
+		return false;
+	}
+	for (const auto& path : changed) {
+		reindex(path);
+	}
+	return true;
+}
+
+bool TrigramIndex::save(const std::filesystem::path& indexPath) const {
+	if (!isOpen()) {
+		return false;
+	}
+	// Written next to the target and renamed over it, a reader never maps a half written index.
+	auto temporary = indexPath;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		if (!out.write(reinterpret_cast<const char*>(m_data), std::streamsize(m_size))) {
+			ImEdLogFormat(DebugMessageType::Warning, "Failed to write trigram index \"{}\"", temporary.string());
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(temporary, indexPath, ec);
+	return !ec;
+}
+
+std::string_view TrigramIndex::path(FileId file) const {
+	const auto& record = files()[file];
+	return { reinterpret_cast<const char*>(m_data + header().pathsOffset + record.pathOffset), record.pathLength };
+}
+
+TrigramIndex::FileId TrigramIndex::lookup(std::string_view relativePath) const {
+	if (m_lookup.empty() && fileCount() != 0) {
+		m_lookup.reserve(fileCount());
+		for (FileId file = 0; file < fileCount(); file++) {
+			m_lookup.emplace(path(file), file);
+		}
+	}
+	auto it = m_lookup.find(relativePath);
+	return it == m_lookup.end() ? UINT32_MAX : it->second;
+}
+
+std::vector<TrigramIndex::FileId> TrigramIndex::postings(uint32_t trigram) const {
+	const auto* begin = trigrams();
+	const auto* end = begin + header().trigramCount;
+	const auto* it = std::lower_bound(begin, end, trigram, [](const TrigramRecord& record, uint32_t trigram) {
+		return record.trigram < trigram;
+	});
+	if (it == end || it->trigram != trigram) {
+		return { };
+	}
+
+	std::vector<FileId> result(it->fileCount);
+	const uint8_t* data = m_data + header().postingsOffset + it->postingsOffset;
+	FileId file = 0;
+	for (auto& id : result) {
+		file += ReadVarint(data);
+		id = file;
+	}
+	return result;
+}
+
+std::vector<std::string> TrigramIndex::candidates(std::string_view query, bool regex) const {
+	std::string literal = regex ? WorkspaceSearch::RequiredLiteral(query) : std::string(query);
+	std::vector<uint32_t> wanted;
+	Tokenize(literal, wanted);
+
+	// Intersect starting from the rarest trigram, the candidate set only shrinks from there.
+	std::vector<FileId> matched;
+	bool everything = wanted.empty();
+	if (!everything) {
+		std::vector<std::pair<uint32_t, uint32_t>> order;
+		const auto* begin = trigrams();
+		const auto* end = begin + header().trigramCount;
+		for (auto trigram : wanted) {
+			const auto* it = std::lower_bound(begin, end, trigram, [](const TrigramRecord& record, uint32_t trigram) {
+				return record.trigram < trigram;
+			});
+			order.emplace_back(it == end || it->trigram != trigram ? 0 : it->fileCount, trigram);
+		}
+		std::sort(order.begin(), order.end());
+
+		matched = postings(order.front().second);
+		std::vector<FileId> next, merged;
+		for (size_t i = 1; i < order.size() && !matched.empty(); i++) {
+			next = postings(order[i].second);
+			merged.clear();
+			std::set_intersection(matched.begin(), matched.end(), next.begin(), next.end(), std::back_inserter(merged));
+			matched.swap(merged);
+		}
+	}
+
+	std::vector<std::string> result;
+	auto addBase = [&](FileId file) {
+		if (m_stale[file] == 0 && (files()[file].flags & FileFlags_Binary) == 0) {
+			result.emplace_back(path(file));
+		}
+	};
+	if (everything) {
+		for (FileId file = 0; file < fileCount(); file++) addBase(file);
+	} else {
+		for (auto file : matched) addBase(file);
+		for (auto file : m_unindexed) addBase(file);
+	}
+
+	for (const auto& [overlayPath, overlay] : m_overlay) {
+		bool candidate = everything || overlay.unindexed;
+		if (!candidate && overlay.base != UINT32_MAX) {
+			candidate = std::binary_search(matched.begin(), matched.end(), overlay.base) ||
+				(files()[overlay.base].flags & FileFlags_Unindexed) != 0;
+		} else if (!candidate) {
+			candidate = std::includes(overlay.trigrams.begin(), overlay.trigrams.end(), wanted.begin(), wanted.end());
+		}
+		if (candidate) {
+			result.push_back(overlayPath);
+		}
+	}
+	return result;
+}
+
+void TrigramIndex::reindex(const std::string& relativePath) {
+	MappedFile mapped;
+	if (!mapped.open(m_root / relativePath) || WorkspaceSearch::IsBinary(mapped.data(), mapped.size())) {
+		m_overlay.erase(relativePath);
+		return;
+	}
+	OverlayFile overlay;
+	if (mapped.size() > m_maxFileSize) {
+		overlay.unindexed = true;
+	} else {
+		Tokenize(mapped.view(), overlay.trigrams);
+	}
+	m_overlay[relativePath] = std::move(overlay);
+}
+
+void TrigramIndex::markStale(std::string_view relativePath, bool isDirectory, std::string_view movedTo) {
+	auto move = [&](std::string_view from, std::string to) {
+		if (auto file = lookup(from); file != UINT32_MAX && m_stale[file] == 0) {
+			m_stale[file] = 1;
+			if (!to.empty()) m_overlay[std::move(to)] = OverlayFile { file, false, { } };
+		}
+		if (auto it = m_overlay.find(std::string(from)); it != m_overlay.end()) {
+			auto overlay = std::move(it->second);
+			m_overlay.erase(it);
+			if (!to.empty()) m_overlay[std::move(to)] = std::move(overlay);
+		}
+	};
+
+	if (!isDirectory) {
+		move(relativePath, std::string(movedTo));
+		return;
+	}
+
+	std::vector<std::string> affected;
+	auto underDirectory = [&](std::string_view path) {
+		return path.size() > relativePath.size() && path[relativePath.size()] == '/' && path.starts_with(relativePath);
+	};
+	for (FileId file = 0; file < fileCount(); file++) {
+		if (m_stale[file] == 0 && underDirectory(path(file))) affected.emplace_back(path(file));
+	}
+	for (const auto& [path, overlay] : m_overlay) {
+		if (underDirectory(path)) affected.push_back(path);
+	}
+	for (const auto& path : affected) {
+		move(path, movedTo.empty() ? std::string { } : std::string(movedTo).append(path.substr(relativePath.size())));
+	}
+}
+
+void TrigramIndex::applyEvents(const std::vector<FileEvent>& events) {
+	if (!isOpen()) {
+		return;
+	}
+	for (const auto& event : events) {
+		switch (event.type) {
+			case FileEventType::Created:
+			case FileEventType::Modified:
+				if (!event.isDirectory) {
+					if (auto file = lookup(event.path); file != UINT32_MAX) m_stale[file] = 1;
+					reindex(event.path);
+				}
+				break;
+			case FileEventType::Deleted:
+				markStale(event.path, event.isDirectory, { });
+				break;
+			case FileEventType::Renamed:
+				markStale(event.oldPath, event.isDirectory, event.path);
+				break;
+			case FileEventType::Overflow:
+				// Unknown changes, every file has to be verified until the index is rebuilt.
+				for (FileId file = 0; file < fileCount(); file++) {
+					if (m_stale[file] == 0) {
+						m_stale[file] = 1;
+						m_overlay[std::string(path(file))] = OverlayFile { UINT32_MAX, true, { } };
+					}
+				}
+				break;
+		}
+	}
+}
+
+TrigramIndex TrigramIndex::Build(const std::filesystem::path& root, const TrigramOptions& options) {
+	auto scanOptions = options.scan;
+	scanOptions.statFiles = true;
+	auto entries = WorkspaceScanner::Scan(root, scanOptions);
+	auto paths = WorkspaceScanner::ResolvePaths(entries);
+
+	std::vector<size_t> fileEntries;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (!entries[i].isDirectory()) {
+			fileEntries.push_back(i);
+		}
+	}
+
+	// Every worker tokenizes whole files and collects (trigram, file) pairs, sorted per worker and merged afterwards.
+	size_t threads = options.threadCount != 0 ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+	threads = std::max<size_t>(1, std::min(threads, fileEntries.size()));
+	std::vector<std::vector<uint64_t>> runs(threads);
+	std::vector<uint32_t> flags(fileEntries.size(), FileFlags_None);
+	std::atomic<size_t> next = 0;
+	auto work = [&](size_t worker) {
+		std::vector<uint32_t> trigrams;
+		MappedFile mapped;
+		auto& pairs = runs[worker];
+		for (size_t file; (file = next.fetch_add(1, std::memory_order_relaxed)) < fileEntries.size();) {
+			if (!mapped.open(root / paths[fileEntries[file]])) {
+				flags[file] = FileFlags_Unindexed;
+				continue;
+			}
+			if (WorkspaceSearch::IsBinary(mapped.data(), mapped.size())) {
+				flags[file] = FileFlags_Binary;
+			} else if (mapped.size() > options.maxFileSize) {
+				flags[file] = FileFlags_Unindexed;
+			} else {
+				// Unsorted is fine, the pairs are radix sorted once per worker.
+				CollectTrigrams(mapped.view(), trigrams);
+				for (auto trigram : trigrams) {
+					pairs.push_back((uint64_t(trigram) << 32) | file);
+				}
+			}
+			mapped.close();
+		}
+		SortByTrigram(pairs);
+	};
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++) {
+		workers.emplace_back(work, t);
+	}
+	work(0);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	// Layout: header, root, paths, file table, trigram table, postings.
+	const auto rootString = root.string();
+	std::vector<uint8_t> pathBytes;
+	std::vector<FileRecord> fileRecords;
+	fileRecords.reserve(fileEntries.size());
+	for (size_t file = 0; file < fileEntries.size(); file++) {
+		const auto& entry = entries[fileEntries[file]];
+		const auto& path = paths[fileEntries[file]];
+		fileRecords.push_back({ uint32_t(pathBytes.size()), uint32_t(path.size()), flags[file], 0, entry.size, entry.mtime });
+		pathBytes.insert(pathBytes.end(), path.begin(), path.end());
+	}
+
+	std::vector<TrigramRecord> trigramRecords;
+	std::vector<uint8_t> postings;
+	using Cursor = std::pair<uint64_t, size_t>;     // pair, run
+	std::priority_queue<Cursor, std::vector<Cursor>, std::greater<>> heads;
+	std::vector<size_t> positions(threads, 0);
+	for (size_t run = 0; run < threads; run++) {
+		if (!runs[run].empty()) heads.emplace(runs[run][0], run);
+	}
+	uint32_t lastFile = 0;
+	while (!heads.empty()) {
+		auto [pair, run] = heads.top();
+		heads.pop();
+		if (++positions[run] < runs[run].size()) {
+			heads.emplace(runs[run][positions[run]], run);
+		}
+
+		const auto trigram = uint32_t(pair >> 32), file = uint32_t(pair);
+		if (trigramRecords.empty() || trigramRecords.back().trigram != trigram) {
+			trigramRecords.push_back({ trigram, 0, postings.size() });
+			lastFile = 0;
+		}
+		WriteVarint(postings, file - lastFile);
+		lastFile = file;
+		trigramRecords.back().fileCount++;
+	}
+	runs.clear();
+
+	Header h { };
+	std::memcpy(h.magic, IndexMagic, sizeof(IndexMagic));
+	h.version = Version;
+	h.fileCount = uint32_t(fileRecords.size());
+	h.trigramCount = uint32_t(trigramRecords.size());
+	h.rootLength = uint32_t(rootString.size());
+	h.pathsOffset = sizeof(Header) + rootString.size();
+	h.filesOffset = AlignUp(h.pathsOffset + pathBytes.size(), 8);
+	h.trigramsOffset = h.filesOffset + fileRecords.size() * sizeof(FileRecord);
+	h.postingsOffset = h.trigramsOffset + trigramRecords.size() * sizeof(TrigramRecord);
+	h.size = h.postingsOffset + postings.size();
+
+	TrigramIndex index;
+	auto& blob = index.m_built;
+	blob.reserve(h.size);
+	Append(blob, h);
+	blob.insert(blob.end(), rootString.begin(), rootString.end());
+	blob.insert(blob.end(), pathBytes.begin(), pathBytes.end());
+	blob.resize(h.filesOffset, 0);
+	for (const auto& record : fileRecords) Append(blob, record);
+	for (const auto& record : trigramRecords) Append(blob, record);
+	blob.insert(blob.end(), postings.begin(), postings.end());
+
+	index.m_maxFileSize = options.maxFileSize;
+	index.attach(blob.data(), blob.size());
+	return index;
+}
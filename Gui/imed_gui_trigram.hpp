@@ -0,0 +1,116 @@
+#pragma once
+
+#include "imed_gui_scanner.hpp"
+#include "imed_gui_filewatcher.hpp"
+#include "imed_gui_mappedfile.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+struct TrigramOptions {
+	size_t threadCount = 0;                 // 0 = std::thread::hardware_concurrency()
+	size_t maxFileSize = 16 * 1024 * 1024;  // Larger files are not tokenized and therefore always searched
+	ScanOptions scan;
+};
+
+// Inverted index from case-folded byte trigrams to the files containing them. The index is a single
+// position-independent blob (header, file table, sorted trigram table, delta-varint posting lists) that is
+// memory mapped as is. Changes reported by the file watcher are kept in a small overlay on top of it.
+class TrigramIndex {
+public:
+	using FileId = uint32_t;
+	static constexpr uint32_t Version = 1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t fileCount;
+		uint32_t trigramCount;
+		uint32_t rootLength;
+		uint64_t pathsOffset;
+		uint64_t filesOffset;
+		uint64_t trigramsOffset;
+		uint64_t postingsOffset;
+		uint64_t size;
+	};
+	enum FileFlags : uint32_t {
+		FileFlags_None      = 0,
+		FileFlags_Unindexed = 1 << 0,   // Too large to tokenize, a candidate for every query
+		FileFlags_Binary    = 1 << 1,   // Never a candidate
+	};
+	struct FileRecord {
+		uint32_t pathOffset;
+		uint32_t pathLength;
+		uint32_t flags;
+		uint32_t reserved;
+		uint64_t size;
+		int64_t mtime;
+	};
+	struct TrigramRecord {
+		uint32_t trigram;
+		uint32_t fileCount;
+		uint64_t postingsOffset;
+	};
+private:
+	// A file whose content changed since the index was written, or a base file that only moved.
+	struct OverlayFile {
+		FileId base = UINT32_MAX;
+		bool unindexed = false;
+		std::vector<uint32_t> trigrams;     // Sorted, used when base is not set
+	};
+
+	std::filesystem::path m_root;
+	MappedFile m_mapped;
+	std::vector<uint8_t> m_built;
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+
+	std::vector<uint8_t> m_stale;
+	std::vector<FileId> m_unindexed;
+	std::unordered_map<std::string, OverlayFile> m_overlay;
+	mutable std::unordered_map<std::string_view, FileId> m_lookup;
+	size_t m_maxFileSize = TrigramOptions { }.maxFileSize;
+
+	bool attach(const uint8_t* data, size_t size);
+	bool refresh(const ScanOptions& options);
+	[[nodiscard]] const Header& header() const { return *reinterpret_cast<const Header*>(m_data); }
+	[[nodiscard]] const FileRecord* files() const { return reinterpret_cast<const FileRecord*>(m_data + header().filesOffset); }
+	[[nodiscard]] const TrigramRecord* trigrams() const { return reinterpret_cast<const TrigramRecord*>(m_data + header().trigramsOffset); }
+	[[nodiscard]] FileId lookup(std::string_view relativePath) const;
+	[[nodiscard]] std::vector<FileId> postings(uint32_t trigram) const;
+	void markStale(std::string_view relativePath, bool isDirectory, std::string_view movedTo);
+	void reindex(const std::string& relativePath);
+public:
+	TrigramIndex() = default;
+	TrigramIndex(TrigramIndex&& index) noexcept;
+	TrigramIndex& operator= (TrigramIndex&& index) noexcept;
+
+	// Maps an index written by save(), fails on a missing, corrupt or outdated file. Files changed on disk since
+	// it was written are re-tokenized into the overlay, when too many did the caller is better off rebuilding.
+	bool open(const std::filesystem::path& indexPath, const ScanOptions& options = { });
+	bool save(const std::filesystem::path& indexPath) const;
+
+	[[nodiscard]] inline bool isOpen() const { return m_data != nullptr; }
+	[[nodiscard]] inline const std::filesystem::path& root() const { return m_root; }
+	[[nodiscard]] inline size_t fileCount() const { return isOpen() ? header().fileCount : 0; }
+	[[nodiscard]] inline size_t trigramCount() const { return isOpen() ? header().trigramCount : 0; }
+	[[nodiscard]] inline size_t overlaySize() const { return m_overlay.size(); }
+	[[nodiscard]] inline size_t sizeInBytes() const { return m_size; }
+
+	[[nodiscard]] std::string_view path(FileId file) const;
+	[[nodiscard]] inline const FileRecord& file(FileId file) const { return files()[file]; }
+
+	// Keeps the index current between rebuilds, changed files are re-tokenized into the overlay.
+	void applyEvents(const std::vector<FileEvent>& events);
+
+	// Root-relative paths of every file that may contain a match, a superset of the real hits.
+	[[nodiscard]] std::vector<std::string> candidates(std::string_view query, bool regex) const;
+
+	static TrigramIndex Build(const std::filesystem::path& root, const TrigramOptions& options = { });
+	// Unique case-folded trigrams of text, sorted.
+	static void Tokenize(std::string_view text, std::vector<uint32_t>& trigrams);
+};
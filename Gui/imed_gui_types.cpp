@@ -1,3 +1,4 @@
+#define STB_IMAGE_IMPLEMENTATION
 #include "imed_gui_types.hpp"
 
 #include <vector>
@@ -434,28 +435,75 @@ void Style::setCurrent() const {
 	ImGui::GetStyle() = toImGuiStyle();
 }
 
-Image::Image(const std::filesystem::path& path): m_bCopy(false) {
+static GLenum ChannelsToFormat(int channels) {
+	switch (channels) {
+		case 1: return GL_RED;
+		case 2: return GL_RG;
+		case 3: return GL_RGB;
+		default: return GL_RGBA;
+	}
+}
+
+Image::Image(const std::filesystem::path& path): m_id(0), m_bCopy(false) {
 	int w, h, c;
 	auto data = stbi_load(path.string().c_str(), &w, &h, &c, STBI_default);
+	if (data == nullptr) {
+		ImEdLog("Failed to load image \"" + path.string() + "\": " + stbi_failure_reason(), DebugMessageType::Warning);
+		return;
+	}
 
+	*this = Image(data, w, h, c);
+	stbi_image_free(data);
+}
+Image::Image(const uint8_t* pixels, int width, int height, int channels): m_id(0), m_bCopy(false) {
 	glGenTextures(1, &m_id);
 	glBindTexture(GL_TEXTURE_2D, m_id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	GLenum format;
-	switch (c) {
-		case 1: format = GL_R;
-		case 2: format = GL_RG;
-		case 3: format = GL_RGB;
-		default: format = GL_RGBA;
-	}
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GLint(format), w, h, 0, format, GL_UNSIGNED_BYTE, data);
+	GLenum format = ChannelsToFormat(channels);
+	glTexImage2D(GL_TEXTURE_2D, 0, GLint(format), width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
 	glBindTexture(GL_TEXTURE_2D, 0);
-
-	stbi_image_free(data);
 }
 Image::~Image() {
+	release();
+}
+
+void Image::release() {
 	if (m_id != 0 && !m_bCopy) {
 		glDeleteTextures(1, &m_id);
 	}
-}
\ No newline at end of file
+	m_id = 0;
+}
+
+Image& Image::operator= (const Image& image) {
+	if (this != &image) {
+		release();
+		m_id = image.m_id;
+		m_bCopy = true;
+		uv0 = image.uv0;
+		uv1 = image.uv1;
+	}
+	return *this;
+}
+Image& Image::operator= (Image&& image) noexcept {
+	if (this != &image) {
+		release();
+		m_id = image.m_id;
+		m_bCopy = image.m_bCopy;
+		uv0 = image.uv0;
+		uv1 = image.uv1;
+		image.m_id = 0;
+	}
+	return *this;
+}
+
+Image Image::FromTexture(GLuint id, const Vec2& uv0, const Vec2& uv1) {
+	Image image;
+	image.m_id = id;
+	image.m_bCopy = true;
+	image.uv0 = uv0;
+	image.uv1 = uv1;
+	return image;
+}
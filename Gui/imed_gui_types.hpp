@@ -243,12 +243,26 @@ struct CodeStyle {
 class Image {
 	GLuint m_id;
 	bool m_bCopy;
+
+	void release();
 public:
 	Image(): m_id(0), m_bCopy(false) { }
 	explicit Image(const std::filesystem::path& path);
-	Image(const Image& image): m_id(image.m_id), m_bCopy(true) { }
+	Image(const uint8_t* pixels, int width, int height, int channels);
+	Image(const Image& image): m_id(image.m_id), m_bCopy(true), uv0(image.uv0), uv1(image.uv1) { }
+	Image(Image&& image) noexcept: m_id(image.m_id), m_bCopy(image.m_bCopy), uv0(image.uv0), uv1(image.uv1) { image.m_id = 0; }
 	~Image();
 
+	Image& operator= (const Image& image);
+	Image& operator= (Image&& image) noexcept;
+
+	// Sub-rectangle of the texture this image covers, atlas images only span their own region.
+	Vec2 uv0 = { 0, 0 };
+	Vec2 uv1 = { 1, 1 };
+
 	[[nodiscard]] inline constexpr GLuint id() const { return m_id; }
 	[[nodiscard]] inline ImTextureID asImTexture() const { return (ImTextureID)m_id; }
+
+	// Non-owning view of an existing texture region.
+	static Image FromTexture(GLuint id, const Vec2& uv0 = { 0, 0 }, const Vec2& uv1 = { 1, 1 });
 };
\ No newline at end of file
@@ -0,0 +1,142 @@
+// Decodes every PNG in a directory at build time and writes them as one RGBA8 blob into a C++ source file,
+// so the editor can upload its icons at startup without touching the filesystem or running a PNG decoder.
+//
+// usage: imed-assetpack <asset dir> <output.cpp> [--max-size N]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct Asset {
+	std::string name;
+	int width, height;
+	std::vector<uint8_t> pixels;
+	size_t offset;
+};
+
+// Area-averaged downscale with premultiplied alpha, so transparent edges do not bleed dark fringes.
+static std::vector<uint8_t> Downscale(const uint8_t* src, int srcWidth, int srcHeight, int dstWidth, int dstHeight) {
+	std::vector<uint8_t> dst(size_t(dstWidth) * size_t(dstHeight) * 4);
+	for (int y = 0; y < dstHeight; y++) {
+		const int y0 = y * srcHeight / dstHeight, y1 = std::max(y0 + 1, (y + 1) * srcHeight / dstHeight);
+		for (int x = 0; x < dstWidth; x++) {
+			const int x0 = x * srcWidth / dstWidth, x1 = std::max(x0 + 1, (x + 1) * srcWidth / dstWidth);
+			double r = 0, g = 0, b = 0, a = 0;
+			for (int sy = y0; sy < y1; sy++) {
+				for (int sx = x0; sx < x1; sx++) {
+					const uint8_t* p = src + (size_t(sy) * size_t(srcWidth) + size_t(sx)) * 4;
+					const double alpha = p[3] / 255.0;
+					r += p[0] * alpha; g += p[1] * alpha; b += p[2] * alpha; a += alpha;
+				}
+			}
+			uint8_t* out = dst.data() + (size_t(y) * size_t(dstWidth) + size_t(x)) * 4;
+			const double count = double((x1 - x0) * (y1 - y0));
+			out[0] = a > 0 ? uint8_t(std::clamp(r / a + 0.5, 0.0, 255.0)) : 0;
+			out[1] = a > 0 ? uint8_t(std::clamp(g / a + 0.5, 0.0, 255.0)) : 0;
+			out[2] = a > 0 ? uint8_t(std::clamp(b / a + 0.5, 0.0, 255.0)) : 0;
+			out[3] = uint8_t(std::clamp(a / count * 255.0 + 0.5, 0.0, 255.0));
+		}
+	}
+	return dst;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::fprintf(stderr, "usage: %s <asset dir> <output.cpp> [--max-size N]\n", argv[0]);
+		return 1;
+	}
+	const std::filesystem::path assetDir = argv[1];
+	const std::filesystem::path output = argv[2];
+	int maxSize = 0;
+	for (int i = 3; i < argc; i++) {
+		if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+			maxSize = std::atoi(argv[++i]);
+		} else {
+			std::fprintf(stderr, "Unknown argument \"%s\"\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<std::filesystem::path> files;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(assetDir, ec)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".png") {
+			files.push_back(entry.path());
+		}
+	}
+	if (ec) {
+		std::fprintf(stderr, "Failed to read \"%s\": %s\n", assetDir.string().c_str(), ec.message().c_str());
+		return 1;
+	}
+	// Sorted so the output is reproducible and lookups can binary search.
+	std::sort(files.begin(), files.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.filename().string() < rhs.filename().string();
+	});
+
+	std::vector<Asset> assets;
+	size_t blobSize = 0;
+	for (const auto& file : files) {
+		int w, h, c;
+		auto pixels = stbi_load(file.string().c_str(), &w, &h, &c, STBI_rgb_alpha);
+		if (pixels == nullptr) {
+			std::fprintf(stderr, "Failed to decode \"%s\": %s\n", file.string().c_str(), stbi_failure_reason());
+			return 1;
+		}
+
+		Asset asset { file.filename().string(), w, h, { }, 0 };
+		if (maxSize > 0 && (w > maxSize || h > maxSize)) {
+			const float scale = float(maxSize) / float(std::max(w, h));
+			asset.width = std::max(1, int(float(w) * scale + 0.5f));
+			asset.height = std::max(1, int(float(h) * scale + 0.5f));
+			asset.pixels = Downscale(pixels, w, h, asset.width, asset.height);
+		} else {
+			asset.pixels.assign(pixels, pixels + size_t(w) * size_t(h) * 4);
+		}
+		stbi_image_free(pixels);
+
+		asset.offset = blobSize;
+		blobSize += asset.pixels.size();
+		assets.push_back(std::move(asset));
+	}
+
+	std::ofstream out(output, std::ios::trunc);
+	if (!out) {
+		std::fprintf(stderr, "Failed to open \"%s\" for writing\n", output.string().c_str());
+		return 1;
+	}
+	out << "// Generated by imed-assetpack, do not edit.\n";
+	out << "#include \"imed_gui_assets.hpp\"\n\n";
+	out << "alignas(16) static const uint8_t AssetBlob[" << std::max<size_t>(blobSize, 1) << "] = {";
+	size_t column = 0;
+	char hex[8];
+	for (const auto& asset : assets) {
+		for (uint8_t byte : asset.pixels) {
+			out << ((column++ % 24 == 0) ? "\n\t" : "");
+			std::snprintf(hex, sizeof(hex), "0x%02x,", byte);
+			out << hex;
+		}
+	}
+	out << "\n};\n\n";
+	out << "static const EmbeddedAsset Assets[] = {\n";
+	for (const auto& asset : assets) {
+		out << "\t{ \"" << asset.name << "\", " << asset.width << ", " << asset.height << ", AssetBlob + " << asset.offset << " },\n";
+	}
+	if (assets.empty()) {
+		out << "\t{ \"\", 0, 0, AssetBlob },\n";
+	}
+	out << "};\n\n";
+	out << "std::span<const EmbeddedAsset> ImEdGui_EmbeddedAssets() {\n";
+	out << "\treturn { Assets, " << assets.size() << " };\n";
+	out << "}\n";
+
+	std::printf("Packed %zu assets (%zu bytes) into %s\n", assets.size(), blobSize, output.string().c_str());
+	return 0;
+}
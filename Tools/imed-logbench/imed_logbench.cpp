@@ -0,0 +1,126 @@
+// Measures what logging costs the calling threads: messages per second until everything is written, and the
+// latency distribution of a single call. The synchronous mode formats and writes on the caller like ImEdLogImpl
+// used to, for comparison. With --deferred the callers hand the format string and arguments to the logger instead
+// of formatting the message themselves, --binary writes the file in the format imed-logdecode reads.
+//
+// usage: imed-logbench [--threads N] [--messages N] [--file path] [--sync] [--block] [--deferred] [--binary]
+
+#include "imed_gui_logger.hpp"
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+	size_t threadCount = 4;
+	size_t messageCount = 1000000;
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "imed-logbench.log";
+	bool sync = false;
+	bool block = false;
+	bool deferred = false;
+	bool binary = false;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+			messageCount = std::strtoull(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+			path = argv[++i];
+		} else if (std::strcmp(argv[i], "--sync") == 0) {
+			sync = true;
+		} else if (std::strcmp(argv[i], "--block") == 0) {
+			block = true;
+		} else if (std::strcmp(argv[i], "--deferred") == 0) {
+			deferred = true;
+		} else if (std::strcmp(argv[i], "--binary") == 0) {
+			binary = true;
+		} else {
+			std::fprintf(stderr, "usage: %s [--threads N] [--messages N] [--file path] [--sync] [--block] [--deferred] [--binary]\n", argv[0]);
+			return 1;
+		}
+	}
+	std::error_code error;
+	std::filesystem::remove(path, error);
+
+	AsyncLogger logger;
+	logger.setStdout(false);
+	logger.overflow = block ? AsyncLogger::OverflowPolicy::Block : AsyncLogger::OverflowPolicy::Drop;
+	std::FILE* file = sync ? std::fopen(path.string().c_str(), "ab") : nullptr;
+	if (sync ? file == nullptr : !logger.setFile(path, 0, 0, binary ? AsyncLogger::FileFormat::Binary : AsyncLogger::FileFormat::Text)) {
+		std::fprintf(stderr, "Failed to open \"%s\"\n", path.string().c_str());
+		return 1;
+	}
+
+	// Every call is timed, the clock reads are part of what the callers see either way.
+	const size_t perThread = messageCount / threadCount;
+	std::vector<std::vector<uint32_t>> latencies(threadCount);
+	std::mutex fileMutex;
+	const auto start = Clock::now();
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < threadCount; t++) {
+		threads.emplace_back([&, t]() {
+			auto& samples = latencies[t];
+			samples.reserve(perThread);
+			for (size_t i = 0; i < perThread; i++) {
+				const auto before = Clock::now();
+				if (deferred && !sync) {
+					logger.logFormat(DebugMessageType::Info, DEBUG_INFO, "worker {} handled request {} in {} us", t, i, i % 997);
+					samples.push_back(uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+					continue;
+				}
+				const auto message = fmt::format("worker {} handled request {} in {} us", t, i, i % 997);
+				if (sync) {
+					const auto line = fmt::format("{} [{}] {}:{} {} - {}\n", std::chrono::system_clock::now(), "Info", __FILE__, __LINE__, __func__, message);
+					std::lock_guard lock(fileMutex);
+					std::fwrite(line.data(), 1, line.size(), file);
+				} else {
+					logger.log(DebugMessageType::Info, DEBUG_INFO, message);
+				}
+				samples.push_back(uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	const auto logged = Clock::now();
+	if (sync) {
+		std::fclose(file);
+	} else {
+		logger.flush();
+	}
+	const auto written = Clock::now();
+
+	std::vector<uint32_t> all;
+	for (const auto& samples : latencies) {
+		all.insert(all.end(), samples.begin(), samples.end());
+	}
+	std::sort(all.begin(), all.end());
+	const auto percentile = [&all](double p) { return all.empty() ? 0u : all[std::min(all.size() - 1, size_t(double(all.size()) * p))]; };
+	const double callSeconds = std::chrono::duration<double>(logged - start).count();
+	const double totalSeconds = std::chrono::duration<double>(written - start).count();
+
+	std::printf("%s, %zu threads, %zu messages\n", sync ? "synchronous" : deferred ? "async deferred" : "async", threadCount, all.size());
+	std::printf("  callers done  %.3f s  %.0f msg/s\n", callSeconds, double(all.size()) / callSeconds);
+	std::printf("  all written   %.3f s  %.0f msg/s\n", totalSeconds, double(all.size()) / totalSeconds);
+	std::printf("  latency ns    p50 %u  p99 %u  p99.9 %u  max %u\n", percentile(0.5), percentile(0.99), percentile(0.999), all.empty() ? 0u : all.back());
+	if (!sync) {
+		std::printf("  dropped       %llu\n", static_cast<unsigned long long>(logger.droppedCount()));
+	}
+	if (const auto fileSize = std::filesystem::file_size(path, error); !error) {
+		std::printf("  file size     %.1f MB\n", double(fileSize) / (1024.0 * 1024.0));
+	}
+	std::filesystem::remove(path, error);
+	return 0;
+}
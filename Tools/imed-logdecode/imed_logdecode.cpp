@@ -0,0 +1,215 @@
+// Turns binary log files written by AsyncLogger back into the text lines the logger would have written, or into
+// one JSON object per message with the format string and the arguments kept apart.
+//
+// usage: imed-logdecode [--json] <file>...
+
+#include "imed_gui_logger.hpp"
+
+#include <fmt/format.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using Tag = AsyncLogger::ArgumentTag;
+
+static void AppendJsonString(std::string& out, std::string_view text) {
+	out.push_back('"');
+	for (const char c : text) {
+		switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					fmt::format_to(std::back_inserter(out), "\\u{:04x}", int(c));
+				} else {
+					out.push_back(c);
+				}
+				break;
+		}
+	}
+	out.push_back('"');
+}
+
+static void AppendJsonNumber(std::string& out, double value) {
+	if (std::isfinite(value)) {
+		fmt::format_to(std::back_inserter(out), "{}", value);
+	} else {
+		out += "null";
+	}
+}
+
+static bool AppendJsonArguments(std::string& out, const uint8_t* in, const uint8_t* end, uint32_t count) {
+	const auto read = [&in, end]<typename V>(V& value) {
+		if (size_t(end - in) < sizeof(V)) {
+			return false;
+		}
+		std::memcpy(&value, in, sizeof(V));
+		in += sizeof(V);
+		return true;
+	};
+	out.push_back('[');
+	for (uint32_t i = 0; i < count; i++) {
+		if (i != 0) {
+			out.push_back(',');
+		}
+		uint8_t tag;
+		if (!read(tag)) {
+			return false;
+		}
+		switch (Tag(tag)) {
+			case Tag::Bool: { uint8_t value; if (!read(value)) return false; out += value != 0 ? "true" : "false"; break; }
+			case Tag::Char: { char value; if (!read(value)) return false; AppendJsonString(out, std::string_view(&value, 1)); break; }
+			case Tag::Int: { int64_t value; if (!read(value)) return false; fmt::format_to(std::back_inserter(out), "{}", value); break; }
+			case Tag::UInt: { uint64_t value; if (!read(value)) return false; fmt::format_to(std::back_inserter(out), "{}", value); break; }
+			case Tag::Float: { float value; if (!read(value)) return false; AppendJsonNumber(out, value); break; }
+			case Tag::Double: { double value; if (!read(value)) return false; AppendJsonNumber(out, value); break; }
+			case Tag::Pointer: { const void* value; if (!read(value)) return false; fmt::format_to(std::back_inserter(out), "\"{}\"", value); break; }
+			case Tag::String: {
+				uint32_t length;
+				if (!read(length) || size_t(end - in) < length) {
+					return false;
+				}
+				AppendJsonString(out, std::string_view(reinterpret_cast<const char*>(in), length));
+				in += length;
+				break;
+			}
+			default: return false;
+		}
+	}
+	out.push_back(']');
+	return true;
+}
+
+static bool Decode(const std::string& path, bool json) {
+	std::ifstream file(path, std::ios::binary);
+	const std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file.eof() && file.fail()) {
+		std::fprintf(stderr, "Failed to read \"%s\"\n", path.c_str());
+		return false;
+	}
+	if (bytes.size() < sizeof(AsyncLogger::BinaryMagic) || std::memcmp(bytes.data(), AsyncLogger::BinaryMagic, sizeof(AsyncLogger::BinaryMagic)) != 0) {
+		std::fprintf(stderr, "\"%s\" is not a binary log file\n", path.c_str());
+		return false;
+	}
+
+	std::unordered_map<uint32_t, std::string_view> strings;
+	const auto lookup = [&strings](uint32_t id) {
+		const auto it = strings.find(id);
+		return it != strings.end() ? it->second : std::string_view();
+	};
+	const auto* data = reinterpret_cast<const uint8_t*>(bytes.data());
+	const uint8_t* const end = data + bytes.size();
+	const uint8_t* in = data + sizeof(AsyncLogger::BinaryMagic);
+	std::string out;
+	bool truncated = false;
+	while (in < end) {
+		const auto entry = AsyncLogger::BinaryEntry(*in++);
+		if (entry == AsyncLogger::BinaryEntry::String) {
+			AsyncLogger::BinaryString header;
+			if (size_t(end - in) < sizeof(header)) {
+				truncated = true;
+				break;
+			}
+			std::memcpy(&header, in, sizeof(header));
+			in += sizeof(header);
+			if (size_t(end - in) < header.length) {
+				truncated = true;
+				break;
+			}
+			strings[header.id] = std::string_view(reinterpret_cast<const char*>(in), header.length);
+			in += header.length;
+		} else if (entry == AsyncLogger::BinaryEntry::Message) {
+			AsyncLogger::BinaryMessage message;
+			if (size_t(end - in) < sizeof(message)) {
+				truncated = true;
+				break;
+			}
+			std::memcpy(&message, in, sizeof(message));
+			in += sizeof(message);
+			if (size_t(end - in) < message.argumentsSize) {
+				truncated = true;
+				break;
+			}
+			const uint8_t* arguments = in;
+			in += message.argumentsSize;
+
+			const auto type = DebugMessageType(message.type);
+			const std::string_view format = lookup(message.format);
+			if (json) {
+				out += "{\"time\":";
+				fmt::format_to(std::back_inserter(out), "{}", message.time);
+				out += ",\"level\":";
+				AppendJsonString(out, AsyncLogger::TypeName(type));
+				out += ",\"file\":";
+				AppendJsonString(out, lookup(message.file));
+				fmt::format_to(std::back_inserter(out), ",\"line\":{},\"function\":", message.line);
+				AppendJsonString(out, lookup(message.function));
+				out += ",\"format\":";
+				AppendJsonString(out, format);
+				out += ",\"args\":";
+				const size_t argumentsStart = out.size();
+				if (!AppendJsonArguments(out, arguments, in, message.argumentCount)) {
+					out.resize(argumentsStart);
+					out += "null";
+				}
+				std::string text;
+				AsyncLogger::FormatArguments(text, format, arguments, in, message.argumentCount);
+				out += ",\"message\":";
+				AppendJsonString(out, text);
+				out += "}\n";
+			} else {
+				AsyncLogger::FormatPrefix(out, message.time, type, lookup(message.file), message.line, lookup(message.function));
+				AsyncLogger::FormatArguments(out, format, arguments, in, message.argumentCount);
+				out.push_back('\n');
+			}
+		} else {
+			std::fprintf(stderr, "\"%s\": unknown entry at offset %zu\n", path.c_str(), size_t(in - 1 - data));
+			break;
+		}
+
+		if (out.size() >= 1024 * 1024) {
+			std::fwrite(out.data(), 1, out.size(), stdout);
+			out.clear();
+		}
+	}
+	std::fwrite(out.data(), 1, out.size(), stdout);
+	// The last batch of a process that crashed while writing is cut off, everything before it is still usable.
+	if (truncated) {
+		std::fprintf(stderr, "\"%s\": truncated at the end\n", path.c_str());
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	bool json = false;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else if (argv[i][0] == '-') {
+			paths.clear();
+			break;
+		} else {
+			paths.emplace_back(argv[i]);
+		}
+	}
+	if (paths.empty()) {
+		std::fprintf(stderr, "usage: %s [--json] <file>...\n", argv[0]);
+		return 1;
+	}
+
+	bool success = true;
+	for (const auto& path : paths) {
+		success = Decode(path, json) && success;
+	}
+	return success ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// Measures what the workspace tree costs per frame as it grows: N-node trees are built in memory and drawn by
+// FreeTreeNode::show() in a headless ImGui context, every directory expanded. The first frame includes building
+// the visible row list, the toggle frame collapses and re-expands the root, which rebuilds it. Icons are not
+// packed, so every row draws the empty image.
+//
+// usage: imed-treebench [--nodes N[,N...]] [--frames N] [--subdirs N] [--files N]
+
+#include "imed_gui_layout.hpp"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double Milliseconds(Clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Breadth-first, every directory gets subdirs directories and files files until the tree holds nodeCount nodes.
+static FileTree BuildTree(size_t nodeCount, size_t subdirs, size_t files) {
+	FileTree tree { "/imed-treebench" };
+	std::deque<FileTree::NodeId> directories { FileTree::Root };
+	std::vector<std::pair<std::string, bool>> children;
+	while (!directories.empty() && tree.size() < nodeCount) {
+		const auto directory = directories.front();
+		directories.pop_front();
+
+		children.clear();
+		for (size_t i = 0; i < subdirs && tree.size() + children.size() < nodeCount; i++) {
+			children.emplace_back("dir" + std::to_string(i), true);
+		}
+		for (size_t i = 0; i < files && tree.size() + children.size() < nodeCount; i++) {
+			children.emplace_back("file" + std::to_string(i) + ".cpp", false);
+		}
+		// Prepended in reverse, so the children end up in sorted order without a search per insert.
+		std::sort(children.begin(), children.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.second != rhs.second ? lhs.second : lhs.first < rhs.first;
+		});
+		for (auto it = children.rbegin(); it != children.rend(); ++it) {
+			const auto node = tree.prependChild(directory, it->first, it->second);
+			if (it->second) {
+				directories.push_back(node);
+			}
+		}
+	}
+	return tree;
+}
+
+static Clock::duration Frame(FreeTreeNode& node) {
+	const auto start = Clock::now();
+	ImGui::NewFrame();
+	ImGui::SetNextWindowPos({ 0, 0 });
+	ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+	ImGui::Begin("Workspace");
+	node.show();
+	ImGui::End();
+	ImGui::Render();
+	return Clock::now() - start;
+}
+
+int main(int argc, char** argv) {
+	std::vector<size_t> nodeCounts { 1000, 10000, 100000, 1000000 };
+	size_t frameCount = 600;
+	size_t subdirs = 4;
+	size_t files = 16;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+			nodeCounts.clear();
+			for (char* next = argv[++i]; *next != '\0';) {
+				nodeCounts.push_back(std::max<size_t>(1, std::strtoull(next, &next, 10)));
+				if (*next == ',') {
+					next++;
+				} else if (*next != '\0') {
+					break;
+				}
+			}
+		} else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frameCount = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--subdirs") == 0 && i + 1 < argc) {
+			subdirs = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+			files = std::strtoull(argv[++i], nullptr, 10);
+		} else {
+			std::fprintf(stderr, "usage: %s [--nodes N[,N...]] [--frames N] [--subdirs N] [--files N]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	ImGui::CreateContext();
+	auto& io = ImGui::GetIO();
+	io.DisplaySize = { 1280, 800 };
+	io.DeltaTime = 1.0f / 60.0f;
+	unsigned char* pixels = nullptr;
+	int width = 0, height = 0;
+	io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+	std::printf("%10s %10s %10s %12s %12s %10s %10s %10s\n", "nodes", "build ms", "memory MB", "first ms", "toggle ms", "p50 us", "p99 us", "max us");
+	for (const auto nodeCount : nodeCounts) {
+		const auto buildStart = Clock::now();
+		FreeTreeNode node { BuildTree(nodeCount, subdirs, files) };
+		const auto build = Clock::now() - buildStart;
+		// Expanded before the first frame builds the rows, so this is not a row list search per directory.
+		for (FileTree::NodeId id = 0; id < node.tree.size(); id++) {
+			node.setExpanded(id, true);
+		}
+
+		const auto first = Frame(node);
+		std::vector<Clock::duration> frames;
+		frames.reserve(frameCount);
+		for (size_t i = 0; i < frameCount; i++) {
+			frames.push_back(Frame(node));
+		}
+		node.setExpanded(FileTree::Root, false);
+		node.setExpanded(FileTree::Root, true);
+		const auto toggle = Frame(node);
+
+		std::sort(frames.begin(), frames.end());
+		const auto percentile = [&frames](double p) { return Milliseconds(frames[std::min(frames.size() - 1, size_t(double(frames.size()) * p))]) * 1000.0; };
+		std::printf("%10zu %10.2f %10.2f %12.3f %12.3f %10.1f %10.1f %10.1f\n", node.tree.size(), Milliseconds(build),
+			double(node.tree.memoryUsage()) / (1024.0 * 1024.0), Milliseconds(first), Milliseconds(toggle),
+			percentile(0.5), percentile(0.99), Milliseconds(frames.back()) * 1000.0);
+	}
+	ImGui::DestroyContext();
+	return 0;
+}
@@ -1,6 +1,27 @@
+#include "imed_gui_app.hpp"
+#include "imed_gui_console.hpp"
 
+#include <filesystem>
+#include <memory>
 
 int main() {
+	Application application("ImEd", 1280, 800);
+	if (!application.isOpen()) {
+		return 1;
+	}
 
-	return 0;
+	auto workspace = std::make_shared<FreeTreeNode>(FreeTreeNode::BuildFromDirPath(std::filesystem::current_path()));
+	workspace->watch();
+
+	TabLayout tabs("##MainTabs");
+	TabItem workspaceTab("Workspace");
+	workspaceTab.setContent(workspace);
+	tabs.addTab(std::move(workspaceTab));
+	TabItem logTab("Log");
+	logTab.setContent(std::make_shared<LogConsole>());
+	tabs.addTab(std::move(logTab));
+
+	const int result = application.run(tabs);
+	workspace->saveSnapshot();
+	return result;
 }